@@ -23,6 +23,8 @@ Dicom::Dicom ( QWidget *parent ) : QMainWindow ( parent )
 
     QObject::connect ( ui.actionOpenDicomdir, &QAction::triggered, 
                        this,                  &Dicom::openDicomdir);
+    QObject::connect ( ui.actionOpenDirectory, &QAction::triggered,
+                       this,                   &Dicom::openDirectory);
     QObject::connect ( ui.actionExport,       &QAction::triggered, 
                        this,                  &Dicom::exportSerie);
     QObject::connect ( ui.actionPreferences,  &QAction::triggered, 
@@ -38,6 +40,11 @@ void Dicom::openDicomdir()
     ui.qtdcm->openDicomdir();
 }
 
+void Dicom::openDirectory()
+{
+    ui.qtdcm->openDirectory();
+}
+
 void Dicom::exportSerie()
 {
     QtDcmManager::instance()->importSelectedSeries();
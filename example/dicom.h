@@ -24,6 +24,7 @@ public:
     
 public slots:
     void openDicomdir();
+    void openDirectory();
     void exportSerie();
     void preferences();
 };
@@ -288,6 +288,7 @@ void QtDcmAPHP::stopMove(int pi_RequestId)
         auto mover = m_RequestIdMap[pi_RequestId];
         mover->onStopMove();
         m_RequestIdMap.remove(pi_RequestId);
+        mover->wait();
         delete mover;
     }
 }
@@ -190,7 +190,7 @@ void QtDcm::onPatientItemClicked ( QTreeWidgetItem * item, int column )
     }
     else
     {
-        QtDcmManager::instance()->findStudiesDicomdir ( item->text ( 0 ) );
+        QtDcmManager::instance()->findStudiesDicomdir ( item->text ( 0 ), item->text ( 1 ) );
     }
     
     QtDcmManager::instance()->clearPreview();
@@ -219,7 +219,8 @@ void QtDcm::onStudyItemClicked(QTreeWidgetItem * item, int column )
     }
     else
     {
-        QtDcmManager::instance()->findSeriesDicomdir ( treeWidgetPatients->currentItem()->text ( 0 ), item->data ( 1, 0 ).toString() );
+        QtDcmManager::instance()->findSeriesDicomdir ( treeWidgetPatients->currentItem()->text ( 0 ), item->data ( 1, 0 ).toString(),
+                                                       treeWidgetPatients->currentItem()->text ( 1 ) );
     }
     QtDcmManager::instance()->clearPreview();
 }
@@ -238,17 +239,25 @@ void QtDcm::onSerieItemClicked ( QTreeWidgetItem * item, int column )
         QtDcmManager::instance()->findImagesDicomdir ( item->text ( 2 ) );
     else
     {
+        // The instance counts come from the serie query, only the previewed instance is queried
         int elementCount = 0;
         for (QTreeWidgetItem *current : treeWidgetSeries->selectedItems())
         {
-            QtDcmManager::instance()->findImagesScu ( current->text ( 2 ) );
-            elementCount = QtDcmManager::instance()->listOfImages().size();
+            elementCount += current->data ( 4, 0 ).toInt();
             QtDcmManager::instance()->addDataToImport ( current->text ( 2 ), "SERIES" );
         }
+        const int previewIndex = QtDcmManager::instance()->findPreviewImageScu ( item->text ( 2 ), item->data ( 4, 0 ).toInt() );
+        if ( !elementCount )
+        {
+            elementCount = QtDcmManager::instance()->listOfImages().size();
+        }
         QString institution = item->data ( 5, 0 ).toString();
         QString opName = item->data ( 6, 0 ).toString();
         QtDcmManager::instance()->updateSerieInfo ( QString::number ( elementCount ), institution, opName );
-        QtDcmManager::instance()->getPreviewFromSelectedSerie ( item->text ( 3 ), elementCount / 2 );
+        if ( previewIndex >= 0 )
+        {
+            QtDcmManager::instance()->getPreviewFromSelectedSerie ( item->text ( 2 ), previewIndex );
+        }
     }
 
 }
@@ -301,7 +310,8 @@ void QtDcm::onCurrentModalityChanged ( int index )
     else
     {
         if ( treeWidgetPatients->currentItem() && treeWidgetStudies->currentItem() ) {
-            QtDcmManager::instance()->findSeriesDicomdir ( treeWidgetPatients->currentItem()->text ( 0 ), treeWidgetStudies->currentItem()->data ( 1, 0 ).toString() );
+            QtDcmManager::instance()->findSeriesDicomdir ( treeWidgetPatients->currentItem()->text ( 0 ), treeWidgetStudies->currentItem()->data ( 1, 0 ).toString(),
+                                                           treeWidgetPatients->currentItem()->text ( 1 ) );
         }
     }
 }
@@ -411,6 +421,31 @@ void QtDcm::openDicomdir()
     }
 }
 
+void QtDcm::openDirectory()
+{
+    this->clearDisplay();
+    d->mode = QtDcm::CD_MODE;
+    // Open a QFileDialog for choosing the media root directory
+    QFileDialog dialog(this);
+    dialog.setWindowTitle ( tr ( "Open directory" ) );
+    dialog.setFileMode ( QFileDialog::Directory );
+    dialog.setOption ( QFileDialog::ShowDirsOnly );
+
+    // Trying to open directly on one of the available drives
+    if (!QDir::drives().isEmpty()) {
+        dialog.setDirectory ( QDir::drives().first().absoluteDir() );
+    }
+
+    QString directory;
+    if ( dialog.exec() ) {
+        directory = dialog.selectedFiles() [0];
+    }
+
+    if ( !directory.isEmpty() ) {
+        QtDcmManager::instance()->loadDirectory ( directory );
+    }
+}
+
 void QtDcm::onPatientNameTextChanged ()
 {
     QString pName = nameEdit->text();
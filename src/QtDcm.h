@@ -85,6 +85,11 @@ public:
      */
     void openDicomdir();
 
+    /**
+     * @brief Opens a directory selection dialog, for media without dicomdir
+     */
+    void openDirectory();
+
     
 signals:
     void serieChecked ( bool checked );
@@ -0,0 +1,57 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <dcmtk/dcmdata/dcrledrg.h>      /* for DcmRLEDecoderRegistration */
+#include <dcmtk/dcmjpeg/djdecode.h>     /* for dcmjpeg decoders */
+#include <dcmtk/dcmjpls/djdecode.h>     /* for dcmjpls decoders */
+
+#include <QtDcmCodecs.h>
+
+namespace
+{
+/**
+ * Registers the decoders when built and removes them when the application exits
+ */
+class DecoderRegistry
+{
+public:
+    DecoderRegistry()
+    {
+        DcmRLEDecoderRegistration::registerCodecs ( OFFalse, OFFalse );
+        DJDecoderRegistration::registerCodecs ( EDC_photometricInterpretation, EUC_default, EPC_default, OFFalse );
+        DJLSDecoderRegistration::registerCodecs();
+    }
+
+    ~DecoderRegistry()
+    {
+        DJLSDecoderRegistration::cleanup();
+        DJDecoderRegistration::cleanup();
+        DcmRLEDecoderRegistration::cleanup();
+    }
+};
+}
+
+void QtDcmCodecs::registerDecoders()
+{
+    // Initialized once, even when called from several threads at the same time
+    static DecoderRegistry registry;
+    Q_UNUSED ( registry );
+}
@@ -0,0 +1,41 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMCODECS_H
+#define QTDCMCODECS_H
+
+#include <QtGui>
+
+/**
+ * This class owns the DCMTK decoders used by QtDcm (RLE, JPEG, JPEG-LS).
+ *
+ * They are registered in the global DCMTK codec list the first time registerDecoders() is called
+ * and stay registered until the application exits. Once registered, the codec list can be used
+ * by several threads decoding at the same time.
+ */
+class QtDcmCodecs
+{
+public:
+    /**
+     * Make sure the decoders are registered, may be called from any thread
+     */
+    static void registerDecoders();
+};
+
+#endif // QTDCMCODECS_H
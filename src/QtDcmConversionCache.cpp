@@ -0,0 +1,235 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <QtDcmConversionCache.h>
+
+namespace
+{
+const int PruneInterval = 24 * 3600;      /** Seconds between two prunes started by store() */
+
+/**
+ * Hard link a file, so that the output takes no space twice
+ */
+bool linkFile ( const QString & source, const QString & destination )
+{
+#ifdef _WIN32
+    return CreateHardLinkW ( reinterpret_cast<LPCWSTR> ( QDir::toNativeSeparators ( destination ).utf16() ),
+                             reinterpret_cast<LPCWSTR> ( QDir::toNativeSeparators ( source ).utf16() ), NULL );
+#else
+    return ::link ( QFile::encodeName ( source ).constData(), QFile::encodeName ( destination ).constData() ) == 0;
+#endif
+}
+
+/**
+ * Output files of an entry, one line per output : size, tab, modification time in ms, tab, absolute path.
+ * Returns false if the entry can't be read or an output was removed or modified since it was stored.
+ */
+bool readEntry ( const QString & filename, QStringList * sources )
+{
+    QFile entry ( filename );
+    if ( !entry.open ( QIODevice::ReadOnly | QIODevice::Text ) ) {
+        return false;
+    }
+
+    while ( !entry.atEnd() ) {
+        const QString line = QString::fromUtf8 ( entry.readLine() ).trimmed();
+        if ( line.isEmpty() ) {
+            continue;
+        }
+
+        const int first = line.indexOf ( '\t' );
+        const int second = first < 0 ? -1 : line.indexOf ( '\t', first + 1 );
+        if ( second < 0 ) {
+            return false;
+        }
+
+        const QFileInfo source ( line.mid ( second + 1 ) );
+        if ( !source.exists()
+             || source.size() != line.left ( first ).toLongLong()
+             || source.lastModified().toMSecsSinceEpoch() != line.mid ( first + 1, second - first - 1 ).toLongLong() ) {
+            return false;
+        }
+        sources->append ( source.absoluteFilePath() );
+    }
+
+    return !sources->isEmpty();
+}
+}
+
+class QtDcmConversionCache::Private
+{
+public:
+    QString directory;
+    int maxEntries;
+    int maxAge;
+
+    QString entryFilename ( const QByteArray & key ) const
+    {
+        return directory + QDir::separator() + QString::fromLatin1 ( key ) + ".txt";
+    }
+};
+
+QtDcmConversionCache::QtDcmConversionCache ( const QString & directory )
+    : d ( new QtDcmConversionCache::Private )
+{
+    d->directory = directory;
+    if ( d->directory.isEmpty() ) {
+        d->directory = QDir::homePath() + QDir::separator() + ".qtdcm" + QDir::separator() + "conversions";
+    }
+    d->maxEntries = 1000;
+    d->maxAge = 90;
+}
+
+QtDcmConversionCache::~QtDcmConversionCache()
+{
+    delete d;
+    d = NULL;
+}
+
+QByteArray QtDcmConversionCache::key ( const QString & serieUid, QStringList instanceUids, const QString & settings )
+{
+    instanceUids.sort();
+
+    QCryptographicHash hash ( QCryptographicHash::Sha1 );
+    hash.addData ( serieUid.toUtf8() + '\n' );
+    hash.addData ( settings.toUtf8() + '\n' );
+    for ( const QString & uid : instanceUids ) {
+        hash.addData ( uid.toUtf8() + '\n' );
+    }
+
+    return hash.result().toHex();
+}
+
+int QtDcmConversionCache::maxEntries() const
+{
+    return d->maxEntries;
+}
+
+void QtDcmConversionCache::setMaxEntries ( int count )
+{
+    d->maxEntries = count;
+}
+
+int QtDcmConversionCache::maxAge() const
+{
+    return d->maxAge;
+}
+
+void QtDcmConversionCache::setMaxAge ( int days )
+{
+    d->maxAge = days;
+}
+
+bool QtDcmConversionCache::restore ( const QByteArray & key, const QString & outputDirectory, QStringList * outputFiles )
+{
+    const QString entryFilename = d->entryFilename ( key );
+    if ( !QFileInfo ( entryFilename ).exists() ) {
+        return false;
+    }
+
+    QStringList sources;
+    if ( !readEntry ( entryFilename, &sources ) ) {
+        qDebug() << "Converted files changed since" << entryFilename << "was stored, converting again";
+        QFile::remove ( entryFilename );
+        return false;
+    }
+
+    QStringList destinations;
+    for ( const QString & source : sources ) {
+        const QString destination = QDir ( outputDirectory ).absoluteFilePath ( QFileInfo ( source ).fileName() );
+        destinations.append ( destination );
+        if ( QFileInfo ( destination ).canonicalFilePath() == QFileInfo ( source ).canonicalFilePath() ) {
+            continue;
+        }
+
+        QFile::remove ( destination );
+        if ( !linkFile ( source, destination ) && !QFile::copy ( source, destination ) ) {
+            qWarning() << "Cannot copy" << source << "to" << destination;
+            return false;
+        }
+    }
+
+    if ( outputFiles ) {
+        *outputFiles = destinations;
+    }
+
+    qDebug() << "Reused" << sources.size() << "converted files for" << outputDirectory;
+    return true;
+}
+
+void QtDcmConversionCache::store ( const QByteArray & key, const QStringList & outputFiles )
+{
+    if ( outputFiles.isEmpty() || !QDir().mkpath ( d->directory ) ) {
+        return;
+    }
+
+    QByteArray content;
+    for ( const QString & filename : outputFiles ) {
+        const QFileInfo info ( filename );
+        content += QByteArray::number ( info.size() ) + '\t'
+                   + QByteArray::number ( info.lastModified().toMSecsSinceEpoch() ) + '\t'
+                   + info.absoluteFilePath().toUtf8() + '\n';
+    }
+
+    QSaveFile entry ( d->entryFilename ( key ) );
+    if ( !entry.open ( QIODevice::WriteOnly ) || entry.write ( content ) != content.size() || !entry.commit() ) {
+        qWarning() << "Cannot write" << d->entryFilename ( key );
+    }
+
+    // Reading every entry is not worth it on each conversion, the marker tells when it was last done.
+    // Conversions running at the same time may both prune, removing an entry twice is harmless
+    QFile marker ( d->directory + QDir::separator() + "pruned" );
+    const QFileInfo markerInfo ( marker );
+    if ( !markerInfo.exists() || markerInfo.lastModified().secsTo ( QDateTime::currentDateTime() ) > PruneInterval
+         || QDir ( d->directory ).entryList ( QStringList() << "*.txt", QDir::Files ).size() > d->maxEntries ) {
+        if ( marker.open ( QIODevice::WriteOnly ) ) {
+            marker.setFileTime ( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+            marker.close();
+        }
+        prune();
+    }
+}
+
+void QtDcmConversionCache::prune()
+{
+    // Entries are rewritten when reused, their modification time is the last use
+    const QFileInfoList entries = QDir ( d->directory ).entryInfoList ( QStringList() << "*.txt", QDir::Files, QDir::Time );
+    const QDateTime oldest = QDateTime::currentDateTime().addDays ( -d->maxAge );
+
+    int kept = 0;
+    for ( const QFileInfo & entry : entries ) {
+        QStringList sources;
+        if ( kept >= d->maxEntries || ( d->maxAge > 0 && entry.lastModified() < oldest )
+             || !readEntry ( entry.absoluteFilePath(), &sources ) ) {
+            QFile::remove ( entry.absoluteFilePath() );
+        }
+        else {
+            ++kept;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMCONVERSIONCACHE_H
+#define QTDCMCONVERSIONCACHE_H
+
+#include <QtGui>
+
+/**
+ * This class remembers the files produced by the conversion of a serie, so that importing
+ * the same serie again (to the same or another directory) reuses them instead of converting.
+ *
+ * A conversion is identified by a key built from the SeriesInstanceUID, the sorted
+ * SOPInstanceUIDs and the converter settings : a serie that gained or lost instances gets
+ * another key and is converted again. The cache only holds the paths, sizes and modification
+ * times of the outputs, they are hard linked (or copied if that fails) to the new output directory.
+ * An entry whose outputs were removed or modified since is dropped, and so are the entries beyond
+ * maxEntries() or not used for maxAge() days, the least recently used first.
+ */
+class QtDcmConversionCache
+{
+public:
+    /**
+     * @param directory where the cache entries are kept, ~/.qtdcm/conversions if empty
+     */
+    QtDcmConversionCache ( const QString & directory = QString() );
+    virtual ~QtDcmConversionCache();
+
+    /**
+     * Key of a conversion
+     *
+     * @param serieUid SeriesInstanceUID of the serie
+     * @param instanceUids SOPInstanceUIDs of the serie, in any order
+     * @param settings anything that changes the converter output (format, compression...)
+     */
+    static QByteArray key ( const QString & serieUid, QStringList instanceUids, const QString & settings );
+
+    /**
+     * Number of conversions remembered (1000 by default)
+     */
+    int maxEntries() const;
+    void setMaxEntries ( int count );
+
+    /**
+     * Days after which a conversion not reused is forgotten (90 by default), 0 keeps them forever
+     */
+    int maxAge() const;
+    void setMaxAge ( int days );
+
+    /**
+     * Bring the outputs of a previous conversion to a directory
+     *
+     * @param outputFiles receives the restored files, if not null
+     * @return false if there is no entry for the key, or its outputs changed or are missing
+     */
+    bool restore ( const QByteArray & key, const QString & outputDirectory, QStringList * outputFiles = NULL );
+
+    /**
+     * Record the outputs of a conversion, and forget the entries out of the budget
+     */
+    void store ( const QByteArray & key, const QStringList & outputFiles );
+
+    /**
+     * Remove the entries whose outputs are gone, then the ones out of the budget
+     */
+    void prune();
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmConversionCache )
+};
+
+#endif // QTDCMCONVERSIONCACHE_H
@@ -18,17 +18,650 @@
 */
 #include "QtDcmConvert.h"
 
+#include <QtDcmImageWriter.h>
 #include <QtDcmManager.h>
+#include <QtDcmNiftiWriter.h>
 #include <QtDcmPreferences.h>
+#include <QtDcmThreadBudget.h>
 
 #include <itkImage.h>
 #include <itkGDCMImageIO.h>
-#include <itkGDCMSeriesFileNames.h>
 #include <itkImageSeriesReader.h>
+#include <itkImageFileReader.h>
 #include <itkMetaDataDictionary.h>
 #include <itkObjectFactoryBase.h>
 #include <itkMetaDataObject.h>
-#include <itkImageFileWriter.h>
+#include <itkRGBPixel.h>
+#include <itkJoinSeriesImageFilter.h>
+
+#include <gdcmSerieHelper.h>
+
+#include <algorithm>
+
+namespace
+{
+typedef itk::GDCMImageIO                            ImageIOType;
+typedef std::vector< std::string >                  FileNamesContainer;
+typedef QVector< FileNamesContainer >               VolumesContainer;
+
+/**
+ * Limits the number of dcm2nii processes running at the same time, whatever the number
+ * of conversion threads. The limit is the one of the conversion acquiring a slot.
+ *
+ * A dcm2nii process compresses its outputs on several threads, so by default each process
+ * takes the threads of a conversion : the conversion share of the thread budget runs
+ * QtDcmThreadBudget::concurrentConversions() processes, even if the conversion queue was
+ * given more threads or other conversions run outside of it.
+ */
+class ProcessSlots
+{
+public:
+    ProcessSlots() : running ( 0 ) {}
+
+    void acquire ( int limit )
+    {
+        if ( limit <= 0 ) {
+            limit = QtDcmThreadBudget::concurrentConversions();
+        }
+
+        QMutexLocker locker ( &mutex );
+        while ( running >= limit ) {
+            released.wait ( &mutex );
+        }
+        running++;
+    }
+
+    void release()
+    {
+        QMutexLocker locker ( &mutex );
+        running--;
+        released.wakeOne();
+    }
+
+private:
+    QMutex mutex;
+    QWaitCondition released;
+    int running;
+};
+
+Q_GLOBAL_STATIC ( ProcessSlots, dcm2niiSlots )
+
+/**
+ * What to do with the converted images
+ */
+struct OutputOptions
+{
+    qint64 memoryLimit;                 /** NIfTI files larger than this are streamed, if positive */
+    int compressionLevel;
+    bool writeFile;                     /** Write the images to their output file */
+    QStringList * outputFiles;          /** Receives the files written */
+    QList<QtDcmVolume> * volumes;       /** Receives the images in memory, if not null */
+};
+
+/**
+ * Keep an ITK filter within the threads of a conversion, instead of one thread per core
+ */
+void limitThreads ( itk::ProcessObject * filter )
+{
+    const int threads = QtDcmThreadBudget::threadsPerConversion();
+    filter->SetNumberOfWorkUnits ( threads );
+    filter->GetMultiThreader()->SetMaximumNumberOfThreads ( threads );
+}
+
+/**
+ * Decode one file of a serie into its slice of the volume buffer
+ */
+template <typename ImageType>
+class SliceTask : public QRunnable
+{
+public:
+    typedef typename ImageType::PixelType PixelType;
+
+    SliceTask ( const std::string & filename, PixelType * destination, size_t pixelCount, QAtomicInt * failed, QSemaphore * done )
+        : filename ( filename ), destination ( destination ), pixelCount ( pixelCount ), failed ( failed ), done ( done ) {}
+
+    void run()
+    {
+        decode();
+        done->release();
+    }
+
+private:
+    void decode()
+    {
+        typedef itk::ImageFileReader< ImageType >       ReaderType;
+
+        // A GDCMImageIO per file : the decoders of one IO can't be shared between threads
+        ImageIOType::Pointer dicomIO = ImageIOType::New();
+        typename ReaderType::Pointer reader = ReaderType::New();
+        reader->SetFileName ( filename );
+        reader->SetImageIO ( dicomIO );
+        reader->SetNumberOfWorkUnits ( 1 );
+
+        try {
+            reader->Update();
+        }
+        catch ( itk::ExceptionObject &excp ) {
+            qCritical() << excp.GetDescription();
+            failed->storeRelease ( 1 );
+            return;
+        }
+
+        const ImageType * slice = reader->GetOutput();
+        if ( slice->GetPixelContainer()->Size() != pixelCount ) {
+            qCritical() << "Unexpected slice size in" << QString::fromStdString ( filename );
+            failed->storeRelease ( 1 );
+            return;
+        }
+
+        std::copy ( slice->GetBufferPointer(), slice->GetBufferPointer() + pixelCount, destination );
+    }
+
+    std::string filename;
+    PixelType * destination;
+    size_t pixelCount;
+    QAtomicInt * failed;
+    QSemaphore * done;                  /** Released once the slice is decoded or has failed */
+};
+
+/**
+ * Read a volume as ImageSeriesReader does, but with the files decoded in parallel : the
+ * geometry is computed by the series reader from the headers, then each file is decoded on
+ * the shared decoding pool into its own slice of the buffer. Compressed series (JPEG 2000, JPEG-LS...)
+ * are otherwise decoded one slice after the other.
+ *
+ * @return a null pointer if a file can't be read
+ */
+template <typename ImageType>
+typename ImageType::Pointer readVolume ( const FileNamesContainer & files, ImageIOType * dicomIO )
+{
+    typedef itk::ImageSeriesReader< ImageType >         ReaderType;
+
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileNames ( files );
+    reader->SetImageIO ( dicomIO );
+    limitThreads ( reader );
+
+    try {
+        reader->UpdateOutputInformation();
+    }
+    catch ( itk::ExceptionObject &excp ) {
+        qCritical() << excp.GetDescription();
+        return typename ImageType::Pointer();
+    }
+
+    const typename ImageType::RegionType region = reader->GetOutput()->GetLargestPossibleRegion();
+    const size_t slicePixels = size_t ( region.GetSize ( 0 ) ) * region.GetSize ( 1 );
+
+    // Multi-frame files don't map to one slice per file, the series reader handles them
+    if ( files.size() < 2 || region.GetSize ( 2 ) != files.size() ) {
+        try {
+            reader->Update();
+        }
+        catch ( itk::ExceptionObject &excp ) {
+            qCritical() << excp.GetDescription();
+            return typename ImageType::Pointer();
+        }
+        return reader->GetOutput();
+    }
+
+    typename ImageType::Pointer image = ImageType::New();
+    image->CopyInformation ( reader->GetOutput() );
+    image->SetRegions ( region );
+    image->Allocate();
+
+    // The pool is shared with the other conversions, only the slices of this volume are waited for
+    QThreadPool * pool = QtDcmThreadBudget::decodingPool();
+    QAtomicInt failed ( 0 );
+    QSemaphore done;
+    for ( size_t i = 0; i < files.size(); i++ ) {
+        pool->start ( new SliceTask<ImageType> ( files.at ( i ), image->GetBufferPointer() + i * slicePixels, slicePixels, &failed, &done ) );
+    }
+    done.acquire ( int ( files.size() ) );
+
+    if ( failed.loadAcquire() ) {
+        return typename ImageType::Pointer();
+    }
+
+    return image;
+}
+
+/**
+ * NIfTI datatype of the pixel types handled by the conversion
+ */
+template <typename PixelType> struct NiftiDatatype;
+template <> struct NiftiDatatype<unsigned char> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::UINT8; };
+template <> struct NiftiDatatype<char> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::INT8; };
+template <> struct NiftiDatatype<unsigned short> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::UINT16; };
+template <> struct NiftiDatatype<signed short> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::INT16; };
+template <> struct NiftiDatatype<unsigned int> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::UINT32; };
+template <> struct NiftiDatatype<int> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::INT32; };
+template <> struct NiftiDatatype<float> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::FLOAT32; };
+template <> struct NiftiDatatype<double> { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::FLOAT64; };
+template <> struct NiftiDatatype< itk::RGBPixel<unsigned char> > { static const QtDcmNiftiWriter::eDatatype value = QtDcmNiftiWriter::RGB24; };
+
+/**
+ * Same as writeVolume, but only slabSize slices are in memory at a time : each slab is read
+ * and appended to the NIfTI file (compressed as it goes for a .nii.gz), the header is written
+ * once the geometry is known.
+ */
+template <typename PixelType>
+bool writeStreamedVolume ( const VolumesContainer & volumes, ImageIOType * dicomIO, const QString & completeFilename, int slabSize, int compressionLevel )
+{
+    typedef itk::Image< PixelType, 3 >                  ImageType;
+
+    QtDcmNiftiWriter writer;
+    writer.setDatatype ( NiftiDatatype<PixelType>::value );
+    writer.setCompressionLevel ( compressionLevel );
+    if ( !writer.open ( completeFilename ) ) {
+        return false;
+    }
+
+    const int sliceCount = volumes.first().size();
+    for ( int t = 0; t < volumes.size(); t++ ) {
+        const FileNamesContainer & files = volumes.at ( t );
+        if ( ( int ) files.size() != sliceCount ) {
+            qCritical() << "The volumes of" << completeFilename << "do not have the same number of slices";
+            return false;
+        }
+
+        int first = 0;
+        while ( first < sliceCount ) {
+            // A last slab of a single slice would have no spacing, it goes with the previous one
+            int last = qMin ( first + slabSize, sliceCount );
+            if ( sliceCount - last == 1 ) {
+                last = sliceCount;
+            }
+
+            const typename ImageType::Pointer image = readVolume<ImageType> ( FileNamesContainer ( files.begin() + first, files.begin() + last ), dicomIO );
+            if ( !image ) {
+                return false;
+            }
+
+            if ( t == 0 && first == 0 ) {
+                const typename ImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+                writer.setDimensions ( size[0], size[1], sliceCount, volumes.size() );
+                writer.setSpacing ( image->GetSpacing()[0], image->GetSpacing()[1], image->GetSpacing()[2] );
+
+                double origin[3];
+                double direction[3][3];
+                for ( int i = 0; i < 3; i++ ) {
+                    origin[i] = image->GetOrigin()[i];
+                    for ( int j = 0; j < 3; j++ ) {
+                        direction[i][j] = image->GetDirection() ( i, j );
+                    }
+                }
+                writer.setOrigin ( origin );
+                writer.setDirection ( direction );
+            }
+
+            const qint64 bytes = qint64 ( image->GetPixelContainer()->Size() ) * sizeof ( PixelType );
+            if ( !writer.writeData ( reinterpret_cast<const char *> ( image->GetBufferPointer() ), bytes ) ) {
+                return false;
+            }
+
+            first = last;
+        }
+    }
+
+    return writer.close();
+}
+
+/**
+ * Write an up to date image and/or hand it over in memory
+ */
+template <typename ImageType>
+bool outputImage ( ImageType * image, const QString & filename, const OutputOptions & options )
+{
+    if ( options.volumes ) {
+        try {
+            image->Update();
+        }
+        catch ( itk::ExceptionObject &ex ) {
+            qCritical() << ex.GetDescription();
+            return false;
+        }
+        options.volumes->append ( QtDcmImageWriter::toVolume ( image ) );
+    }
+
+    if ( !options.writeFile ) {
+        return true;
+    }
+
+    if ( !QtDcmImageWriter::write ( image, filename, options.compressionLevel ) ) {
+        return false;
+    }
+    options.outputFiles->append ( filename );
+    return true;
+}
+
+/**
+ * Read the volumes of a serie and write them as a single image, keeping the pixel type of the dicom files.
+ * One volume gives a 3D image, several volumes (that must have the same size) are stacked in a 4D image.
+ * A positive slabSize streams the image with writeStreamedVolume.
+ */
+template <typename PixelType>
+bool writeVolume ( const VolumesContainer & volumes, ImageIOType * dicomIO, const QString & completeFilename, int slabSize, const OutputOptions & options )
+{
+    if ( slabSize > 0 ) {
+        const bool success = writeStreamedVolume<PixelType> ( volumes, dicomIO, completeFilename, slabSize, options.compressionLevel );
+        if ( success ) {
+            options.outputFiles->append ( completeFilename );
+        }
+        return success;
+    }
+
+    typedef itk::Image< PixelType, 3 >                  ImageType;
+    typedef itk::Image< PixelType, 4 >                  SequenceType;
+    typedef itk::JoinSeriesImageFilter< ImageType, SequenceType > JoinType;
+
+    std::vector< typename ImageType::Pointer > images;
+    for ( int i = 0; i < volumes.size(); i++ ) {
+        const typename ImageType::Pointer image = readVolume<ImageType> ( volumes.at ( i ), dicomIO );
+        if ( !image ) {
+            return false;
+        }
+        images.push_back ( image );
+    }
+
+    if ( images.size() == 1 ) {
+        return outputImage ( images.front().GetPointer(), completeFilename, options );
+    }
+
+    typename JoinType::Pointer join = JoinType::New();
+    limitThreads ( join );
+    for ( unsigned int i = 0; i < images.size(); i++ ) {
+        join->SetInput ( i, images.at ( i ) );
+    }
+
+    return outputImage ( join->GetOutput(), completeFilename, options );
+}
+
+/**
+ * Instantiate the pipeline on the pixel type of the files, so that no cast is done.
+ * NIfTI images larger than the memory limit are streamed.
+ */
+bool writeVolume ( const VolumesContainer & volumes, ImageIOType * dicomIO, const QString & completeFilename, const OutputOptions & options )
+{
+    if ( volumes.isEmpty() || volumes.first().empty() ) {
+        return false;
+    }
+
+    dicomIO->SetFileName ( volumes.first().front() );
+    try {
+        dicomIO->ReadImageInformation();
+    }
+    catch ( itk::ExceptionObject &e ) {
+        qCritical() << e.GetDescription();
+        return false;
+    }
+
+    // ITK writes NIfTI images in one piece, so does it need the whole image in memory
+    int slabSize = 0;
+    const bool singleFrame = dicomIO->GetNumberOfDimensions() < 3 || dicomIO->GetDimensions ( 2 ) == 1;
+    const qint64 memoryLimit = options.memoryLimit;
+    if ( memoryLimit > 0 && options.writeFile && !options.volumes && singleFrame && ( completeFilename.endsWith ( ".nii" ) || completeFilename.endsWith ( ".nii.gz" ) ) ) {
+        const qint64 sliceBytes = qint64 ( dicomIO->GetDimensions ( 0 ) ) * dicomIO->GetDimensions ( 1 )
+                                  * dicomIO->GetComponentSize() * dicomIO->GetNumberOfComponents();
+        qint64 sliceCount = 0;
+        for ( const FileNamesContainer & files : volumes ) {
+            sliceCount += files.size();
+        }
+
+        if ( sliceBytes * sliceCount > memoryLimit ) {
+            slabSize = qMax<qint64> ( 2, memoryLimit / qMax<qint64> ( 1, sliceBytes ) );
+            qDebug() << "Writing" << completeFilename << "by slabs of" << slabSize << "slices";
+        }
+    }
+
+    if ( dicomIO->GetNumberOfComponents() == 3 && dicomIO->GetComponentType() == itk::ImageIOBase::UCHAR ) {
+        return writeVolume< itk::RGBPixel<unsigned char> > ( volumes, dicomIO, completeFilename, slabSize, options );
+    }
+
+    if ( dicomIO->GetNumberOfComponents() == 1 ) {
+        switch ( dicomIO->GetComponentType() ) {
+        case itk::ImageIOBase::UCHAR:
+            return writeVolume<unsigned char> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::CHAR:
+            return writeVolume<char> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::USHORT:
+            return writeVolume<unsigned short> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::SHORT:
+            return writeVolume<signed short> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::UINT:
+            return writeVolume<unsigned int> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::INT:
+            return writeVolume<int> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::FLOAT:
+            return writeVolume<float> ( volumes, dicomIO, completeFilename, slabSize, options );
+        case itk::ImageIOBase::DOUBLE:
+            return writeVolume<double> ( volumes, dicomIO, completeFilename, slabSize, options );
+        default:
+            break;
+        }
+    }
+
+    qWarning() << "Unsupported pixel type" << QString::fromStdString ( dicomIO->GetPixelTypeAsString ( dicomIO->GetPixelType() ) )
+               << QString::fromStdString ( dicomIO->GetComponentTypeAsString ( dicomIO->GetComponentType() ) )
+               << ", converting to signed short";
+    return writeVolume<signed short> ( volumes, dicomIO, completeFilename, slabSize, options );
+}
+
+/**
+ * What is needed of a slice to split a serie in time points
+ */
+struct Slice
+{
+    std::string filename;
+    QString position;
+    QString acquisitionTime;
+    int instance;
+};
+
+/**
+ * Value of a string element of a parsed header, empty if missing
+ */
+QString elementValue ( const gdcm::DataSet & dataset, const gdcm::Tag & tag )
+{
+    if ( !dataset.FindDataElement ( tag ) ) {
+        return QString();
+    }
+
+    const gdcm::ByteValue * value = dataset.GetDataElement ( tag ).GetByteValue();
+    if ( !value ) {
+        return QString();
+    }
+
+    return QString::fromLatin1 ( value->GetPointer(), value->GetLength() ).remove ( QChar ( '\0' ) ).trimmed();
+}
+
+/**
+ * Scan a serie directory the way GDCMSeriesFileNames does : one sub-serie per series date and
+ * orientation, each one sorted along its normal. The slices needed to split the time points are
+ * taken from the headers parsed by this scan, so that no file is read twice.
+ */
+VolumesContainer scanDirectory ( const QString & directory, QVector<Slice> & slices )
+{
+    gdcm::SerieHelper helper;
+    helper.SetUseSeriesDetails ( true );
+    helper.AddRestriction ( "0008|0021" );
+    helper.AddRestriction ( "0020,0037" );
+    helper.SetDirectory ( directory.toStdString(), false );
+
+    VolumesContainer subSeries;
+    for ( gdcm::FileList * fileList = helper.GetFirstSingleSerieUIDFileSet(); fileList; fileList = helper.GetNextSingleSerieUIDFileSet() ) {
+        if ( fileList->empty() ) {
+            continue;
+        }
+
+        helper.OrderFileList ( fileList );
+
+        FileNamesContainer files;
+        for ( const gdcm::SmartPointer<gdcm::FileWithName> & file : *fileList ) {
+            const gdcm::DataSet & dataset = file->GetDataSet();
+            files.push_back ( file->filename );
+
+            Slice slice;
+            slice.filename = file->filename;
+            slice.position = elementValue ( dataset, gdcm::Tag ( 0x0020, 0x0032 ) );
+            slice.acquisitionTime = elementValue ( dataset, gdcm::Tag ( 0x0008, 0x0032 ) );
+            slice.instance = elementValue ( dataset, gdcm::Tag ( 0x0020, 0x0013 ) ).toInt();
+            slices.append ( slice );
+        }
+        subSeries.append ( files );
+    }
+
+    return subSeries;
+}
+
+/**
+ * Group the sub-series of a manifest by orientation and slice size, each one sorted along
+ * its normal, without reading any file. Slices of another size could not be stacked in the
+ * same volume, GDCMSeriesFileNames splits them too.
+ */
+VolumesContainer sortManifest ( const QtDcmSliceManifest & manifest, QVector<Slice> & slices )
+{
+    QStringList orientations;
+    QHash<QString, QList<QtDcmSlice> > groups;
+
+    for ( const QtDcmSlice & slice : manifest ) {
+        QStringList values;
+        for ( int i = 0; i < 6; i++ ) {
+            values.append ( QString::number ( slice.orientation[i], 'f', 3 ) );
+        }
+        values.append ( QString::number ( slice.rows ) );
+        values.append ( QString::number ( slice.columns ) );
+        const QString key = values.join ( "\\" );
+
+        if ( !groups.contains ( key ) ) {
+            orientations.append ( key );
+        }
+        groups[key].append ( slice );
+    }
+
+    VolumesContainer subSeries;
+    for ( const QString & orientation : orientations ) {
+        QList<QtDcmSlice> & group = groups[orientation];
+
+        const double * o = group.first().orientation;
+        const double normal[3] = { o[1] * o[5] - o[2] * o[4],
+                                   o[2] * o[3] - o[0] * o[5],
+                                   o[0] * o[4] - o[1] * o[3] };
+
+        std::stable_sort ( group.begin(), group.end(), [&normal] ( const QtDcmSlice & a, const QtDcmSlice & b ) {
+            const double da = normal[0] * a.position[0] + normal[1] * a.position[1] + normal[2] * a.position[2];
+            const double db = normal[0] * b.position[0] + normal[1] * b.position[1] + normal[2] * b.position[2];
+            return ( da < db ) || ( da == db && a.instanceNumber < b.instanceNumber );
+        } );
+
+        FileNamesContainer files;
+        for ( const QtDcmSlice & slice : group ) {
+            files.push_back ( slice.filename.toStdString() );
+
+            Slice entry;
+            entry.filename = files.back();
+            entry.position = QString ( "%1\\%2\\%3" ).arg ( slice.position[0] ).arg ( slice.position[1] ).arg ( slice.position[2] );
+            entry.acquisitionTime = slice.acquisitionTime;
+            entry.instance = slice.instanceNumber;
+            slices.append ( entry );
+        }
+        subSeries.append ( files );
+    }
+
+    return subSeries;
+}
+
+/**
+ * Split the slices of a serie in time points : the slices are grouped by position (they must
+ * already be sorted along the normal), then each position is ordered by acquisition time and
+ * instance number. Returns an empty container if the positions do not all have the same
+ * number of slices.
+ */
+VolumesContainer splitTimePoints ( const QVector<Slice> & slices )
+{
+    QStringList positions;
+    QHash<QString, QVector<Slice> > byPosition;
+
+    for ( const Slice & slice : slices ) {
+        if ( !byPosition.contains ( slice.position ) ) {
+            positions.append ( slice.position );
+        }
+        byPosition[slice.position].append ( slice );
+    }
+
+    if ( positions.isEmpty() ) {
+        return VolumesContainer();
+    }
+
+    const int timePoints = byPosition.value ( positions.first() ).size();
+    for ( const QString & position : positions ) {
+        if ( byPosition.value ( position ).size() != timePoints ) {
+            return VolumesContainer();
+        }
+    }
+
+    VolumesContainer volumes ( timePoints );
+    for ( const QString & position : positions ) {
+        QVector<Slice> & sorted = byPosition[position];
+        std::stable_sort ( sorted.begin(), sorted.end(), [] ( const Slice & a, const Slice & b ) {
+            return ( a.acquisitionTime < b.acquisitionTime ) || ( a.acquisitionTime == b.acquisitionTime && a.instance < b.instance );
+        } );
+
+        for ( int t = 0; t < timePoints; t++ ) {
+            volumes[t].push_back ( sorted.at ( t ).filename );
+        }
+    }
+
+    return volumes;
+}
+
+/**
+ * Filename of the n-th sub-serie : the first one keeps the filename, the next ones get a _2, _3... suffix
+ */
+QString subSerieFilename ( const QString & filename, int index )
+{
+    if ( index == 0 ) {
+        return filename;
+    }
+
+    // Series UIDs are full of dots, only strip the known extension
+    QString extension = "." + QFileInfo ( filename ).suffix();
+    if ( filename.endsWith ( ".nii.gz" ) ) {
+        extension = ".nii.gz";
+    }
+
+    return filename.left ( filename.size() - extension.size() ) + "_" + QString::number ( index + 1 ) + extension;
+}
+}
+
+QtDcmConvert::Settings::Settings()
+    : outputFormat ( "nii" ),
+      compressionLevel ( 6 ),
+      subSeriesMode ( QtDcmConvert::ALL_SUBSERIES ),
+      memoryLimit ( 2048 ),
+      useDcm2nii ( false ),
+      dcm2niiTimeout ( 600 ),
+      dcm2niiProcessCount ( 0 ),
+      useConversionCache ( true )
+{
+}
+
+QtDcmConvert::Settings QtDcmConvert::Settings::fromPreferences()
+{
+    QtDcmPreferences * preferences = QtDcmPreferences::instance();
+
+    Settings settings;
+    settings.outputFormat = preferences->outputFormat();
+    settings.compressionLevel = preferences->compressionLevel();
+    settings.subSeriesMode = ( QtDcmConvert::eSubSeriesMode ) preferences->subSeriesMode();
+    settings.memoryLimit = preferences->memoryLimit();
+    settings.useDcm2nii = preferences->useDcm2nii();
+    settings.dcm2niiPath = preferences->dcm2niiPath();
+    settings.dcm2niiTimeout = preferences->dcm2niiTimeout();
+    settings.dcm2niiProcessCount = preferences->dcm2niiProcessCount();
+    settings.useConversionCache = preferences->useConversionCache();
+    return settings;
+}
 
 class QtDcmConvert::Private
 {
@@ -39,6 +672,15 @@ public:
     QString inputDirectory;
     QString outputDirectory;
     QString outputFilename;
+    QtDcmConvert::Settings settings;
+    QtDcmConvert::eSubSeriesMode subSeriesMode;
+    QtDcmSliceManifest sliceManifest;
+    qint64 memoryLimit;
+    int compressionLevel;
+    bool writeFiles;
+    bool keepVolumes;
+    QStringList outputFiles;
+    QList<QtDcmVolume> volumes;
 };
 
 QtDcmConvert::QtDcmConvert ( QObject * parent ) 
@@ -47,6 +689,9 @@ QtDcmConvert::QtDcmConvert ( QObject * parent )
 {
     d->inputDirectory = "";
     d->outputFilename = "";
+    this->setSettings ( QtDcmConvert::Settings() );
+    d->writeFiles = true;
+    d->keepVolumes = false;
 }
 
 QtDcmConvert::~QtDcmConvert()
@@ -55,141 +700,102 @@ QtDcmConvert::~QtDcmConvert()
   d = NULL;
 }
 
-void QtDcmConvert::convert()
+bool QtDcmConvert::convert()
 {
-    if (QtDcmPreferences::instance()->useDcm2nii()) {
-        const QString program = QtDcmPreferences::instance()->dcm2niiPath();
+    d->outputFiles.clear();
+    d->volumes.clear();
+
+    if ( d->settings.useDcm2nii ) {
+        const QString program = d->settings.dcm2niiPath;
         QStringList arguments;
         arguments << "-x" << "N";
         arguments << "-r" << "N";
-        arguments << "-g" << "N";
+        arguments << "-g" << ( d->outputFilename.endsWith ( ".gz" ) ? "Y" : "N" );
         arguments << "-o" << d->outputDirectory << d->inputDirectory;
-        
-        QProcess process(this);
-        process.setStandardOutputFile(d->tempDirectory + QDir::separator() + "logs" + QDir::separator() + d->serieUID + ".txt");
-        process.start(program, arguments);
-        process.waitForFinished();
+
+        const int timeout = d->settings.dcm2niiTimeout;
+        const QString logFilename = d->tempDirectory + QDir::separator() + "logs" + QDir::separator() + d->serieUID + ".txt";
+
+        dcm2niiSlots()->acquire ( d->settings.dcm2niiProcessCount );
+
+        // Both outputs go straight to the log file, nothing to read while waiting
+        QProcess process;
+        process.setProcessChannelMode ( QProcess::MergedChannels );
+        process.setStandardOutputFile ( logFilename );
+        process.start ( program, arguments );
+
+        bool success = process.waitForStarted();
+        if ( !success ) {
+            qCritical() << "Cannot start" << program << ":" << process.errorString();
+        }
+        else if ( !process.waitForFinished ( ( timeout > 0 ) ? timeout * 1000 : -1 ) ) {
+            qCritical() << "dcm2nii timed out on" << d->inputDirectory;
+            process.kill();
+            process.waitForFinished();
+            success = false;
+        }
+        else if ( process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0 ) {
+            qCritical() << "dcm2nii failed on" << d->inputDirectory << "with exit code" << process.exitCode() << ", see" << logFilename;
+            success = false;
+        }
+
+        dcm2niiSlots()->release();
+        return success;
     }
     else {
-        typedef signed short                                PixelType;
-        const unsigned int Dimension = 3;
-        typedef itk::Image< PixelType, Dimension >          ImageType;
-        typedef itk::ImageSeriesReader< ImageType >         ReaderType;
-        typedef itk::ImageFileWriter<ImageType>             WriterType;
-        typedef itk::GDCMImageIO                            ImageIOType;
-        typedef itk::GDCMSeriesFileNames                    NamesGeneratorType;
-        typedef std::vector< std::string >                  FileNamesContainer;
-        typedef std::vector< std::string >                  SeriesIdContainer;
-
-//     ImageType::Pointer image = 0;
-
-        ReaderType::Pointer reader = ReaderType::New();
         ImageIOType::Pointer dicomIO = ImageIOType::New();
+        const QString completeFilename = d->outputDirectory + QDir::separator() + d->outputFilename;
 
-        NamesGeneratorType::Pointer inputNames = NamesGeneratorType::New();
-        inputNames->SetUseSeriesDetails ( true );
-        inputNames->AddSeriesRestriction ( "0008|0021" );
-        inputNames->AddSeriesRestriction ( "0020,0037" );
-        inputNames->LoadSequencesOn();
-        inputNames->LoadPrivateTagsOn();
-        inputNames->SetInputDirectory ( d->inputDirectory.toStdString() );
-        try {
-            const SeriesIdContainer & seriesUID = inputNames->GetSeriesUIDs();
-            if (seriesUID.empty()) { // Prevent crash
-                qCritical() << "Series uid list is empty";
-                return;
-            }
-            std::string seriesIdentifier = seriesUID.begin()->c_str();
-            FileNamesContainer filenames = inputNames->GetFileNames ( seriesIdentifier );
+        VolumesContainer subSeries;
+        QVector<Slice> slices;
 
-            dicomIO->SetFileName ( filenames.begin()->c_str() );
-            try {
-                dicomIO->ReadImageInformation();
-            }
-            catch ( itk::ExceptionObject &e ) {
-                qCritical() << e.GetDescription();
-                return;
+        if ( !d->sliceManifest.isEmpty() ) {
+            // The slices have been recorded when they were received, no need to scan the directory
+            subSeries = sortManifest ( d->sliceManifest, slices );
+        }
+        else {
+            // The directory is scanned once, the file lists of all the outputs come from that scan
+            subSeries = scanDirectory ( d->inputDirectory, slices );
+            if ( subSeries.isEmpty() ) { // Prevent crash
+                qCritical() << "Series uid list is empty";
+                return false;
             }
+        }
 
-            reader->UseStreamingOn();
-            reader->SetFileNames ( filenames );
-            reader->SetImageIO ( dicomIO );
+        OutputOptions options;
+        options.memoryLimit = d->memoryLimit;
+        options.compressionLevel = d->compressionLevel;
+        options.writeFile = d->writeFiles;
+        options.outputFiles = &d->outputFiles;
+        options.volumes = d->keepVolumes ? &d->volumes : NULL;
 
-            try {
-                reader->Update();
-            }
-            catch ( itk::ExceptionObject &excp ) {
-                qCritical() << excp.GetDescription();
-                return;
-            }
+        switch ( d->subSeriesMode ) {
+        case FIRST_SUBSERIE:
+            return writeVolume ( subSeries.mid ( 0, 1 ), dicomIO, completeFilename, options );
 
-//         IteratorType itOut;
-//
-//         image = reader->GetOutput();
-//
-//         RegionType region;
-//         region.SetSize ( 0, image->GetLargestPossibleRegion().GetSize() [0] );
-//         region.SetSize ( 1, image->GetLargestPossibleRegion().GetSize() [1] );
-//         region.SetSize ( 2, image->GetLargestPossibleRegion().GetSize() [2] );
-//         image->SetRegions ( region );
-//         image->Allocate();
-//         SpacingType spacing;
-//         spacing[0] = image->GetSpacing() [0];
-//         spacing[1] = image->GetSpacing() [1];
-//         spacing[2] = image->GetSpacing() [2];
-//         spacing[3] = 1;
-//         image->SetSpacing ( spacing );
-//         PointType origin;
-//         origin[0] = image->GetOrigin() [0];
-//         origin[1] = image->GetOrigin() [1];
-//         origin[2] = image->GetOrigin() [2];
-//         origin[3] = 0;
-//         image->SetOrigin ( origin );
-//         DirectionType direction;
-//         for ( unsigned int i=0; i<4; i++ )
-//             for ( unsigned int j=0; j<4; j++ )
-//             {
-//                 if ( ( i < 3 ) && ( j < 3 ) )
-//                     direction[i][j] = image->GetDirection() [i][j];
-//                 else
-//                     direction[i][j] = ( i == j ) ? 1 : 0;
-//             }
-//         image->SetDirection ( direction );
-//         itOut = IteratorType ( image, region );
-//
-//         image->SetMetaDataDictionary ( dicomIO->GetMetaDataDictionary() );
-//
-//
-//         itk::ImageRegionIterator<ImageType> itIn ( image, image->GetLargestPossibleRegion() );
-//         while ( !itIn.IsAtEnd() )
-//         {
-//             itOut.Set ( itIn.Get() );
-//             ++itIn;
-//             ++itOut;
-//         }
-
-
-            WriterType::Pointer writer = WriterType::New();
-
-            QString completeFilename = d->outputDirectory + QDir::separator() + d->outputFilename;
-
-            writer->SetFileName ( completeFilename.toStdString() );
-            writer->SetInput ( reader->GetOutput() );
-//         writer->SetInput ( image );
-
-            try {
-                writer->Update();
+        case VOLUME_4D:
+        {
+            const VolumesContainer timePoints = splitTimePoints ( slices );
+            if ( !timePoints.isEmpty() ) {
+                return writeVolume ( timePoints, dicomIO, completeFilename, options );
             }
-            catch ( itk::ExceptionObject &ex ) {
-                qCritical() << ex.GetDescription();
-                return;
+            qWarning() << "Cannot split" << d->inputDirectory << "in time points, converting each sub-serie";
+        }
+        // fall through
+        case ALL_SUBSERIES:
+        default:
+        {
+            bool success = !subSeries.isEmpty();
+            for ( int i = 0; i < subSeries.size(); i++ ) {
+                const QString filename = d->outputDirectory + QDir::separator() + subSerieFilename ( d->outputFilename, i );
+                success = writeVolume ( subSeries.mid ( i, 1 ), dicomIO, filename, options ) && success;
             }
+            return success;
         }
-        catch ( itk::ExceptionObject &ex ) {
-            qCritical() << ex.GetDescription();
-            return;
         }
     }
+
+    return true;
 }
 
 void QtDcmConvert::setInputDirectory ( const QString & dir )
@@ -217,3 +823,50 @@ void QtDcmConvert::setTempDirectory(const QString & dir)
   d->tempDirectory = dir;
 }
 
+void QtDcmConvert::setSliceManifest ( const QtDcmSliceManifest & manifest )
+{
+  d->sliceManifest = manifest;
+}
+
+void QtDcmConvert::setSettings ( const QtDcmConvert::Settings & settings )
+{
+  d->settings = settings;
+  d->subSeriesMode = settings.subSeriesMode;
+  d->memoryLimit = qint64 ( settings.memoryLimit ) * 1024 * 1024;
+  d->compressionLevel = settings.compressionLevel;
+}
+
+void QtDcmConvert::setSubSeriesMode ( QtDcmConvert::eSubSeriesMode mode )
+{
+  d->subSeriesMode = mode;
+}
+
+void QtDcmConvert::setMemoryLimit ( qint64 bytes )
+{
+  d->memoryLimit = bytes;
+}
+
+void QtDcmConvert::setCompressionLevel ( int level )
+{
+  d->compressionLevel = level;
+}
+
+QStringList QtDcmConvert::outputFiles() const
+{
+  return d->outputFiles;
+}
+
+void QtDcmConvert::setWriteFiles ( bool write )
+{
+  d->writeFiles = write;
+}
+
+void QtDcmConvert::setKeepVolumes ( bool keep )
+{
+  d->keepVolumes = keep;
+}
+
+QList<QtDcmVolume> QtDcmConvert::volumes() const
+{
+  return d->volumes;
+}
@@ -22,6 +22,8 @@
 #define QTDCMCONVERT_H
 
 #include <QtGui>
+#include <QtDcmSliceManifest.h>
+#include <QtDcmVolume.h>
 
 class QtDcmConvert : public QObject
 {
@@ -32,12 +34,101 @@ public:
 
     ~QtDcmConvert();
 
-    void convert();
+    /**
+     * What to do when the input directory holds several sub-series (split by acquisition date,
+     * orientation, sequence...)
+     */
+    enum eSubSeriesMode
+    {
+        FIRST_SUBSERIE,     /** Only convert the first sub-serie */
+        ALL_SUBSERIES,      /** One volume per sub-serie, the next ones are suffixed with _2, _3... */
+        VOLUME_4D           /** Stack the time points (DWI, fMRI) in a single 4D volume */
+    };
+
+    /**
+     * The preferences a conversion depends on. QtDcmPreferences is not thread safe, so they
+     * are read with fromPreferences() on the GUI thread and the copy is handed to the conversion.
+     */
+    struct Settings
+    {
+        Settings();
+
+        /**
+         * Current preferences, only call it from the GUI thread
+         */
+        static Settings fromPreferences();
+
+        QString outputFormat;           /** Extension of the converted files */
+        int compressionLevel;           /** Compression level of the compressed outputs, from 0 to 9 */
+        eSubSeriesMode subSeriesMode;
+        int memoryLimit;                /** Uncompressed NIfTI outputs larger than this (MB) are streamed, 0 never */
+        bool useDcm2nii;                /** Convert with dcm2nii instead of ITK */
+        QString dcm2niiPath;
+        int dcm2niiTimeout;             /** In seconds, 0 for none */
+        int dcm2niiProcessCount;        /** Concurrent dcm2nii processes, 0 for QtDcmThreadBudget::concurrentConversions() */
+        bool useConversionCache;        /** Reuse the outputs of series already converted */
+    };
+
+    /**
+     * Convert the input directory, blocks until done
+     *
+     * @return false if the conversion failed
+     */
+    bool convert();
+
+    /**
+     * Files written by the last ITK conversion (the dcm2nii outputs are not known)
+     */
+    QStringList outputFiles() const;
+
+    /**
+     * Write the converted images to the output directory (true by default)
+     */
+    void setWriteFiles ( bool write );
+
+    /**
+     * Keep the converted images in memory, for volumes() (false by default).
+     * The images are then never streamed, whatever the memory limit.
+     */
+    void setKeepVolumes ( bool keep );
+
+    /**
+     * Images of the last ITK conversion, in the order of the output files, if kept
+     */
+    QList<QtDcmVolume> volumes() const;
     void setInputDirectory ( const QString & dir );
     void setOutputDirectory ( const QString & dir );
     void setOutputFilename ( const QString & fname );
     void setTempDirectory( const QString & dir);
     void setSerieUID( const QString & uid);
+
+    /**
+     * Preferences of the conversion, Settings() by default.
+     * Sets the sub-series mode, memory limit and compression level below as well.
+     */
+    void setSettings ( const Settings & settings );
+
+    /**
+     * Sub-series handling
+     */
+    void setSubSeriesMode ( eSubSeriesMode mode );
+
+    /**
+     * Slices of the input directory as recorded when they were received.
+     * When set, the ITK conversion uses it instead of scanning the directory.
+     */
+    void setSliceManifest ( const QtDcmSliceManifest & manifest );
+
+    /**
+     * Uncompressed NIfTI outputs larger than this are read and written slab by slab,
+     * 0 disables the streaming.
+     */
+    void setMemoryLimit ( qint64 bytes );
+
+    /**
+     * Compression level of the compressed outputs (.nii.gz, .nrrd, .mha), from 0 to 9
+     */
+    void setCompressionLevel ( int level );
     
 
 private:
@@ -0,0 +1,258 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmConversionCache.h>
+#include <QtDcmConvert.h>
+#include <QtDcmConvertQueue.h>
+#include <QtDcmThreadBudget.h>
+
+namespace
+{
+class ConvertTask : public QRunnable
+{
+public:
+    ConvertTask ( QtDcmConvertQueue * queue, QAtomicInt * pending )
+        : queue ( queue ), pending ( pending ) {}
+
+    void run()
+    {
+        emit queue->conversionStarted ( serie );
+
+        const QString filename = outputDirectory + QDir::separator() + outputFilename;
+
+        // The outputs of dcm2nii are not known and the cache only holds files, not images.
+        // Without the UIDs recorded during the move, reading every header would cost as much as converting
+        QtDcmConversionCache cache;
+        QByteArray key;
+        if ( settings.useConversionCache && !settings.useDcm2nii && writeFiles && !keepVolumes ) {
+            const QStringList uids = instanceUids();
+            if ( !uids.isEmpty() ) {
+                key = QtDcmConversionCache::key ( serie, uids, settingsKey() );
+            }
+        }
+
+        QStringList outputFiles;
+        bool converted = !key.isEmpty() && cache.restore ( key, outputDirectory, &outputFiles );
+        QList<QtDcmVolume> images;
+
+        QtDcmVolume image;
+        if ( !converted && volume && volume->write ( writeFiles ? filename : QString(), settings.compressionLevel,
+                                                     keepVolumes ? &image : NULL ) ) {
+            converted = true;
+            if ( writeFiles ) {
+                outputFiles.append ( filename );
+            }
+            if ( !image.isNull() ) {
+                images.append ( image );
+            }
+        }
+
+        // The slices the volume held were never written if the dicom files are not, the
+        // input directory must have them all for the conversion below
+        bool complete = true;
+        if ( !converted && volume ) {
+            int saved = 0;
+            complete = volume->saveDatasets ( inputDirectory, &saved );
+            if ( !complete ) {
+                qWarning() << "Some slices of" << serie << "could not be written, the conversion would be incomplete";
+            }
+            if ( saved > 0 ) {
+                manifest.clear();
+            }
+        }
+        volume.clear();
+
+        if ( !converted && complete ) {
+            QtDcmConvert converter;
+            converter.setInputDirectory ( inputDirectory );
+            converter.setOutputDirectory ( outputDirectory );
+            converter.setOutputFilename ( outputFilename );
+            converter.setTempDirectory ( tempDirectory );
+            converter.setSerieUID ( serie );
+            converter.setSettings ( settings );
+            converter.setSliceManifest ( manifest );
+            converter.setWriteFiles ( writeFiles );
+            converter.setKeepVolumes ( keepVolumes );
+            converted = converter.convert();
+            outputFiles = converter.outputFiles();
+            images = converter.volumes();
+        }
+
+        if ( converted && !key.isEmpty() && !outputFiles.isEmpty() ) {
+            cache.store ( key, outputFiles );
+        }
+
+        if ( converted && !images.isEmpty() ) {
+            emit queue->volumesConverted ( serie, images );
+        }
+
+        if ( converted && !outputFiles.isEmpty() ) {
+            emit queue->filesConverted ( serie, outputFiles );
+        }
+
+        // Nothing is written when the images are only handed over
+        if ( converted ) {
+            emit queue->conversionFinished ( serie, outputFiles.isEmpty() ? QString() : outputFiles.first() );
+        }
+        else {
+            emit queue->conversionFailed ( serie );
+        }
+
+        if ( pending->fetchAndAddOrdered ( -1 ) == 1 ) {
+            emit queue->allConversionsFinished();
+        }
+    }
+
+    QString inputDirectory;
+    QString outputDirectory;
+    QString outputFilename;
+    QString tempDirectory;
+    QString serie;
+    QtDcmSliceManifest manifest;
+    QSharedPointer<QtDcmVolumeAssembler> volume;
+    QtDcmConvert::Settings settings;
+    bool writeFiles;
+    bool keepVolumes;
+
+private:
+    /**
+     * SOPInstanceUIDs of the serie, from the manifest or the volume, empty if there is neither
+     */
+    QStringList instanceUids() const
+    {
+        QStringList uids;
+        for ( const QtDcmSlice & slice : manifest ) {
+            uids.append ( slice.sopInstanceUid );
+        }
+
+        if ( uids.isEmpty() && volume ) {
+            uids = volume->instanceUids();
+        }
+        return uids;
+    }
+
+    /**
+     * Everything in the settings that changes the converted files
+     */
+    QString settingsKey() const
+    {
+        QStringList values;
+        values << settings.outputFormat
+               << QString::number ( settings.compressionLevel )
+               << QString::number ( settings.subSeriesMode )
+               << QString::number ( settings.memoryLimit )
+               << ( settings.useDcm2nii ? settings.dcm2niiPath : QString ( "itk" ) );
+        return values.join ( "|" );
+    }
+
+    QtDcmConvertQueue * queue;
+    QAtomicInt * pending;
+};
+}
+
+class QtDcmConvertQueue::Private
+{
+public:
+    QThreadPool pool;
+    QAtomicInt pending;
+    bool writeFiles;
+    bool keepVolumes;
+};
+
+QtDcmConvertQueue::QtDcmConvertQueue ( QObject * parent )
+    : QObject ( parent ),
+      d ( new QtDcmConvertQueue::Private )
+{
+    // Each conversion is already multithreaded by ITK, see QtDcmThreadBudget
+    d->pool.setMaxThreadCount ( QtDcmThreadBudget::concurrentConversions() );
+    d->writeFiles = true;
+    d->keepVolumes = false;
+}
+
+QtDcmConvertQueue::~QtDcmConvertQueue()
+{
+    d->pool.waitForDone();
+    delete d;
+    d = NULL;
+}
+
+int QtDcmConvertQueue::maxThreadCount() const
+{
+    return d->pool.maxThreadCount();
+}
+
+void QtDcmConvertQueue::setMaxThreadCount ( int count )
+{
+    d->pool.setMaxThreadCount ( qMax ( 1, count ) );
+}
+
+void QtDcmConvertQueue::enqueue ( const QString & inputDirectory, const QString & outputDirectory,
+                                  const QString & outputFilename, const QString & tempDirectory,
+                                  const QString & serie, const QtDcmSliceManifest & manifest,
+                                  QSharedPointer<QtDcmVolumeAssembler> volume )
+{
+    ConvertTask * task = new ConvertTask ( this, &d->pending );
+    task->inputDirectory = inputDirectory;
+    task->outputDirectory = outputDirectory;
+    task->outputFilename = outputFilename;
+    task->tempDirectory = tempDirectory;
+    task->serie = serie;
+    task->manifest = manifest;
+    task->volume = volume;
+    // The preferences are only read here, on the calling thread
+    task->settings = QtDcmConvert::Settings::fromPreferences();
+    task->writeFiles = d->writeFiles;
+    task->keepVolumes = d->keepVolumes;
+
+    d->pending.fetchAndAddOrdered ( 1 );
+    d->pool.start ( task );
+}
+
+bool QtDcmConvertQueue::writeFiles() const
+{
+    return d->writeFiles;
+}
+
+void QtDcmConvertQueue::setWriteFiles ( bool write )
+{
+    d->writeFiles = write;
+}
+
+bool QtDcmConvertQueue::keepVolumes() const
+{
+    return d->keepVolumes;
+}
+
+void QtDcmConvertQueue::setKeepVolumes ( bool keep )
+{
+    d->keepVolumes = keep;
+}
+
+int QtDcmConvertQueue::pendingCount() const
+{
+    return d->pending.load();
+}
+
+void QtDcmConvertQueue::waitForDone()
+{
+    d->pool.waitForDone();
+}
@@ -0,0 +1,118 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMCONVERTQUEUE_H
+#define QTDCMCONVERTQUEUE_H
+
+#include <QtGui>
+#include <QtDcmSliceManifest.h>
+#include <QtDcmVolume.h>
+#include <QtDcmVolumeAssembler.h>
+
+/**
+ * This class runs the conversions of the imported series on a thread pool.
+ *
+ * enqueue() returns immediately, so that the next series can be retrieved while the previous
+ * ones are converted. The signals are emitted from the pool threads, receivers living in the
+ * GUI thread get them through queued connections.
+ */
+class QtDcmConvertQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    QtDcmConvertQueue ( QObject * parent = 0 );
+    virtual ~QtDcmConvertQueue();
+
+    /**
+     * Number of series converted at the same time, QtDcmThreadBudget::concurrentConversions() by default
+     */
+    int maxThreadCount() const;
+    void setMaxThreadCount ( int count );
+
+    /**
+     * Queue the conversion of a serie, with the conversion preferences of the time of the call.
+     * Must be called from the GUI thread, like every QtDcmPreferences access.
+     *
+     * @param inputDirectory directory containing the dicom files of the serie
+     * @param outputDirectory directory where the volume is written
+     * @param outputFilename filename of the volume
+     * @param tempDirectory qtdcm temporary directory, for the converter logs
+     * @param serie SeriesInstanceUID of the serie
+     * @param manifest slices of the serie if known, saves the converter a directory scan
+     * @param volume volume assembled while the serie was received, written as is if valid
+     *               (the input directory is only converted if that fails)
+     */
+    void enqueue ( const QString & inputDirectory, const QString & outputDirectory,
+                   const QString & outputFilename, const QString & tempDirectory,
+                   const QString & serie, const QtDcmSliceManifest & manifest = QtDcmSliceManifest(),
+                   QSharedPointer<QtDcmVolumeAssembler> volume = QSharedPointer<QtDcmVolumeAssembler>() );
+
+    /**
+     * Write the converted series to their output directory (true by default).
+     * Applies to the series queued afterwards.
+     */
+    bool writeFiles() const;
+    void setWriteFiles ( bool write );
+
+    /**
+     * Hand the converted images over with volumesConverted() (false by default).
+     * Applies to the series queued afterwards.
+     */
+    bool keepVolumes() const;
+    void setKeepVolumes ( bool keep );
+
+    /**
+     * Number of conversions queued or running
+     */
+    int pendingCount() const;
+
+    /**
+     * Block until all the queued conversions are done
+     */
+    void waitForDone();
+
+signals:
+    void conversionStarted ( const QString & serie );
+
+    /**
+     * A serie is converted, filename is its first output file, empty if no file was written (see writeFiles())
+     */
+    void conversionFinished ( const QString & serie, const QString & filename );
+
+    /**
+     * All the files written for a serie (one per sub-serie, see QtDcmConvert::eSubSeriesMode),
+     * emitted before conversionFinished() which only gives the first one
+     */
+    void filesConverted ( const QString & serie, const QStringList & filenames );
+    void conversionFailed ( const QString & serie );
+    void allConversionsFinished();
+
+    /**
+     * The images of a serie, emitted before conversionFinished() when keepVolumes() is set
+     */
+    void volumesConverted ( const QString & serie, const QList<QtDcmVolume> & volumes );
+
+private:
+    class Private;
+    Private * d;
+};
+
+#endif // QTDCMCONVERTQUEUE_H
@@ -0,0 +1,179 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmFetchModel.h>
+
+class QtDcmFetchModel::Private : public QSharedData
+{
+public:
+    QHash<QString, QtDcmPatientEntry> patients;  /** key : PatientID */
+    QHash<QString, QtDcmStudyEntry> studies;     /** key : StudyInstanceUID */
+    QHash<QString, QtDcmSeriesEntry> series;     /** key : SeriesInstanceUID */
+};
+
+QtDcmFetchModel::QtDcmFetchModel()
+    : d ( new QtDcmFetchModel::Private )
+{
+}
+
+QtDcmFetchModel::QtDcmFetchModel ( const QtDcmFetchModel & other )
+    : d ( other.d )
+{
+}
+
+QtDcmFetchModel::~QtDcmFetchModel()
+{
+}
+
+QtDcmFetchModel & QtDcmFetchModel::operator= ( const QtDcmFetchModel & other )
+{
+    d = other.d;
+    return *this;
+}
+
+void QtDcmFetchModel::addPatient ( const QString & patientId, const QtDcmPatientEntry & patient )
+{
+    if ( !d->patients.contains ( patientId ) ) {
+        d->patients.insert ( patientId, patient );
+    }
+}
+
+bool QtDcmFetchModel::addStudy ( const QString & studyUid, const QtDcmStudyEntry & study )
+{
+    if ( d->studies.contains ( studyUid ) || !d->patients.contains ( study.patientId ) ) {
+        return false;
+    }
+
+    d->studies.insert ( studyUid, study );
+    d->patients[study.patientId].studies.append ( studyUid );
+
+    return true;
+}
+
+void QtDcmFetchModel::addSerie ( const QString & serieUid, const QtDcmSeriesEntry & serie )
+{
+    if ( !d->series.contains ( serieUid ) ) {
+        d->series.insert ( serieUid, serie );
+    }
+}
+
+void QtDcmFetchModel::clearPatients()
+{
+    d->patients.clear();
+    d->studies.clear();
+}
+
+void QtDcmFetchModel::clearSeries()
+{
+    d->series.clear();
+}
+
+QtDcmFetchModel QtDcmFetchModel::selectStudies ( const QSet<QString> & studyUids ) const
+{
+    QtDcmFetchModel selection;
+
+    for ( const QString & uid : studyUids ) {
+        const QHash<QString, QtDcmStudyEntry>::const_iterator study = d->studies.constFind ( uid );
+        if ( study == d->studies.constEnd() ) {
+            continue;
+        }
+
+        // The patient is copied without its studies, only the selected ones are attached back
+        if ( !selection.d->patients.contains ( study->patientId ) ) {
+            QtDcmPatientEntry patient = d->patients.value ( study->patientId );
+            patient.studies.clear();
+            selection.d->patients.insert ( study->patientId, patient );
+        }
+        selection.addStudy ( uid, study.value() );
+    }
+
+    return selection;
+}
+
+QtDcmFetchModel QtDcmFetchModel::selectSeries ( const QSet<QString> & serieUids ) const
+{
+    QSet<QString> studyUids;
+    QHash<QString, QtDcmSeriesEntry> series;
+
+    for ( const QString & uid : serieUids ) {
+        const QHash<QString, QtDcmSeriesEntry>::const_iterator serie = d->series.constFind ( uid );
+        if ( serie != d->series.constEnd() ) {
+            series.insert ( uid, serie.value() );
+            studyUids.insert ( serie->studyUid );
+        }
+    }
+
+    QtDcmFetchModel selection = selectStudies ( studyUids );
+    selection.d->series = series;
+
+    return selection;
+}
+
+const QHash<QString, QtDcmPatientEntry> & QtDcmFetchModel::patients() const
+{
+    return d->patients;
+}
+
+const QHash<QString, QtDcmStudyEntry> & QtDcmFetchModel::studies() const
+{
+    return d->studies;
+}
+
+const QHash<QString, QtDcmSeriesEntry> & QtDcmFetchModel::series() const
+{
+    return d->series;
+}
+
+QHash<QString, QHash<QString, QVariant> > QtDcmFetchModel::patientsHash() const
+{
+    QHash<QString, QHash<QString, QVariant> > patients;
+    patients.reserve ( d->patients.size() );
+
+    for ( QHash<QString, QtDcmPatientEntry>::const_iterator it = d->patients.constBegin(); it != d->patients.constEnd(); ++it ) {
+        QHash<QString, QVariant> studies;
+        for ( const QString & uid : it->studies ) {
+            studies.insert ( uid, d->studies.value ( uid ).description );
+        }
+
+        QHash<QString, QVariant> & entry = patients[it.key()];
+        entry["PatientName"] = it->name;
+        entry["BirthDate"] = it->birthDate;
+        entry["Gender"] = it->gender;
+        entry["studies"] = studies;
+    }
+
+    return patients;
+}
+
+QHash<QString, QHash<QString, QVariant> > QtDcmFetchModel::seriesHash() const
+{
+    QHash<QString, QHash<QString, QVariant> > series;
+    series.reserve ( d->series.size() );
+
+    for ( QHash<QString, QtDcmSeriesEntry>::const_iterator it = d->series.constBegin(); it != d->series.constEnd(); ++it ) {
+        QHash<QString, QVariant> & entry = series[it.key()];
+        entry["StudyInstanceUID"] = it->studyUid;
+        entry["SeriesDescription"] = it->description;
+        entry["Modality"] = it->modality;
+    }
+
+    return series;
+}
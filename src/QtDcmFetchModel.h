@@ -0,0 +1,130 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMFETCHMODEL_H
+#define QTDCMFETCHMODEL_H
+
+#include "qtdcmExports.h"
+#include <QtGui>
+
+/**
+ * Patient selected in the patient list, as given to addPatientDataToFetch()
+ */
+struct QtDcmPatientEntry
+{
+    QString name;               /** PatientName */
+    QString birthDate;          /** PatientBirthDate (yyyyMMdd) */
+    QString gender;             /** PatientSex */
+    QStringList studies;        /** StudyInstanceUID of the studies found for this patient */
+};
+
+/**
+ * Study found for a selected patient
+ */
+struct QtDcmStudyEntry
+{
+    QString patientId;          /** PatientID, key of the patient in QtDcmFetchModel::patients() */
+    QString description;        /** StudyDescription */
+};
+
+/**
+ * Serie found for a selected study
+ */
+struct QtDcmSeriesEntry
+{
+    QString studyUid;           /** StudyInstanceUID, key of the study in QtDcmFetchModel::studies() */
+    QString description;        /** SeriesDescription */
+    QString modality;           /** Modality */
+};
+
+/**
+ * This class holds the patients, studies and series collected while browsing,
+ * and the subsets of them handed over by QtDcmManager::fetchSelectedData().
+ *
+ * Each level is hashed on its identifier (PatientID, StudyInstanceUID, SeriesInstanceUID)
+ * and the studies know their patient, so that a selection is resolved in linear time.
+ * The model is implicitly shared : copying it, or handing it out in a signal, is cheap.
+ */
+class QTDCM_EXPORT QtDcmFetchModel
+{
+public:
+    QtDcmFetchModel();
+    QtDcmFetchModel ( const QtDcmFetchModel & other );
+    virtual ~QtDcmFetchModel();
+
+    QtDcmFetchModel & operator= ( const QtDcmFetchModel & other );
+
+    /**
+     * Add a patient, a patient already present is kept as is
+     */
+    void addPatient ( const QString & patientId, const QtDcmPatientEntry & patient );
+
+    /**
+     * Attach a study to a patient added before
+     *
+     * @return false if the patient is unknown or the study already present
+     */
+    bool addStudy ( const QString & studyUid, const QtDcmStudyEntry & study );
+
+    /**
+     * Add a serie, a serie already present is kept as is
+     */
+    void addSerie ( const QString & serieUid, const QtDcmSeriesEntry & serie );
+
+    /**
+     * Remove the patients and their studies
+     */
+    void clearPatients();
+
+    void clearSeries();
+
+    /**
+     * Subset holding the given studies and their patients, but no serie
+     */
+    QtDcmFetchModel selectStudies ( const QSet<QString> & studyUids ) const;
+
+    /**
+     * Subset holding the given series, their studies and their patients
+     */
+    QtDcmFetchModel selectSeries ( const QSet<QString> & serieUids ) const;
+
+    const QHash<QString, QtDcmPatientEntry> & patients() const;
+    const QHash<QString, QtDcmStudyEntry> & studies() const;
+    const QHash<QString, QtDcmSeriesEntry> & series() const;
+
+    /**
+     * Patients in the form of the fetchFinished() signal :
+     * PatientID => [PatientName, BirthDate, Gender, studies (StudyInstanceUID => description)]
+     */
+    QHash<QString, QHash<QString, QVariant> > patientsHash() const;
+
+    /**
+     * Series in the form of the fetchFinished() signal :
+     * SeriesInstanceUID => [StudyInstanceUID, SeriesDescription, Modality]
+     */
+    QHash<QString, QHash<QString, QVariant> > seriesHash() const;
+
+private:
+    class Private;
+    QSharedDataPointer<Private> d;
+};
+
+Q_DECLARE_METATYPE ( QtDcmFetchModel )
+
+#endif // QTDCMFETCHMODEL_H
@@ -127,13 +127,15 @@ void QtDcmFindCallback::callback ( T_DIMSE_C_FindRQ *request, int &responseCount
 
     case IMAGES:
         OFString number;
+        OFString serie;
         responseIdentifiers->findAndGetOFString ( DCM_SOPInstanceUID, info );
         responseIdentifiers->findAndGetOFString ( DCM_InstanceNumber, number );
+        responseIdentifiers->findAndGetOFString ( DCM_SeriesInstanceUID, serie );
 
         if ( !number.length() )
             number = "0";
 
-        QtDcmManager::instance()->foundImage ( QString ( info.c_str() ), QString ( number.c_str() ).toInt() );
+        QtDcmManager::instance()->foundImage ( QString ( info.c_str() ), QString ( number.c_str() ).toInt(), QString ( serie.c_str() ) );
 
 //         responseIdentifiers->print ( std::cout );
 
@@ -126,6 +126,7 @@ void QtDcmFindDicomdir::findPatients()
 void QtDcmFindDicomdir::findStudies (const QString &patientName)
 {
     bool proceed = false;
+    OFString strPatientId;
     static const OFString Patient ( "PATIENT" );
     static const OFString Study ( "STUDY" );
 
@@ -162,6 +163,11 @@ void QtDcmFindDicomdir::findStudies (const QString &patientName)
                     lelt->getOFStringArray ( strName );
                     proceed = ( QString ( strName.c_str() ) == patientName );
                 }
+
+                strPatientId.clear();
+                if ( lobj->findAndGetElement ( DCM_PatientID, lelt ).good() ) {
+                    lelt->getOFStringArray ( strPatientId );
+                }
             }
 
             if ( ( cur == Study ) && proceed ){
@@ -190,6 +196,8 @@ void QtDcmFindDicomdir::findStudies (const QString &patientName)
                     lelt->getOFStringArray ( strDate );
                     infosMap.insert ( "Date", QString ( strDate.c_str() ) );
                 }
+
+                infosMap.insert ( "PatientID", QString ( strPatientId.c_str() ) );
                 QtDcmManager::instance()->foundStudy ( infosMap );
             }
 
@@ -223,6 +231,7 @@ void QtDcmFindDicomdir::findSeries (const QString &patientName, const QString &s
     OFString strName;
 
     OFString strDate;
+    OFString strStudyUid;
     //Unstacking and loading the different lists
 
     while ( d->dicomdirItems.card() > 0 ) {
@@ -250,9 +259,8 @@ void QtDcmFindDicomdir::findSeries (const QString &patientName, const QString &s
             if ( cur == Study ) {
                 DcmElement* lelt;
                 if ( lobj->findAndGetElement ( DCM_StudyInstanceUID, lelt ).good() ) {
-                    OFString strUid;
-                    lelt->getOFStringArray ( strUid );
-                    proceed = ( ( QString ( strName.c_str() ) == patientName ) && ( QString ( strUid.c_str() ) == studyUid ) );
+                    lelt->getOFStringArray ( strStudyUid );
+                    proceed = ( ( QString ( strName.c_str() ) == patientName ) && ( QString ( strStudyUid.c_str() ) == studyUid ) );
                 }
 
                 if ( lobj->findAndGetElement ( DCM_StudyDate, lelt ).good() ) {
@@ -301,6 +309,7 @@ void QtDcmFindDicomdir::findSeries (const QString &patientName, const QString &s
                 }
 
                 infosMap.insert ( "Date", QString ( strDate.c_str() ) );
+                infosMap.insert ( "StudyInstanceUID", QString ( strStudyUid.c_str() ) );
 
                 QtDcmManager::instance()->foundSerie ( infosMap );
             }
@@ -369,7 +378,7 @@ void QtDcmFindDicomdir::findImages (const QString &seriesUID)
                 if ( lobj->findAndGetElement ( DCM_ReferencedSOPInstanceUIDInFile, lelt ).good() ) {
                     lelt->getOFStringArray ( strUID );
                 }
-                QtDcmManager::instance()->foundImage ( QString ( strUID.c_str() ), QString ( strNumber.c_str() ).toInt() );
+                QtDcmManager::instance()->foundImage ( QString ( strUID.c_str() ), QString ( strNumber.c_str() ).toInt(), seriesUID );
             }
 
             dirent.pop();
@@ -0,0 +1,149 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmManager.h>
+#include <QtDcmMediaIndex.h>
+#include <QtDcmFindMediaIndex.h>
+
+class QtDcmFindMediaIndexPrivate
+{
+
+public:
+    const QtDcmMediaIndex * index;
+};
+
+QtDcmFindMediaIndex::QtDcmFindMediaIndex ( QObject * parent )
+    : QObject(parent),
+      d ( new QtDcmFindMediaIndexPrivate )
+{
+  d->index = NULL;
+}
+
+QtDcmFindMediaIndex::~QtDcmFindMediaIndex()
+{
+  delete d;
+  d = NULL;
+}
+
+void QtDcmFindMediaIndex::setMediaIndex ( const QtDcmMediaIndex * index )
+{
+    d->index = index;
+}
+
+void QtDcmFindMediaIndex::findPatients()
+{
+    if ( !d->index ) {
+        return;
+    }
+
+    for ( int p = 0; p < d->index->patientCount(); p++ ) {
+        const QtDcmMediaIndex::PatientRecord & patient = d->index->patient ( p );
+
+        QMap<QString, QString> infosMap;
+        infosMap.insert ( "Name", d->index->string ( patient.name ) );
+        infosMap.insert ( "ID", d->index->string ( patient.id ) );
+        infosMap.insert ( "Birthdate", d->index->string ( patient.birthdate ) );
+        infosMap.insert ( "Sex", d->index->string ( patient.sex ) );
+
+        QtDcmManager::instance()->foundPatient ( infosMap );
+    }
+}
+
+void QtDcmFindMediaIndex::findStudies ( const QString &patientId, const QString &patientName )
+{
+    if ( !d->index ) {
+        return;
+    }
+
+    for ( int p = 0; p < d->index->patientCount(); p++ ) {
+        const QtDcmMediaIndex::PatientRecord & patient = d->index->patient ( p );
+        if ( d->index->string ( patient.id ) != patientId || d->index->string ( patient.name ) != patientName ) {
+            continue;
+        }
+
+        for ( quint32 s = patient.firstStudy; s < patient.firstStudy + patient.studyCount; s++ ) {
+            const QtDcmMediaIndex::StudyRecord & study = d->index->study ( s );
+
+            QMap<QString, QString> infosMap;
+            infosMap.insert ( "UID", d->index->string ( study.uid ) );
+            infosMap.insert ( "ID", d->index->string ( study.id ) );
+            infosMap.insert ( "Description", d->index->string ( study.description ) );
+            infosMap.insert ( "Date", d->index->string ( study.date ) );
+            infosMap.insert ( "PatientID", d->index->string ( patient.id ) );
+
+            QtDcmManager::instance()->foundStudy ( infosMap );
+        }
+    }
+}
+
+void QtDcmFindMediaIndex::findSeries ( const QString &patientId, const QString &patientName, const QString &studyUid )
+{
+    if ( !d->index ) {
+        return;
+    }
+
+    for ( int s = 0; s < d->index->studyCount(); s++ ) {
+        const QtDcmMediaIndex::StudyRecord & study = d->index->study ( s );
+        if ( d->index->string ( study.uid ) != studyUid ) {
+            continue;
+        }
+
+        const QtDcmMediaIndex::PatientRecord & patient = d->index->patient ( study.patient );
+        if ( d->index->string ( patient.id ) != patientId || d->index->string ( patient.name ) != patientName ) {
+            continue;
+        }
+
+        for ( quint32 i = study.firstSeries; i < study.firstSeries + study.seriesCount; i++ ) {
+            const QtDcmMediaIndex::SeriesRecord & serie = d->index->serie ( i );
+
+            QMap<QString, QString> infosMap;
+            infosMap.insert ( "ID", d->index->string ( serie.uid ) );
+            infosMap.insert ( "Description", d->index->string ( serie.description ) );
+            infosMap.insert ( "Modality", d->index->string ( serie.modality ) );
+            infosMap.insert ( "Institution", d->index->string ( serie.institution ) );
+            infosMap.insert ( "InstanceCount", QString::number ( serie.instanceCount ) );
+            infosMap.insert ( "Operator", d->index->string ( serie.performingPhysician ) );
+            infosMap.insert ( "Date", d->index->string ( study.date ) );
+            infosMap.insert ( "StudyInstanceUID", studyUid );
+
+            QtDcmManager::instance()->foundSerie ( infosMap );
+        }
+    }
+}
+
+void QtDcmFindMediaIndex::findImages ( const QString &seriesUID )
+{
+    if ( !d->index ) {
+        return;
+    }
+
+    const int s = d->index->findSerie ( seriesUID );
+    if ( s < 0 ) {
+        return;
+    }
+
+    const QtDcmMediaIndex::SeriesRecord & serie = d->index->serie ( s );
+    for ( quint32 i = serie.firstInstance; i < serie.firstInstance + serie.instanceCount; i++ ) {
+        const QtDcmMediaIndex::InstanceRecord & image = d->index->instance ( i );
+        QtDcmManager::instance()->foundImage ( d->index->string ( image.uid ), image.number, seriesUID );
+    }
+}
@@ -0,0 +1,59 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMFINDMEDIAINDEX_H_
+#define QTDCMFINDMEDIAINDEX_H_
+
+#include <QtGui>
+
+class QtDcmMediaIndex;
+
+class QtDcmFindMediaIndexPrivate;
+
+/**
+ * Same as QtDcmFindDicomdir, but browses a QtDcmMediaIndex built by QtDcmMediaScanner
+ */
+class QtDcmFindMediaIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    QtDcmFindMediaIndex ( QObject * parent = 0);
+    virtual ~QtDcmFindMediaIndex();
+
+    void setMediaIndex ( const QtDcmMediaIndex * index );
+
+    void findPatients();
+
+    /**
+     * Patients are matched on their PatientID and name, as they are grouped in the index,
+     * so that two patients with the same name are not merged
+     */
+    void findStudies ( const QString & patientId, const QString & patientName );
+
+    void findSeries ( const QString & patientId, const QString & patientName, const QString & studyUid );
+
+    void findImages ( const QString & seriesUID );
+
+private:
+    QtDcmFindMediaIndexPrivate * d;
+};
+
+#endif /* QTDCMFINDMEDIAINDEX_H_ */
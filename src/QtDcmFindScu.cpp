@@ -175,7 +175,7 @@ void QtDcmFindScu::findSeriesScu (const QString &studyUID, const QString &studyD
     doQuery ( overrideKeys, QtDcmFindCallback::SERIE , UID_FINDStudyRootQueryRetrieveInformationModel);
 }
 
-void QtDcmFindScu::findImagesScu (const QString &seriesUID)
+void QtDcmFindScu::findImagesScu (const QString &seriesUID, int instanceNumber, int maxResponses)
 {
     OFList<OFString> overrideKeys;
     overrideKeys.push_back ( ( QString ( "QueryRetrieveLevel=" ) + QString ( "" "IMAGE" "" ) ).toUtf8().data() );
@@ -185,9 +185,14 @@ void QtDcmFindScu::findImagesScu (const QString &seriesUID)
 
     //Image level
     overrideKeys.push_back ( QString ( "SOPInstanceUID" ).toUtf8().data() );
-    overrideKeys.push_back ( QString ( "InstanceNumber" ).toUtf8().data() );
+    if ( instanceNumber > 0 ) {
+        overrideKeys.push_back ( QString ( "InstanceNumber=" + QString::number ( instanceNumber ) ).toUtf8().data() );
+    }
+    else {
+        overrideKeys.push_back ( QString ( "InstanceNumber" ).toUtf8().data() );
+    }
 
-    doQuery ( overrideKeys, QtDcmFindCallback::IMAGES );
+    doQuery ( overrideKeys, QtDcmFindCallback::IMAGES, UID_FINDPatientRootQueryRetrieveInformationModel, maxResponses );
 }
 
 void QtDcmFindScu::findImageScu (const QString &imageUID)
@@ -219,7 +224,7 @@ bool QtDcmFindScu::checkServerConnection ( int timeout )
     return result;
 }
 
-bool QtDcmFindScu::doQuery ( const OFList<OFString>& overrideKeys, QtDcmFindCallback::cbType level, QString queryRetrieveInfoModel )
+bool QtDcmFindScu::doQuery ( const OFList<OFString>& overrideKeys, QtDcmFindCallback::cbType level, QString queryRetrieveInfoModel, int maxResponses )
 {
     //Image level
     OFList<OFString> fileNameList;
@@ -250,7 +255,7 @@ bool QtDcmFindScu::doQuery ( const OFList<OFString>& overrideKeys, QtDcmFindCall
                                             false,
                                             1,
                                             DcmFindSCUExtractMode::FEM_none,
-                                            -1,
+                                            maxResponses,
                                             &keys,
                                             &callback,
                                             &fileNameList );
@@ -38,7 +38,13 @@ public:
 
     void findSeriesScu ( const QString & studyUID, const QString & studyDescription, const QString & serieDescription, const QString & modality);
 
-    void findImagesScu ( const QString & seriesUID );
+    /**
+     * Query the instances of a serie
+     *
+     * @param instanceNumber only query the instance with this InstanceNumber, 0 for all of them
+     * @param maxResponses cancel the query once this number of instances has been received, -1 for no limit
+     */
+    void findImagesScu ( const QString & seriesUID, int instanceNumber = 0, int maxResponses = -1 );
     void findImageScu ( const QString & imageUID);
 
     /* ***********************************************************************/
@@ -48,7 +54,7 @@ public:
     void findPatients();
 protected:
 
-    bool doQuery(const OFList<OFString>& overrideKeys, QtDcmFindCallback::cbType level, QString queryRetrieveInfoModel = UID_FINDPatientRootQueryRetrieveInformationModel);
+    bool doQuery(const OFList<OFString>& overrideKeys, QtDcmFindCallback::cbType level, QString queryRetrieveInfoModel = UID_FINDPatientRootQueryRetrieveInformationModel, int maxResponses = -1);
 
     /**
      * test if the current selected pacs is available
@@ -0,0 +1,210 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <cstring>
+
+#include <itk_zlib.h>
+
+#include <QtDcmGzipWriter.h>
+#include <QtDcmThreadBudget.h>
+
+namespace
+{
+const int BlockSize = 1024 * 1024;        /** Uncompressed size of a gzip member */
+const int StoredOverhead = 10 + 5 + 8;    /** gzip header, stored deflate block header, gzip trailer */
+
+/**
+ * Compress one block to a complete gzip member
+ */
+class DeflateTask : public QRunnable
+{
+public:
+    DeflateTask ( const QByteArray & input, QByteArray * output, int level, QAtomicInt * failed )
+        : input ( input ), output ( output ), level ( level ), failed ( failed ) {}
+
+    void run()
+    {
+        z_stream stream;
+        memset ( &stream, 0, sizeof ( stream ) );
+
+        // 16 added to the window bits : gzip header and trailer instead of zlib ones
+        if ( deflateInit2 ( &stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+            failed->storeRelease ( 1 );
+            return;
+        }
+
+        output->resize ( deflateBound ( &stream, input.size() ) );
+        stream.next_in = reinterpret_cast<Bytef *> ( const_cast<char *> ( input.constData() ) );
+        stream.avail_in = input.size();
+        stream.next_out = reinterpret_cast<Bytef *> ( output->data() );
+        stream.avail_out = output->size();
+
+        const int status = deflate ( &stream, Z_FINISH );
+        output->resize ( stream.total_out );
+        deflateEnd ( &stream );
+
+        if ( status != Z_STREAM_END ) {
+            failed->storeRelease ( 1 );
+        }
+    }
+
+private:
+    QByteArray input;
+    QByteArray * output;
+    int level;
+    QAtomicInt * failed;
+};
+
+void putLittleEndian ( char * destination, quint32 value, int size )
+{
+    for ( int i = 0; i < size; i++ ) {
+        destination[i] = char ( ( value >> ( 8 * i ) ) & 0xff );
+    }
+}
+}
+
+class QtDcmGzipWriter::Private
+{
+public:
+    QIODevice * device;
+    int level;
+    QThreadPool pool;
+    int batchSize;                  /** Blocks compressed at a time, a few per thread */
+    QVector<QByteArray> blocks;     /** Blocks to compress */
+    bool borrowed;                  /** Some blocks point to the data given to write() */
+    QByteArray pending;             /** Incomplete block, kept until the next write */
+
+    bool compressBlocks();
+};
+
+bool QtDcmGzipWriter::Private::compressBlocks()
+{
+    QAtomicInt failed ( 0 );
+    QVector<QByteArray> compressed ( blocks.size() );
+    for ( int i = 0; i < blocks.size(); i++ ) {
+        pool.start ( new DeflateTask ( blocks.at ( i ), &compressed[i], level, &failed ) );
+    }
+    pool.waitForDone();
+    blocks.clear();
+    borrowed = false;
+
+    if ( failed.loadAcquire() ) {
+        qWarning() << "Cannot compress a gzip block";
+        return false;
+    }
+
+    // Written in order once all are compressed
+    for ( const QByteArray & block : compressed ) {
+        if ( device->write ( block ) != block.size() ) {
+            qWarning() << "Cannot write a gzip block";
+            return false;
+        }
+    }
+    return true;
+}
+
+QtDcmGzipWriter::QtDcmGzipWriter ( QIODevice * device, int level, int threadCount ) : d ( new QtDcmGzipWriter::Private )
+{
+    d->device = device;
+    d->level = qBound ( 0, level, 9 );
+    d->pool.setMaxThreadCount ( ( threadCount > 0 ) ? threadCount : QtDcmThreadBudget::threadsPerConversion() );
+    d->batchSize = 2 * d->pool.maxThreadCount();
+    d->borrowed = false;
+}
+
+QtDcmGzipWriter::~QtDcmGzipWriter()
+{
+    delete d;
+    d = NULL;
+}
+
+bool QtDcmGzipWriter::write ( const char * data, qint64 size )
+{
+    while ( size > 0 ) {
+        if ( !d->pending.isEmpty() || size < BlockSize ) {
+            const int count = int ( qMin<qint64> ( BlockSize - d->pending.size(), size ) );
+            d->pending.append ( data, count );
+            data += count;
+            size -= count;
+            if ( d->pending.size() == BlockSize ) {
+                d->blocks.append ( d->pending );
+                d->pending.clear();
+            }
+        }
+        else {
+            // Whole blocks are compressed from the data itself, without a copy
+            d->blocks.append ( QByteArray::fromRawData ( data, BlockSize ) );
+            d->borrowed = true;
+            data += BlockSize;
+            size -= BlockSize;
+        }
+
+        if ( d->blocks.size() == d->batchSize && !d->compressBlocks() ) {
+            return false;
+        }
+    }
+
+    // The blocks must not outlive the data they point to, the copied ones wait for a whole batch
+    return !d->borrowed || d->compressBlocks();
+}
+
+bool QtDcmGzipWriter::flush()
+{
+    if ( !d->pending.isEmpty() ) {
+        d->blocks.append ( d->pending );
+        d->pending.clear();
+    }
+    return d->compressBlocks();
+}
+
+QByteArray QtDcmGzipWriter::storedMember ( const QByteArray & data )
+{
+    // A single stored block holds at most 65535 bytes
+    Q_ASSERT ( data.size() <= 0xffff );
+
+    QByteArray member ( storedMemberSize ( data.size() ), '\0' );
+    char * m = member.data();
+
+    // Header : magic, deflate, no flags, no time, no extra flags, unknown OS
+    m[0] = char ( 0x1f );
+    m[1] = char ( 0x8b );
+    m[2] = 8;
+    m[9] = char ( 0xff );
+
+    // Final stored block, its length and the complement of its length
+    m[10] = 1;
+    putLittleEndian ( m + 11, data.size(), 2 );
+    putLittleEndian ( m + 13, ~quint32 ( data.size() ), 2 );
+    memcpy ( m + 15, data.constData(), data.size() );
+
+    const uLong crc = crc32 ( crc32 ( 0L, Z_NULL, 0 ), reinterpret_cast<const Bytef *> ( data.constData() ), data.size() );
+    putLittleEndian ( m + 15 + data.size(), quint32 ( crc ), 4 );
+    putLittleEndian ( m + 19 + data.size(), quint32 ( data.size() ), 4 );
+
+    return member;
+}
+
+int QtDcmGzipWriter::storedMemberSize ( int dataSize )
+{
+    return StoredOverhead + dataSize;
+}
@@ -0,0 +1,69 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMGZIPWRITER_H
+#define QTDCMGZIPWRITER_H
+
+#include <QtGui>
+
+/**
+ * This class writes gzip data to a device as a sequence of members, each one a block of
+ * the input compressed on its own. The blocks are thus compressed in parallel (as pigz does),
+ * and any gzip reader decompresses the members as a single stream.
+ *
+ * The data is compressed as it is written, only a few blocks per thread are in memory.
+ */
+class QtDcmGzipWriter
+{
+public:
+    /**
+     * @param device opened device the members are written to
+     * @param level 0 to 9
+     * @param threadCount number of compressing threads, QtDcmThreadBudget::threadsPerConversion() if 0
+     */
+    QtDcmGzipWriter ( QIODevice * device, int level, int threadCount = 0 );
+    virtual ~QtDcmGzipWriter();
+
+    /**
+     * Compress and write data. The last incomplete block, and the blocks copied from it until
+     * there are enough for all the threads, are kept for the next calls or flush().
+     */
+    bool write ( const char * data, qint64 size );
+
+    /**
+     * Compress and write the data kept by write()
+     */
+    bool flush();
+
+    /**
+     * A gzip member holding data without compression, its size only depends on the size of data
+     * (storedMemberSize()), so that it can be written in a space reserved beforehand
+     */
+    static QByteArray storedMember ( const QByteArray & data );
+    static int storedMemberSize ( int dataSize );
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmGzipWriter )
+};
+
+#endif // QTDCMGZIPWRITER_H
@@ -1,40 +1,47 @@
 /*
     QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
     Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
-    
+
     This library is free software; you can redistribute it and/or
     modify it under the terms of the GNU Lesser General Public
     License as published by the Free Software Foundation; either
     version 2.1 of the License, or (at your option) any later version.
-    
+
     This library is distributed in the hope that it will be useful,
     but WITHOUT ANY WARRANTY; without even the implied warranty of
     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
     Lesser General Public License for more details.
-    
+
     You should have received a copy of the GNU Lesser General Public
     License along with this library; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-
-
-#include <QtDcmSerie.h>
 #include <QtDcmImage.h>
 
-class QtDcmImage::Private
+class QtDcmImage::Private : public QSharedData
 {
 public:
+    Private() : number ( 0 ) {}
+
     QString id; /** Dicom ID of the image */
     QString filename; /** Filename path of the dicom image */
-    QtDcmSerie serie; /** Parent serie */
+    int number; /** Instance number of the image */
+    QString serieUid; /** Uid of the parent serie */
 };
 
 QtDcmImage::QtDcmImage() : d(new QtDcmImage::Private) {}
 
+QtDcmImage::QtDcmImage ( const QtDcmImage & other ) : d ( other.d ) {}
+
 QtDcmImage::~QtDcmImage()
 {
-    delete d;
+}
+
+QtDcmImage & QtDcmImage::operator= ( const QtDcmImage & other )
+{
+    d = other.d;
+    return *this;
 }
 
 QString QtDcmImage::id() const
@@ -57,12 +64,22 @@ void QtDcmImage::setFilename( const QString & filename )
     d->filename = filename;
 }
 
-QtDcmSerie QtDcmImage::serie() const
+int QtDcmImage::number() const
+{
+    return d->number;
+}
+
+void QtDcmImage::setNumber ( int number )
+{
+    d->number = number;
+}
+
+QString QtDcmImage::serieUid() const
 {
-    return d->serie;
+    return d->serieUid;
 }
 
-void QtDcmImage::setSerie( const QtDcmSerie & serie )
+void QtDcmImage::setSerieUid( const QString & uid )
 {
-    d->serie = serie;
+    d->serieUid = uid;
 }
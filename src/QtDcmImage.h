@@ -1,17 +1,17 @@
 /*
     QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
     Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
-    
+
     This library is free software; you can redistribute it and/or
     modify it under the terms of the GNU Lesser General Public
     License as published by the Free Software Foundation; either
     version 2.1 of the License, or (at your option) any later version.
-    
+
     This library is distributed in the hope that it will be useful,
     but WITHOUT ANY WARRANTY; without even the implied warranty of
     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
     Lesser General Public License for more details.
-    
+
     You should have received a copy of the GNU Lesser General Public
     License along with this library; if not, write to the Free Software
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
@@ -22,12 +22,11 @@
 
 #include <QtGui>
 
-class QtDcmSerie;
-
 /**
- * This class is a representation of a dicom image. It contains dicom id and filename of the image.
- * There is also a pointer to the parent serie (not used for the moment)
+ * This class is a representation of a dicom image. It contains dicom id and filename of the image,
+ * and the uid of its parent serie.
  *
+ * The image is implicitly shared : copies are cheap and only detach when modified.
  */
 
 class QtDcmImage
@@ -38,16 +37,20 @@ public:
      * Default constructor
      */
     QtDcmImage();
-    
+
+    QtDcmImage ( const QtDcmImage & other );
+
     /**
      * Default destructor
      */
-    virtual ~QtDcmImage();
-    
+    ~QtDcmImage();
+
+    QtDcmImage & operator= ( const QtDcmImage & other );
+
     /**
      * Id getter
      *
-     * @return _id
+     * @return the SOPInstanceUID
      */
     QString id() const;
     /**
@@ -70,26 +73,42 @@ public:
      * @param filename a QString containing absolute path
      */
     void setFilename ( const QString & filename );
-    
+
+    /**
+     * Instance number getter
+     *
+     * @return the InstanceNumber, 0 if unknown
+     */
+    int number() const;
+
+    /**
+     * Instance number setter
+     *
+     * @param number the InstanceNumber
+     */
+    void setNumber ( int number );
+
     /**
      * Parent serie getter
      *
-     * @return _p_serie the pointer on the parent serie object
+     * @return the SeriesInstanceUID of the parent serie
      * @see QtDcmSerie
      */
-    QtDcmSerie serie() const;
-    
+    QString serieUid() const;
+
     /**
      * Parent serie setter
      *
-     * @param serie a pointer on the parent serie object
+     * @param uid the SeriesInstanceUID of the parent serie
      * @see QtDcmSerie
      */
-    void setSerie ( const QtDcmSerie & serie );
+    void setSerieUid ( const QString & uid );
     
 private:
     class Private;
-    Private * d;
+    QSharedDataPointer<Private> d;
 };
 
+Q_DECLARE_TYPEINFO ( QtDcmImage, Q_MOVABLE_TYPE );
+
 #endif /* QTDCMIMAGE_H_ */
@@ -0,0 +1,329 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <itkImage.h>
+#include <itkImageFileWriter.h>
+#include <itkImageIOFactory.h>
+#include <itkRGBPixel.h>
+
+#include <QtDcmGzipWriter.h>
+#include <QtDcmNiftiWriter.h>
+#include <QtDcmThreadBudget.h>
+#include <QtDcmImageWriter.h>
+
+namespace
+{
+const int BlockSize = 1024 * 1024;        /** Size of the blocks read by gzip() if the input can't be mapped */
+
+/**
+ * QtDcmVolume component type of the pixel types of the conversion
+ */
+template <typename PixelType> struct ComponentType;
+template <> struct ComponentType<unsigned char> { static const QtDcmVolume::eComponentType type = QtDcmVolume::UINT8; static const int components = 1; };
+template <> struct ComponentType<char> { static const QtDcmVolume::eComponentType type = QtDcmVolume::INT8; static const int components = 1; };
+template <> struct ComponentType<signed char> { static const QtDcmVolume::eComponentType type = QtDcmVolume::INT8; static const int components = 1; };
+template <> struct ComponentType<unsigned short> { static const QtDcmVolume::eComponentType type = QtDcmVolume::UINT16; static const int components = 1; };
+template <> struct ComponentType<signed short> { static const QtDcmVolume::eComponentType type = QtDcmVolume::INT16; static const int components = 1; };
+template <> struct ComponentType<unsigned int> { static const QtDcmVolume::eComponentType type = QtDcmVolume::UINT32; static const int components = 1; };
+template <> struct ComponentType<int> { static const QtDcmVolume::eComponentType type = QtDcmVolume::INT32; static const int components = 1; };
+template <> struct ComponentType<float> { static const QtDcmVolume::eComponentType type = QtDcmVolume::FLOAT32; static const int components = 1; };
+template <> struct ComponentType<double> { static const QtDcmVolume::eComponentType type = QtDcmVolume::FLOAT64; static const int components = 1; };
+template <> struct ComponentType< itk::RGBPixel<unsigned char> > { static const QtDcmVolume::eComponentType type = QtDcmVolume::UINT8; static const int components = 3; };
+
+/**
+ * Write a .nii.gz straight from the image buffer, compressed in parallel as it is written
+ */
+template <typename ImageType>
+bool writeCompressedNifti ( ImageType * image, const QString & filename, int compressionLevel )
+{
+    typedef ComponentType<typename ImageType::PixelType>   Component;
+
+    const typename ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    int dimensions[4] = { 1, 1, 1, 1 };
+    qint64 pixelCount = 1;
+    for ( unsigned int i = 0; i < ImageType::ImageDimension && i < 4; i++ ) {
+        dimensions[i] = size[i];
+        pixelCount *= size[i];
+    }
+
+    double spacing[3];
+    double origin[3];
+    double direction[3][3];
+    for ( unsigned int i = 0; i < 3; i++ ) {
+        spacing[i] = image->GetSpacing()[i];
+        origin[i] = image->GetOrigin()[i];
+        for ( unsigned int j = 0; j < 3; j++ ) {
+            direction[i][j] = image->GetDirection() ( i, j );
+        }
+    }
+
+    QtDcmNiftiWriter writer;
+    writer.setDatatype ( QtDcmNiftiWriter::datatype ( Component::type, Component::components ) );
+    writer.setDimensions ( dimensions[0], dimensions[1], dimensions[2], dimensions[3] );
+    writer.setSpacing ( spacing[0], spacing[1], spacing[2] );
+    writer.setOrigin ( origin );
+    writer.setDirection ( direction );
+    writer.setCompressionLevel ( compressionLevel );
+
+    return writer.open ( filename )
+           && writer.writeData ( reinterpret_cast<const char *> ( image->GetBufferPointer() ),
+                                 pixelCount * sizeof ( typename ImageType::PixelType ) )
+           && writer.close();
+}
+
+template <typename ImageType>
+bool writeImage ( ImageType * image, const QString & filename, int compressionLevel )
+{
+    typedef itk::ImageFileWriter< ImageType >   WriterType;
+
+    if ( filename.endsWith ( ".nii.gz" ) ) {
+        try {
+            image->Update();
+        }
+        catch ( itk::ExceptionObject &ex ) {
+            qCritical() << ex.GetDescription();
+            return false;
+        }
+        return writeCompressedNifti ( image, filename, compressionLevel );
+    }
+
+    // The image is moved over filename once complete : a failed writing leaves no truncated output,
+    // and a previous output hard linked by QtDcmConversionCache is never written through
+    const QString writtenFilename = QtDcmImageWriter::temporaryFilename ( filename );
+
+    typename WriterType::Pointer writer = WriterType::New();
+    writer->SetFileName ( writtenFilename.toStdString() );
+    writer->SetInput ( image );
+    writer->SetNumberOfWorkUnits ( QtDcmThreadBudget::threadsPerConversion() );
+
+    if ( compressionLevel > 0 ) {
+        itk::ImageIOBase::Pointer io = itk::ImageIOFactory::CreateImageIO ( filename.toStdString().c_str(), itk::IOFileModeEnum::WriteMode );
+        if ( io ) {
+            io->SetCompressionLevel ( compressionLevel );
+            writer->SetImageIO ( io );
+        }
+        writer->SetUseCompression ( true );
+    }
+
+    try {
+        writer->Update();
+    }
+    catch ( itk::ExceptionObject &ex ) {
+        qCritical() << ex.GetDescription();
+        QFile::remove ( writtenFilename );
+        return false;
+    }
+
+    return QtDcmImageWriter::replace ( writtenFilename, filename );
+}
+
+template <typename ImageType>
+QtDcmVolume imageVolume ( ImageType * image )
+{
+    typedef ComponentType<typename ImageType::PixelType>   Component;
+
+    image->Register();
+    const QSharedPointer<const void> owner ( image, [] ( ImageType * pointer ) {
+        pointer->UnRegister();
+    } );
+
+    QtDcmVolume volume ( image->GetBufferPointer(), owner );
+    volume.setComponentType ( Component::type, Component::components );
+
+    const typename ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+    int sizes[4] = { 1, 1, 1, 1 };
+    for ( unsigned int i = 0; i < ImageType::ImageDimension && i < 4; i++ ) {
+        sizes[i] = size[i];
+        volume.setSpacing ( i, image->GetSpacing()[i] );
+        volume.setOrigin ( i, image->GetOrigin()[i] );
+    }
+    volume.setSize ( sizes[0], sizes[1], sizes[2], sizes[3] );
+
+    for ( unsigned int i = 0; i < 3 && i < ImageType::ImageDimension; i++ ) {
+        for ( unsigned int j = 0; j < 3 && j < ImageType::ImageDimension; j++ ) {
+            volume.setDirection ( i, j, image->GetDirection() ( i, j ) );
+        }
+    }
+
+    return volume;
+}
+
+struct WriteOperation
+{
+    QString filename;
+    int compressionLevel;
+    bool success;
+
+    template <typename ImageType>
+    void operator() ( ImageType * image )
+    {
+        success = writeImage ( image, filename, compressionLevel );
+    }
+};
+
+struct VolumeOperation
+{
+    QtDcmVolume volume;
+
+    template <typename ImageType>
+    void operator() ( ImageType * image )
+    {
+        volume = imageVolume ( image );
+    }
+};
+
+/**
+ * Apply the operation to the image if it has this pixel type
+ */
+template <typename PixelType, unsigned int Dimension, typename Operation>
+bool apply ( itk::ImageBase<Dimension> * image, Operation & operation )
+{
+    typedef itk::Image< PixelType, Dimension >      ImageType;
+
+    ImageType * typed = dynamic_cast<ImageType *> ( image );
+    if ( typed ) {
+        operation ( typed );
+    }
+    return typed != NULL;
+}
+
+/**
+ * Apply the operation to the image, whatever the pixel type of the conversion it has
+ *
+ * @return false if the pixel type is not one of the conversion
+ */
+template <unsigned int Dimension, typename Operation>
+bool visit ( itk::ImageBase<Dimension> * image, Operation & operation )
+{
+    return apply<unsigned char> ( image, operation ) || apply<char> ( image, operation )
+           || apply<signed char> ( image, operation ) || apply<unsigned short> ( image, operation )
+           || apply<signed short> ( image, operation ) || apply<unsigned int> ( image, operation )
+           || apply<int> ( image, operation ) || apply<float> ( image, operation )
+           || apply<double> ( image, operation ) || apply< itk::RGBPixel<unsigned char> > ( image, operation );
+}
+
+template <unsigned int Dimension>
+bool writeAny ( itk::ImageBase<Dimension> * image, const QString & filename, int compressionLevel )
+{
+    WriteOperation operation;
+    operation.filename = filename;
+    operation.compressionLevel = compressionLevel;
+    operation.success = false;
+    if ( !image || !visit ( image, operation ) ) {
+        qWarning() << "Unsupported pixel type, cannot write" << filename;
+        return false;
+    }
+    return operation.success;
+}
+
+template <unsigned int Dimension>
+QtDcmVolume volumeAny ( itk::ImageBase<Dimension> * image )
+{
+    VolumeOperation operation;
+    if ( image ) {
+        visit ( image, operation );
+    }
+    return operation.volume;
+}
+}
+
+bool QtDcmImageWriter::write ( itk::ImageBase<3> * image, const QString & filename, int compressionLevel )
+{
+    return writeAny ( image, filename, compressionLevel );
+}
+
+bool QtDcmImageWriter::write ( itk::ImageBase<4> * image, const QString & filename, int compressionLevel )
+{
+    return writeAny ( image, filename, compressionLevel );
+}
+
+QtDcmVolume QtDcmImageWriter::toVolume ( itk::ImageBase<3> * image )
+{
+    return volumeAny ( image );
+}
+
+QtDcmVolume QtDcmImageWriter::toVolume ( itk::ImageBase<4> * image )
+{
+    return volumeAny ( image );
+}
+
+QString QtDcmImageWriter::temporaryFilename ( const QString & filename )
+{
+    // Several conversions of the process may write next to each other
+    static QAtomicInt counter;
+
+    const QFileInfo info ( filename );
+    return info.dir().absoluteFilePath ( QString ( ".%1-%2.%3" ).arg ( QCoreApplication::applicationPid() )
+                                                                .arg ( counter.fetchAndAddRelaxed ( 1 ) )
+                                                                .arg ( info.fileName() ) );
+}
+
+bool QtDcmImageWriter::replace ( const QString & temporary, const QString & filename )
+{
+    QFile::remove ( filename );
+    if ( !QFile::rename ( temporary, filename ) ) {
+        qWarning() << "Cannot write" << filename;
+        QFile::remove ( temporary );
+        return false;
+    }
+    return true;
+}
+
+bool QtDcmImageWriter::gzip ( const QString & input, const QString & output, int level, int threadCount )
+{
+    QFile in ( input );
+    if ( !in.open ( QIODevice::ReadOnly ) ) {
+        qWarning() << "Cannot read" << input;
+        return false;
+    }
+
+    QSaveFile out ( output );
+    if ( !out.open ( QIODevice::WriteOnly ) ) {
+        qWarning() << "Cannot write" << output;
+        return false;
+    }
+
+    QtDcmGzipWriter writer ( &out, level, threadCount );
+
+    // Compressed straight from the mapped file if possible
+    const uchar * data = ( in.size() > 0 ) ? in.map ( 0, in.size() ) : NULL;
+    if ( data && !writer.write ( reinterpret_cast<const char *> ( data ), in.size() ) ) {
+        qWarning() << "Cannot compress" << input;
+        out.cancelWriting();
+        return false;
+    }
+
+    while ( !data && !in.atEnd() ) {
+        const QByteArray block = in.read ( BlockSize );
+        if ( block.isEmpty() || !writer.write ( block.constData(), block.size() ) ) {
+            qWarning() << "Cannot compress" << input;
+            out.cancelWriting();
+            return false;
+        }
+    }
+
+    if ( !writer.flush() ) {
+        out.cancelWriting();
+        return false;
+    }
+    return out.commit();
+}
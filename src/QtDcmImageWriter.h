@@ -0,0 +1,91 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMIMAGEWRITER_H
+#define QTDCMIMAGEWRITER_H
+
+#include <QtGui>
+
+#include <QtDcmVolume.h>
+
+namespace itk
+{
+template <unsigned int VImageDimension> class ImageBase;
+}
+
+/**
+ * Writes the converted images in the output format given by their extension
+ * (.nii, .nii.gz, .nrrd, .mha...), compressed with the given level.
+ *
+ * ITK compresses on a single thread. A .nii.gz is therefore compressed from the image
+ * buffer by blocks on a thread pool, each block being a gzip member of the final file
+ * (as pigz does), which any gzip reader decompresses as a single stream.
+ *
+ * The images are the ITK images of the conversion, of the pixel types it produces
+ * (8, 16 or 32 bits integers, float, double and 8 bits RGB), in 3 or 4 dimensions.
+ * Only forward declared here, so that this header does not need the ITK headers.
+ */
+class QtDcmImageWriter
+{
+public:
+    /**
+     * Write an image
+     *
+     * @param image the image, its pipeline is updated if needed
+     * @param filename output file, the format is given by the extension
+     * @param compressionLevel 0 (no compression) to 9, ignored by the formats that have no compression
+     * @return false if the writing failed or the pixel type is not supported
+     */
+    static bool write ( itk::ImageBase<3> * image, const QString & filename, int compressionLevel );
+    static bool write ( itk::ImageBase<4> * image, const QString & filename, int compressionLevel );
+
+    /**
+     * Compress a file to gzip format by blocks, in parallel
+     *
+     * @param input the file to compress, left untouched
+     * @param output the compressed file
+     * @param level 0 to 9
+     * @param threadCount number of compressing threads, QtDcmThreadBudget::threadsPerConversion() if 0
+     * @return false if a file could not be read or written
+     */
+    static bool gzip ( const QString & input, const QString & output, int level, int threadCount = 0 );
+
+    /**
+     * Name of a hidden file next to filename and with the same extension, where an output
+     * is written before being moved over filename with replace()
+     */
+    static QString temporaryFilename ( const QString & filename );
+
+    /**
+     * Move a completely written temporary file over filename, the temporary file is removed on failure
+     */
+    static bool replace ( const QString & temporary, const QString & filename );
+
+    /**
+     * Hand an image over as a QtDcmVolume, without copying its buffer.
+     * The volume keeps a reference on the image, which must be up to date.
+     *
+     * @return a null volume if the pixel type is not supported
+     */
+    static QtDcmVolume toVolume ( itk::ImageBase<3> * image );
+    static QtDcmVolume toVolume ( itk::ImageBase<4> * image );
+};
+
+#endif // QTDCMIMAGEWRITER_H
@@ -39,24 +39,50 @@
 
 // For dcm images
 #include <dcmtk/dcmimgle/dcmimage.h>
-#include <dcmtk/dcmdata/dcrledrg.h>      /* for DcmRLEDecoderRegistration */
-#include <dcmtk/dcmjpeg/djdecode.h>     /* for dcmjpeg decoders */
 #include <dcmtk/dcmjpeg/dipijpeg.h>     /* for dcmimage JPEG plugin */
 // For color images
 #include <dcmtk/dcmimage/diregist.h>
 
 #include <QtDcmFindScu.h>
 #include <QtDcmFindDicomdir.h>
+#include <QtDcmFindMediaIndex.h>
+#include <QtDcmMediaIndex.h>
+#include <QtDcmMediaScanner.h>
 #include <QtDcmMoveScu.h>
 #include <QtDcmMoveDicomdir.h>
 #include <QtDcmConvert.h>
-#include <QtDcmConvert.h>
+#include <QtDcmConvertQueue.h>
 #include <QtDcmPreviewWidget.h>
+#include <QtDcmPreviewRenderer.h>
+#include <QtDcmThumbnailCache.h>
+#include <QtDcmPreviewPrefetcher.h>
+#include <QtDcmThreadBudget.h>
 #include <QtDcmImportWidget.h>
 #include <QtDcmSerieInfoWidget.h>
 
 #include <QtDcmManager.h>
 
+namespace
+{
+const int PreviewSize = 130;              /** Previews fit in a PreviewSize x PreviewSize square */
+const int MosaicTileCount = 9;            /** Number of slices of a serie shown by the mosaic */
+
+/**
+ * Decode a dicom file and render its preview, the preview is added to the cache
+ *
+ * @param instanceUid set to the SOPInstanceUID of the file
+ */
+QImage decodePreview ( const QString &filename, QtDcmThumbnailCache * cache, QString * instanceUid )
+{
+    const QImage image = QtDcmPreviewRenderer::renderFile ( filename, PreviewSize, instanceUid );
+    if ( !image.isNull() && !instanceUid->isEmpty() ) {
+        cache->insert ( QtDcmThumbnailCache::key ( *instanceUid, QString::number ( PreviewSize ) ), image );
+    }
+
+    return image;
+}
+}
+
 class QtDcmManagerPrivate
 {
 
@@ -67,7 +93,11 @@ public:
     QDir currentSerieDir;                            /** Directory containing current serie dicom slice */
     QDir tempDir;                                    /** Qtdcm temporary directory (/tmp/qtdcm on Unix) */
     DcmFileFormat dfile;                             /** This attribute is usefull for parsing the dicomdir */
+    QSharedPointer<QtDcmMediaIndex> mediaIndex;      /** Index of a media without dicomdir, replaces dfile when set */
     QList<QtDcmPatient> patients;                  /** List that contains patients resulting of a query or read from a CD */
+    QHash<QString, int> patientIndex;              /** key : patient id => value : position in patients */
+    QHash<QString, QString> studyPatients;         /** key : study uid => value : id of its patient */
+    QHash<QString, QString> serieStudies;          /** key : serie uid => value : uid of its study */
     QStringList images;                           /** List of image filename to export from a CD */
     QStringList listImages;                       /** List of images uid in the current selected serie */
     QMap<int, QString> mapImages;                    /** Map of images (corresponding to listImages) with InstanceNumber tags used as keys */
@@ -96,12 +126,270 @@ public:
     QPointer<QtDcmPreviewWidget> previewWidget;              /** The pointer to the preview widget */
     QPointer<QtDcmImportWidget> importWidget;                /** The pointer to the import widget */
     QPointer<QtDcmSerieInfoWidget> serieInfoWidget;          /** The pointer to the serie info widget */
+    QtDcmThumbnailCache thumbnails;                  /** Previews already rendered, key : SOPInstanceUID and preview size */
+    QThreadPool previewPool;                         /** Decodes the previews out of the GUI thread */
+    QAtomicInt previewRequest;                       /** Number of the latest preview requested, older ones are dropped */
+    QPointer<QtDcmMoveScu> previewMover;             /** Moves the instance of the latest preview requested from the PACS */
+    QPointer<QtDcmPreviewPrefetcher> prefetcher;     /** Retrieves the previews of the series next to the selected one */
+    QList< QPointer<QThread> > stoppingMoves;        /** Cancelled moves, they hold the local port until they are deleted */
+    QList< QPair<QPointer<QThread>, QThread::Priority> > pendingMoves; /** Moves started once the stopping ones are done */
+    QHash<QString, int> mosaicTiles;                 /** key : SOPInstanceUID => value : tile of the mosaic, empty for a single preview */
+    QString previewSerie;                            /** Serie of the latest preview requested */
+    QString previewQuerySerie;                       /** Serie whose instances were only partly queried for its preview */
+    int previewInstanceCount;                        /** Number of instances of previewQuerySerie */
+    int previewIndex;                                /** Instance of the latest preview requested */
 
     bool useConverter;                               /** Use a converter ? */
+    QtDcmConvertQueue * convertQueue;                /** Converts the moved series in the background */
+    QHash<QString, QString> convertedSeries;         /** key : serie uid being converted => value : its dicom directory */
+    QString importedDirectory;                       /** Dicom directory of the last serie imported by the running import */
+    bool importMoving;                               /** The series of the running import are still being moved */
+    QHash<QString, QtDcmSliceManifest> manifests;    /** key : serie uid => value : slices received by the move SCU */
+    QHash<QString, QSharedPointer<QtDcmVolumeAssembler> > volumes; /** key : serie uid => value : volume assembled by the move SCU */
+    bool assembleVolumes;                            /** Build the volumes from the received datasets */
+    bool writeDicomFiles;                            /** Keep the received dicom files in the temporary directory */
+
+    QtDcmFetchModel fetchModel;                      /** Selected patients with the studies and series found for them */
+
+    /**
+     * Render the preview of a file in the pool, it is only shown if no other preview
+     * has been requested in the meantime
+     */
+    void startPreview ( QtDcmManager * manager, const QString &filename, int request );
+
+    void showPreview ( const QImage &image, const QString &instanceUid, int request );
+
+    /**
+     * Prefetch the previews of the series next to a serie of the series tree widget,
+     * if enabled in the preferences
+     */
+    void startPrefetch ( QtDcmManager * manager, const QString &serie );
+
+    /**
+     * Must be called before any move, the prefetcher uses the local port
+     */
+    void cancelPrefetch ( QtDcmManager * manager );
+
+    /**
+     * Cancel a move, it keeps the local port until it has finished
+     */
+    void stopMove ( QtDcmManager * manager, QtDcmMoveScu * mover );
+    void waitForStop ( QtDcmManager * manager, QThread * move );
+
+    /**
+     * Start a move deleted once finished, at once or when the stopped moves have released the local port
+     */
+    void startMove ( QThread * mover, QThread::Priority priority = QThread::InheritPriority );
+    void startPendingMoves();
+
+    /**
+     * Patient of the hierarchy with this id, added if not found yet
+     */
+    QtDcmPatient & patient ( const QString &id );
+
+    /**
+     * Study or serie of the hierarchy, NULL if it has not been found yet
+     */
+    QtDcmStudy * study ( const QString &uid );
+    QtDcmSerie * serie ( const QString &uid );
+
+    void clearPatients();
+};
+
+namespace
+{
+class PreviewTask : public QRunnable
+{
+public:
+    PreviewTask ( QtDcmManager * manager, QtDcmManagerPrivate * d, const QString &filename, int request )
+        : manager ( manager ), d ( d ), filename ( filename ), request ( request ) {}
+
+    void run()
+    {
+        // Superseded while waiting in the pool
+        if ( request != d->previewRequest.loadAcquire() ) {
+            return;
+        }
+
+        QString instanceUid;
+        const QImage image = decodePreview ( filename, &d->thumbnails, &instanceUid );
+        if ( image.isNull() || request != d->previewRequest.loadAcquire() ) {
+            return;
+        }
+
+        // Pixmaps only live in the GUI thread
+        QtDcmManagerPrivate * priv = d;
+        const int id = request;
+        QMetaObject::invokeMethod ( manager, [priv, image, instanceUid, id]() {
+            priv->showPreview ( image, instanceUid, id );
+        }, Qt::QueuedConnection );
+    }
 
-    QHash<QString, QHash<QString, QVariant>> patientData; /** key : patientID => values : [patientName, birthdate, gender and the list of attached studies]*/
-    QHash<QString, QHash<QString, QVariant>> seriesData; /** key : seriesInstanceUID => values : [studyInstanceUID, seriesDescription, modality]*/
+private:
+    QtDcmManager * manager;
+    QtDcmManagerPrivate * d;
+    QString filename;
+    int request;
 };
+}
+
+void QtDcmManagerPrivate::startPreview ( QtDcmManager * manager, const QString &filename, int request )
+{
+    previewPool.start ( new PreviewTask ( manager, this, filename, request ) );
+}
+
+void QtDcmManagerPrivate::startPrefetch ( QtDcmManager * manager, const QString &serie )
+{
+    if ( !QtDcmPreferences::instance()->prefetchPreviews() || mode != QtDcmManager::PACS || !seriesTreeWidget ) {
+        return;
+    }
+
+    QTreeWidgetItem * root = seriesTreeWidget->invisibleRootItem();
+    int index = -1;
+    for ( int i = 0; i < root->childCount() && index < 0; i++ ) {
+        if ( root->child ( i )->text ( 2 ) == serie ) {
+            index = i;
+        }
+    }
+
+    if ( index < 0 ) {
+        return;
+    }
+
+    // The series list is usually browsed downwards, the series below come first
+    QStringList uids;
+    QList<int> instanceCounts;
+    for ( int offset : { 1, 2, -1 } ) {
+        if ( QTreeWidgetItem * item = root->child ( index + offset ) ) {
+            uids.append ( item->text ( 2 ) );
+            instanceCounts.append ( item->data ( 4, 0 ).toInt() );
+        }
+    }
+
+    cancelPrefetch ( manager );
+    if ( uids.isEmpty() ) {
+        return;
+    }
+
+    prefetcher = new QtDcmPreviewPrefetcher ( manager );
+    prefetcher->setSeries ( uids, instanceCounts );
+    prefetcher->setServer ( manager->currentPacs() );
+    prefetcher->setOutputDir ( tempDir.absolutePath() );
+    prefetcher->setCache ( &thumbnails, PreviewSize );
+    QObject::connect ( prefetcher.data(), &QtDcmPreviewPrefetcher::finished,
+                       prefetcher.data(), &QtDcmPreviewPrefetcher::deleteLater );
+    startMove ( prefetcher, QThread::LowestPriority );
+}
+
+void QtDcmManagerPrivate::cancelPrefetch ( QtDcmManager * manager )
+{
+    if ( prefetcher ) {
+        prefetcher->cancel();
+        waitForStop ( manager, prefetcher );
+        prefetcher.clear();
+    }
+}
+
+void QtDcmManagerPrivate::stopMove ( QtDcmManager * manager, QtDcmMoveScu * mover )
+{
+    if ( !mover ) {
+        return;
+    }
+
+    // A move not started yet stops as soon as it starts
+    mover->onStopMove();
+    waitForStop ( manager, mover );
+}
+
+void QtDcmManagerPrivate::waitForStop ( QtDcmManager * manager, QThread * move )
+{
+    if ( move->isRunning() ) {
+        stoppingMoves.append ( move );
+
+        // The moves are deleted on the GUI thread once finished, so this can't be missed
+        QObject::connect ( move, &QObject::destroyed, manager, [this]() {
+            startPendingMoves();
+        } );
+    }
+}
+
+void QtDcmManagerPrivate::startMove ( QThread * mover, QThread::Priority priority )
+{
+    pendingMoves.append ( qMakePair ( QPointer<QThread> ( mover ), priority ) );
+    startPendingMoves();
+}
+
+void QtDcmManagerPrivate::startPendingMoves()
+{
+    stoppingMoves.removeAll ( QPointer<QThread>() );
+    if ( !stoppingMoves.isEmpty() ) {
+        return;
+    }
+
+    const QList< QPair<QPointer<QThread>, QThread::Priority> > moves = pendingMoves;
+    pendingMoves.clear();
+    for ( const QPair<QPointer<QThread>, QThread::Priority> & move : moves ) {
+        if ( move.first ) {
+            move.first->start ( move.second );
+        }
+    }
+}
+
+QtDcmPatient & QtDcmManagerPrivate::patient ( const QString &id )
+{
+    int index = patientIndex.value ( id, -1 );
+    if ( index < 0 ) {
+        QtDcmPatient added;
+        added.setId ( id );
+
+        index = patients.size();
+        patientIndex.insert ( id, index );
+        patients.append ( added );
+    }
+
+    return patients[index];
+}
+
+QtDcmStudy * QtDcmManagerPrivate::study ( const QString &uid )
+{
+    if ( !studyPatients.contains ( uid ) ) {
+        return NULL;
+    }
+
+    return &patient ( studyPatients.value ( uid ) ).study ( uid );
+}
+
+QtDcmSerie * QtDcmManagerPrivate::serie ( const QString &uid )
+{
+    QtDcmStudy * parent = serieStudies.contains ( uid ) ? study ( serieStudies.value ( uid ) ) : NULL;
+    if ( !parent ) {
+        return NULL;
+    }
+
+    return &parent->serie ( uid );
+}
+
+void QtDcmManagerPrivate::clearPatients()
+{
+    patients.clear();
+    patientIndex.clear();
+    studyPatients.clear();
+    serieStudies.clear();
+}
+
+void QtDcmManagerPrivate::showPreview ( const QImage &image, const QString &instanceUid, int request )
+{
+    if ( request != previewRequest.loadAcquire() || !previewWidget ) {
+        return;
+    }
+
+    if ( mosaicTiles.isEmpty() ) {
+        previewWidget->imageLabel->setPixmap ( QPixmap::fromImage ( image ) );
+    }
+    else if ( mosaicTiles.contains ( instanceUid ) ) {
+        previewWidget->setMosaicTile ( mosaicTiles.value ( instanceUid ), image );
+    }
+}
 
 QtDcmManager * QtDcmManager::_instance = 0;
 
@@ -152,12 +440,63 @@ QtDcmManager::QtDcmManager(QObject *parent)
     d->importWidget = NULL;
     d->previewWidget = NULL;
     d->serieInfoWidget = NULL;
+
+    qRegisterMetaType<QtDcmSliceManifest>("QtDcmSliceManifest");
+    qRegisterMetaType< QSharedPointer<QtDcmVolumeAssembler> >("QSharedPointer<QtDcmVolumeAssembler>");
+    qRegisterMetaType< QList<QtDcmVolume> >("QList<QtDcmVolume>");
+    qRegisterMetaType<QtDcmFetchModel>("QtDcmFetchModel");
+    d->assembleVolumes = false;
+    d->writeDicomFiles = true;
+
+    d->previewIndex = 0;
+    d->previewInstanceCount = 0;
+    d->previewPool.setMaxThreadCount ( QtDcmThreadBudget::previewThreads() );
+
+    // The previews are cached from the preview threads, which must not read the preferences
+    d->thumbnails.setDiskBudget ( qint64 ( QtDcmPreferences::instance()->thumbnailCacheSize() ) * 1024 * 1024 );
+    connect ( QtDcmPreferences::instance(), &QtDcmPreferences::preferencesUpdated, this, [this]() {
+        d->thumbnails.setDiskBudget ( qint64 ( QtDcmPreferences::instance()->thumbnailCacheSize() ) * 1024 * 1024 );
+    });
+
+    d->convertQueue = new QtDcmConvertQueue ( this );
+    connect ( d->convertQueue, &QtDcmConvertQueue::conversionStarted,
+              this,            &QtDcmManager::conversionStarted);
+    connect ( d->convertQueue, &QtDcmConvertQueue::conversionFinished,
+              this,            &QtDcmManager::conversionFinished);
+    connect ( d->convertQueue, &QtDcmConvertQueue::filesConverted,
+              this,            &QtDcmManager::filesConverted);
+    connect ( d->convertQueue, &QtDcmConvertQueue::conversionFailed,
+              this,            &QtDcmManager::conversionFailed);
+    connect ( d->convertQueue, &QtDcmConvertQueue::volumesConverted,
+              this,            &QtDcmManager::volumesConverted);
+    connect ( d->convertQueue, &QtDcmConvertQueue::allConversionsFinished,
+              this,            &QtDcmManager::allConversionsFinished);
+    connect ( d->convertQueue, &QtDcmConvertQueue::conversionFinished,
+              this,            &QtDcmManager::onSerieConverted);
+    connect ( d->convertQueue, &QtDcmConvertQueue::conversionFailed, this, [this] ( const QString &serie ) {
+        d->convertedSeries.remove ( serie );
+        this->finishImport();
+    });
+    d->importMoving = false;
+
     //Creation of the temporary directories (/tmp/qtdcm and /tmp/qtdcm/logs)
     this->createTemporaryDirs();
 }
 
 QtDcmManager::~QtDcmManager()
 {   
+    // The running conversions read from the temporary directory
+    d->convertQueue->waitForDone();
+    d->previewRequest.fetchAndAddOrdered ( 1 );
+    d->previewPool.waitForDone();
+    for ( QtDcmPreviewPrefetcher * prefetcher : this->findChildren<QtDcmPreviewPrefetcher *>() ) {
+        prefetcher->cancel();
+        prefetcher->wait();
+    }
+    for ( QtDcmMoveScu * mover : this->findChildren<QtDcmMoveScu *>() ) {
+        mover->onStopMove();
+        mover->wait();
+    }
     this->deleteTemporaryDirs();
     
     QtDcmPreferences::destroy();
@@ -201,6 +540,13 @@ void QtDcmManager::setImportWidget ( QtDcmImportWidget* widget )
 void QtDcmManager::setPreviewWidget ( QtDcmPreviewWidget* widget )
 {
     d->previewWidget = widget;
+    if ( d->previewWidget ) {
+        connect ( d->previewWidget->mosaicButton, &QToolButton::toggled, this, [this](bool){
+            if ( !d->previewSerie.isEmpty() ) {
+                this->getPreviewFromSelectedSerie ( d->previewSerie, d->previewIndex );
+            }
+        });
+    }
 }
 
 void QtDcmManager::setSerieInfoWidget ( QtDcmSerieInfoWidget* widget )
@@ -269,6 +615,7 @@ void QtDcmManager::findPatientsScu()
 {
     if ( d->mainWidget->pacsComboBox->count() ) {
         d->mode = PACS;
+        d->clearPatients();
 
         QtDcmFindScu * finder = new QtDcmFindScu ( this );
         finder->findPatientsScu ( d->patientId, d->patientSex, d->patientName );
@@ -297,8 +644,49 @@ void QtDcmManager::findImagesScu ( const QString &serieInstanceUID )
     delete finder;
 }
 
+int QtDcmManager::findPreviewImageScu ( const QString &uid, int instanceCount )
+{
+    d->previewQuerySerie = uid;
+    d->previewInstanceCount = instanceCount;
+
+    QtDcmFindScu * finder = new QtDcmFindScu ( this );
+    int index = -1;
+
+    if ( instanceCount > 0 ) {
+        const int middle = qMax ( 1, instanceCount / 2 );
+        finder->findImagesScu ( uid, middle, 1 );
+
+        if ( d->listImages.isEmpty() ) {
+            // The instances are not numbered from 1, stop the serie query at the middle instance
+            finder->findImagesScu ( uid, 0, instanceCount / 2 + 1 );
+        }
+
+        if ( d->mapImages.contains ( middle ) ) {
+            index = middle;
+        }
+        else if ( !d->listImages.isEmpty() ) {
+            index = d->listImages.size() - 1;
+        }
+    }
+    else {
+        finder->findImagesScu ( uid );
+        d->previewInstanceCount = d->listImages.size();
+        if ( !d->listImages.isEmpty() ) {
+            index = d->listImages.size() / 2;
+        }
+    }
+
+    delete finder;
+    return index;
+}
+
 void QtDcmManager::foundPatient ( const QMap<QString, QString> &infosMap )
 {
+    QtDcmPatient & patient = d->patient ( infosMap["ID"] );
+    patient.setName ( infosMap["Name"] );
+    patient.setBirthdate ( infosMap["Birthdate"] );
+    patient.setGender ( infosMap["Sex"] );
+
     if ( !d->patientsTreeWidget.isNull() ) {
         QTreeWidgetItem * patientItem = new QTreeWidgetItem ( d->patientsTreeWidget->invisibleRootItem() );
         patientItem->setText ( 0, infosMap["Name"] );
@@ -311,6 +699,13 @@ void QtDcmManager::foundPatient ( const QMap<QString, QString> &infosMap )
 void QtDcmManager::foundStudy ( const QMap<QString, QString> &infosMap )
 {
     QDate examDate = QDate::fromString ( infosMap["Date"], "yyyyMMdd" );
+
+    QtDcmStudy & study = d->patient ( infosMap["PatientID"] ).study ( infosMap["UID"] );
+    study.setId ( infosMap["ID"] );
+    study.setDescription ( infosMap["Description"] );
+    study.setDate ( examDate );
+    d->studyPatients.insert ( infosMap["UID"], infosMap["PatientID"] );
+
     if ( !d->studiesTreeWidget.isNull() ) {
         QTreeWidgetItem * studyItem = new QTreeWidgetItem ( d->studiesTreeWidget->invisibleRootItem() );
         studyItem->setText ( 0, infosMap["Description"] );
@@ -319,17 +714,12 @@ void QtDcmManager::foundStudy ( const QMap<QString, QString> &infosMap )
         studyItem->setText ( 2, examDate.toString ( "dd/MM/yyyy" ) );
         studyItem->setData ( 3, 0, infosMap["ID"] ); 
         
-        // for each study found, we populate d->patientData (QHash) with infos related to study then append it to the list of studies attached to the patient
-        QHash<QString, QVariant> &patientEntry = d->patientData[infosMap["PatientID"]];
-        if (!patientEntry.isEmpty())
-        {
-            QHash<QString, QVariant> studies = patientEntry["studies"].toHash();
-            if (!studies.contains(infosMap["UID"]))
-            {
-                studies.insert(infosMap["UID"], infosMap["Description"]);
-                findSeriesScu(infosMap["UID"]);
-            }
-            patientEntry["studies"] = studies;
+        // each new study of a selected patient is attached to it, and its series are queried
+        QtDcmStudyEntry entry;
+        entry.patientId = infosMap["PatientID"];
+        entry.description = infosMap["Description"];
+        if ( d->fetchModel.addStudy ( infosMap["UID"], entry ) ) {
+            findSeriesScu ( infosMap["UID"] );
         }
     }
 }
@@ -337,6 +727,17 @@ void QtDcmManager::foundStudy ( const QMap<QString, QString> &infosMap )
 void QtDcmManager::foundSerie ( const QMap<QString, QString> &infosMap )
 {
     QDate examDate = QDate::fromString ( infosMap["Date"], "yyyyMMdd" );
+
+    // Series are attached to a study found before, by C-FIND or in the media
+    QtDcmStudy * study = d->study ( infosMap["StudyInstanceUID"] );
+    if ( study ) {
+        QtDcmSerie & serie = study->serie ( infosMap["ID"] );
+        serie.setDescription ( infosMap["Description"] );
+        serie.setModality ( infosMap["Modality"] );
+        serie.setDate ( infosMap["Date"] );
+        d->serieStudies.insert ( infosMap["ID"], infosMap["StudyInstanceUID"] );
+    }
+
     if ( !d->seriesTreeWidget.isNull() ) {
         QTreeWidgetItem * serieItem = new QTreeWidgetItem ( d->seriesTreeWidget->invisibleRootItem() );
         serieItem->setText ( 0, infosMap["Description"] );
@@ -347,19 +748,21 @@ void QtDcmManager::foundSerie ( const QMap<QString, QString> &infosMap )
         serieItem->setData ( 5, 0, QVariant ( infosMap["Institution"] ) );
         serieItem->setData ( 6, 0, QVariant ( infosMap["Operator"] ) );
         
-        QHash<QString, QVariant> &seriesEntry = d->seriesData[infosMap["ID"]];
-        if (seriesEntry.isEmpty())
-        {
-            seriesEntry["StudyInstanceUID"] = infosMap["StudyInstanceUID"];
-            seriesEntry["SeriesDescription"] = infosMap["Description"];
-            seriesEntry["Modality"] = infosMap["Modality"];
-        }
-
+        QtDcmSeriesEntry entry;
+        entry.studyUid = infosMap["StudyInstanceUID"];
+        entry.description = infosMap["Description"];
+        entry.modality = infosMap["Modality"];
+        d->fetchModel.addSerie ( infosMap["ID"], entry );
     }
 }
 
-void QtDcmManager::foundImage ( const QString &image, int number )
+void QtDcmManager::foundImage ( const QString &image, int number, const QString &serieUid )
 {
+    QtDcmSerie * serie = d->serie ( serieUid );
+    if ( serie ) {
+        serie->image ( image ).setNumber ( number );
+    }
+
     d->listImages.append ( image );
     if ( number ) {
         d->mapImages.insert ( number, image );
@@ -373,6 +776,7 @@ void QtDcmManager::loadDicomdir()
     }
 
     d->mode = MEDIA;
+    d->mediaIndex.clear();
 
     //Load dicomdir in a DCMTK DicomFileFormat object
     OFCondition status;
@@ -384,16 +788,60 @@ void QtDcmManager::loadDicomdir()
     this->findPatientsDicomdir();
 }
 
+void QtDcmManager::loadDirectory ( const QString &directory )
+{
+    if ( directory.isEmpty() ) {
+        return;
+    }
+
+    d->mode = MEDIA;
+    d->dicomdir.clear();
+    d->mediaIndex.clear();
+
+    QtDcmMediaScanner * scanner = new QtDcmMediaScanner ( this );
+    scanner->setDirectory ( directory );
+    connect ( scanner, &QtDcmMediaScanner::updateProgress,
+              this,    &QtDcmManager::updateProgressBar);
+    connect ( scanner, &QtDcmMediaScanner::finished, this, [this, scanner, directory]() {
+        d->mediaIndex = scanner->index();
+        if ( d->mediaIndex && !d->mediaIndex->isEmpty() ) {
+            this->findPatientsDicomdir();
+        }
+        else {
+            this->displayMessage ( tr ( "No dicom file found in " ) + directory );
+        }
+    });
+    connect ( scanner, &QtDcmMediaScanner::finished,
+              scanner, &QtDcmMediaScanner::deleteLater);
+    scanner->start();
+}
+
 void QtDcmManager::findPatientsDicomdir()
 {
+    d->clearPatients();
+
+    if ( d->mediaIndex ) {
+        QtDcmFindMediaIndex finder;
+        finder.setMediaIndex ( d->mediaIndex.data() );
+        finder.findPatients();
+        return;
+    }
+
     QtDcmFindDicomdir * finder = new QtDcmFindDicomdir ( this );
     finder->setDcmItem ( d->dfile.getDataset() );
     finder->findPatients();
     delete finder;
 }
 
-void QtDcmManager::findStudiesDicomdir ( const QString &patientName )
+void QtDcmManager::findStudiesDicomdir ( const QString &patientName, const QString &patientId )
 {
+    if ( d->mediaIndex ) {
+        QtDcmFindMediaIndex finder;
+        finder.setMediaIndex ( d->mediaIndex.data() );
+        finder.findStudies ( patientId, patientName );
+        return;
+    }
+
     QtDcmFindDicomdir * finder = new QtDcmFindDicomdir ( this );
     finder->setDcmItem ( d->dfile.getDataset() );
     finder->findStudies ( patientName );
@@ -401,8 +849,16 @@ void QtDcmManager::findStudiesDicomdir ( const QString &patientName )
 }
 
 void QtDcmManager::findSeriesDicomdir ( const QString &patientName, 
-                                        const QString &studyUID )
+                                        const QString &studyUID,
+                                        const QString &patientId )
 {
+    if ( d->mediaIndex ) {
+        QtDcmFindMediaIndex finder;
+        finder.setMediaIndex ( d->mediaIndex.data() );
+        finder.findSeries ( patientId, patientName, studyUID );
+        return;
+    }
+
     QtDcmFindDicomdir * finder = new QtDcmFindDicomdir ( this );
     finder->setDcmItem ( d->dfile.getDataset() );
     finder->findSeries ( patientName, studyUID );
@@ -411,6 +867,13 @@ void QtDcmManager::findSeriesDicomdir ( const QString &patientName,
 
 void QtDcmManager::findImagesDicomdir ( const QString &uid )
 {
+    if ( d->mediaIndex ) {
+        QtDcmFindMediaIndex finder;
+        finder.setMediaIndex ( d->mediaIndex.data() );
+        finder.findImages ( uid );
+        return;
+    }
+
     QtDcmFindDicomdir * finder = new QtDcmFindDicomdir ( this );
     finder->setDcmItem ( d->dfile.getDataset() );
     finder->findImages ( uid );
@@ -431,6 +894,7 @@ void QtDcmManager::moveSelectedSeries()
     {
         QtDcmMoveDicomdir * mover = new QtDcmMoveDicomdir ( this );
         mover->setDcmItem ( d->dfile.getDataset() );
+        mover->setMediaIndex ( d->mediaIndex );
         mover->setOutputDir ( d->tempDir.absolutePath() );
         mover->setImportDir ( d->outputDir );
         mover->setSeries ( d->dataToImport );
@@ -442,6 +906,7 @@ void QtDcmManager::moveSelectedSeries()
                   this,  &QtDcmManager::moveSeriesFinished);
         connect ( mover, &QtDcmMoveDicomdir::finished,
                   mover, &QtDcmMoveDicomdir::deleteLater);
+        d->importMoving = true;
         mover->start();
     }
         break;
@@ -459,15 +924,29 @@ void QtDcmManager::moveSelectedSeries()
         mover->setData ( d->dataToImport );
         mover->setImportDir ( d->outputDir );
         mover->setQueryLevel( d->queryLevel );
+        // dcm2nii works on the dicom files, the volumes are only useful for the ITK conversion
+        if ( d->useConverter && d->assembleVolumes && !QtDcmPreferences::instance()->useDcm2nii() ) {
+            mover->setAssembleVolumes ( true );
+            mover->setWriteFiles ( d->writeDicomFiles );
+        }
         connect ( mover, &QtDcmMoveScu::updateProgress,
                   this,  &QtDcmManager::updateProgressBar);
+        // The slices and volumes received are only taken by the conversions
+        if ( d->useConverter ) {
+            connect ( mover, &QtDcmMoveScu::serieManifest,
+                      this,  &QtDcmManager::onSerieManifest);
+            connect ( mover, &QtDcmMoveScu::serieVolume,
+                      this,  &QtDcmManager::onSerieVolume);
+        }
         connect ( mover, &QtDcmMoveScu::serieMoved,
                   this,  &QtDcmManager::onSerieMoved);
         connect ( mover, &QtDcmMoveScu::finished,
                   this,  &QtDcmManager::moveSeriesFinished);
         connect ( mover, &QtDcmMoveScu::finished,
                   mover, &QtDcmMoveScu::deleteLater);
-        mover->start();
+        d->cancelPrefetch ( this );
+        d->importMoving = true;
+        d->startMove ( mover );
 
     }
         break;
@@ -509,7 +988,8 @@ void QtDcmManager::onMoveRequested(const QString &uid, const QString queryLevel)
     });    
     connect ( mover, &QtDcmMoveScu::finished,
                 mover, &QtDcmMoveScu::deleteLater);
-    mover->start();
+    d->cancelPrefetch ( this );
+    d->startMove ( mover );
 
 }
 
@@ -519,18 +999,38 @@ void QtDcmManager::getPreviewFromSelectedSerie ( const QString &uid, int element
         return;
     }
 
-    if ( !d->listImages.size() ) {
+    // The list may only hold the instance to preview, see findPreviewImageScu
+    QString imageId;
+    if ( d->mapImages.contains ( elementIndex ) ) {
+        imageId = d->mapImages[elementIndex];
+    }
+    else if ( elementIndex >= 0 && elementIndex < d->listImages.size() ) {
+        imageId = d->listImages[elementIndex];
+    }
+    else {
         return;
     }
 
-    if ( d->listImages.size() < elementIndex ) {
+    d->previewSerie = uid;
+    d->previewIndex = elementIndex;
+    if ( d->previewWidget && d->previewWidget->mosaicButton->isChecked() ) {
+        this->getMosaicFromSelectedSerie ( uid, MosaicTileCount );
         return;
     }
 
-    QString imageId = d->listImages[elementIndex];
-
-    if ( d->mapImages.size() && d->mapImages.contains ( elementIndex ) ) {
-        imageId = d->mapImages[elementIndex];
+    // Supersedes the previews still being moved or decoded
+    const int request = d->previewRequest.fetchAndAddOrdered ( 1 ) + 1;
+    d->stopMove ( this, d->previewMover );
+    d->previewMover.clear();
+    d->cancelPrefetch ( this );
+    d->mosaicTiles.clear();
+
+    // No need to move and decode an instance already previewed
+    const QImage cached = d->thumbnails.find ( QtDcmThumbnailCache::key ( imageId, QString::number ( PreviewSize ) ) );
+    if ( !cached.isNull() ) {
+        d->showPreview ( cached, imageId, request );
+        d->startPrefetch ( this, uid );
+        return;
     }
 
     switch(d->mode) {
@@ -539,11 +1039,13 @@ void QtDcmManager::getPreviewFromSelectedSerie ( const QString &uid, int element
         QtDcmMoveDicomdir * mover = new QtDcmMoveDicomdir ( this );
         mover->setMode ( QtDcmMoveDicomdir::PREVIEW );
         mover->setDcmItem ( d->dfile.getDataset() );
+        mover->setMediaIndex ( d->mediaIndex );
         mover->setOutputDir ( d->tempDir.absolutePath() );
         mover->setSeries ( QStringList() << uid );
         mover->setImageId ( imageId );
-        connect(mover, &QtDcmMoveDicomdir::previewSlice ,
-                this,  &QtDcmManager::makePreview);
+        connect(mover, &QtDcmMoveDicomdir::previewSlice, this, [this, request](const QString &filename){
+            d->startPreview ( this, filename, request );
+        });
         connect(mover, &QtDcmMoveDicomdir::finished,
                 mover, &QtDcmMoveDicomdir::deleteLater);
         mover->start();
@@ -562,7 +1064,8 @@ void QtDcmManager::getPreviewFromSelectedSerie ( const QString &uid, int element
         
         QString filename ( d->tempDir.absolutePath() + "/" + uid + "/" + modality + "." + imageId );
         if ( QFile ( filename ).exists() ) {
-            makePreview ( filename );
+            d->startPreview ( this, filename, request );
+            d->startPrefetch ( this, uid );
         }
         else {
             qWarning() << "****** Prepare move with parameters :";
@@ -577,11 +1080,19 @@ void QtDcmManager::getPreviewFromSelectedSerie ( const QString &uid, int element
             mover->setOutputDir ( d->tempDir.absolutePath() );
             mover->setData ( QStringList() << uid );
             mover->setImageId ( imageId );
-            connect(mover, &QtDcmMoveScu::previewSlice,
-                    this,  &QtDcmManager::makePreview);
+            connect(mover, &QtDcmMoveScu::previewSlice, this, [this, request](const QString &filename){
+                d->startPreview ( this, filename, request );
+            });
+            // The neighbors are only prefetched once the local port is free again
+            connect(mover, &QtDcmMoveScu::finished, this, [this, request, uid](){
+                if ( request == d->previewRequest.loadAcquire() ) {
+                    d->startPrefetch ( this, uid );
+                }
+            });
             connect(mover, &QtDcmMoveScu::finished,
                     mover, &QtDcmMoveScu::deleteLater);
-            mover->start();
+            d->previewMover = mover;
+            d->startMove ( mover );
         }
     }
         break;
@@ -593,6 +1104,123 @@ void QtDcmManager::getPreviewFromSelectedSerie ( const QString &uid, int element
     return;
 }
 
+void QtDcmManager::getMosaicFromSelectedSerie ( const QString &uid, int count )
+{
+    // Only the previewed instance of the serie may have been queried
+    if ( d->mode == PACS && !d->previewQuerySerie.isEmpty() && d->listImages.size() < d->previewInstanceCount ) {
+        d->listImages.clear();
+        d->mapImages.clear();
+        this->findImagesScu ( d->previewQuerySerie );
+    }
+
+    if ( !d->tempDir.exists() || d->listImages.isEmpty() || count < 1 ) {
+        return;
+    }
+
+    // Slices in acquisition order when every instance has a distinct number
+    const QStringList images = d->mapImages.size() == d->listImages.size() ? d->mapImages.values() : d->listImages;
+
+    QStringList slices;
+    for ( int i = 0; i < count; i++ ) {
+        const QString &image = images.at ( ( int ) ( ( ( 2 * ( qint64 ) i + 1 ) * images.size() ) / ( 2 * count ) ) );
+        if ( !slices.contains ( image ) ) {
+            slices.append ( image );
+        }
+    }
+
+    // Supersedes the previews still being moved or decoded
+    const int request = d->previewRequest.fetchAndAddOrdered ( 1 ) + 1;
+    d->stopMove ( this, d->previewMover );
+    d->previewMover.clear();
+    d->cancelPrefetch ( this );
+
+    d->mosaicTiles.clear();
+    for ( int i = 0; i < slices.size(); i++ ) {
+        d->mosaicTiles.insert ( slices.at ( i ), i );
+    }
+
+    if ( d->previewWidget ) {
+        d->previewWidget->startMosaic ( slices.size(), PreviewSize );
+    }
+
+    // The tiles already rendered are drawn at once, only the others are moved and decoded
+    QStringList missing;
+    for ( const QString &image : slices ) {
+        const QImage cached = d->thumbnails.find ( QtDcmThumbnailCache::key ( image, QString::number ( PreviewSize ) ) );
+        if ( cached.isNull() ) {
+            missing.append ( image );
+        }
+        else {
+            d->showPreview ( cached, image, request );
+        }
+    }
+
+    if ( missing.isEmpty() ) {
+        return;
+    }
+
+    switch(d->mode) {
+    case MEDIA:
+    {
+        QtDcmMoveDicomdir * mover = new QtDcmMoveDicomdir ( this );
+        mover->setMode ( QtDcmMoveDicomdir::PREVIEW );
+        mover->setDcmItem ( d->dfile.getDataset() );
+        mover->setMediaIndex ( d->mediaIndex );
+        mover->setOutputDir ( d->tempDir.absolutePath() );
+        mover->setSeries ( QStringList() << uid );
+        mover->setImageIds ( missing );
+        connect(mover, &QtDcmMoveDicomdir::previewSlice, this, [this, request](const QString &filename){
+            d->startPreview ( this, filename, request );
+        });
+        connect(mover, &QtDcmMoveDicomdir::finished,
+                mover, &QtDcmMoveDicomdir::deleteLater);
+        mover->start();
+    }
+        break;
+    case PACS:
+    {
+        emit gettingPreview();
+
+        QString modality ( "MR" );
+        if ( d->seriesTreeWidget->currentItem() ) {
+            modality = d->seriesTreeWidget->currentItem()->text ( 1 );
+        }
+
+        // The slices moved by an earlier preview are still in the temporary directory
+        QStringList toMove;
+        for ( const QString &image : missing ) {
+            const QString filename ( d->tempDir.absolutePath() + "/" + uid + "/" + modality + "." + image );
+            if ( QFile ( filename ).exists() ) {
+                d->startPreview ( this, filename, request );
+            }
+            else {
+                toMove.append ( image );
+            }
+        }
+
+        if ( !toMove.isEmpty() ) {
+            // A single IMAGE level move for all the slices, they are decoded as they arrive
+            QtDcmMoveScu * mover = new QtDcmMoveScu ( this );
+            mover->setMode ( QtDcmMoveScu::PREVIEW );
+            mover->setOutputDir ( d->tempDir.absolutePath() );
+            mover->setData ( QStringList() << uid );
+            mover->setImageIds ( toMove );
+            connect(mover, &QtDcmMoveScu::previewSlice, this, [this, request](const QString &filename){
+                d->startPreview ( this, filename, request );
+            });
+            connect(mover, &QtDcmMoveScu::finished,
+                    mover, &QtDcmMoveScu::deleteLater);
+            d->previewMover = mover;
+            d->startMove ( mover );
+        }
+    }
+        break;
+    default:
+        qWarning() <<  "Move mode not supported";
+        break;
+    }
+}
+
 
 void QtDcmManager::importSelectedSeries()
 {
@@ -635,8 +1263,12 @@ void QtDcmManager::importSelectedSeries()
 
 void QtDcmManager::fetchSelectedData()
 {
-    QHash<QString, QHash<QString, QVariant>> ptData;
-    QHash<QString, QHash<QString, QVariant>> seData;
+    QtDcmFetchModel data;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    const QSet<QString> selected ( d->dataToImport.begin(), d->dataToImport.end() );
+#else
+    const QSet<QString> selected = d->dataToImport.toSet();
+#endif
 
     if (d->queryLevel=="undefined")
     {
@@ -644,93 +1276,45 @@ void QtDcmManager::fetchSelectedData()
     }
     else if (d->queryLevel=="PATIENT")
     {
-        ptData = d->patientData;
-        seData = d->seriesData;
+        data = d->fetchModel;
     }
     else if (d->queryLevel=="STUDY")
     {
-        ptData = getPatientsToFetch(d->dataToImport);
-        seData = d->seriesData;
-    }
-    else if (d->queryLevel=="SERIES")
-    {
-        seData = getSeriesToFetch(d->dataToImport);
-        QList<QString> studyUIDs = seData.keys();
-        for (QHash<QString, QVariant> &seEntry : seData)
-        {
-            studyUIDs.append(seEntry["StudyInstanceUID"].toString());
+        data = d->fetchModel.selectStudies ( selected );
+        for ( QHash<QString, QtDcmSeriesEntry>::const_iterator it = d->fetchModel.series().constBegin(); it != d->fetchModel.series().constEnd(); ++it ) {
+            data.addSerie ( it.key(), it.value() );
         }
-        ptData = getPatientsToFetch(studyUIDs);
     }
-
-    emit(fetchFinished(ptData, seData));
-}
-
-QHash<QString, QHash<QString, QVariant>> QtDcmManager::getPatientsToFetch(QList<QString> studyUIDs)
-{
-    QHash<QString, QHash<QString, QVariant>> ptData;
-    QHash<QString, QVariant> tmpStudies;
-    QHash<QString, QVariant> ptEntry;
-    for (QHash<QString, QVariant> &patientEntry : d->patientData)
+    else if (d->queryLevel=="SERIES")
     {
-        tmpStudies.clear();
-        ptEntry.clear();
-        QString pKey = d->patientData.key(patientEntry);
-        QHash<QString, QVariant> studies = patientEntry["studies"].toHash();
-        QList<QString> keys = studies.keys();
-        for (QString key : keys)
-        {
-            if (studyUIDs.contains(key))
-            {
-                tmpStudies.insert(key, studies.value(key));
-            }
-        }
-        if (!tmpStudies.isEmpty())
-        {
-            ptEntry["PatientName"] = patientEntry["PatientName"];
-            ptEntry["BirthDate"] = patientEntry["BirthDate"];
-            ptEntry["Gender"] = patientEntry["Gender"];
-            ptEntry["studies"] = tmpStudies;
-            ptData[pKey] = ptEntry;
-        }
+        data = d->fetchModel.selectSeries ( selected );
     }
 
-    return ptData;
-}
+    emit dataFetched ( data );
 
-QHash<QString, QHash<QString, QVariant>>  QtDcmManager::getSeriesToFetch(QList<QString> seriesUIDs)
-{
-    QHash<QString, QHash<QString, QVariant>> seData;
-    QList<QString> keys = d->seriesData.keys();
-    for (QString key : keys)
-    {
-        if (seriesUIDs.contains(key))
-        {
-            seData[key] = d->seriesData[key];
-        }
+    // The nested hashes are only built for the receivers still connected to the former signal
+    if ( isSignalConnected ( QMetaMethod::fromSignal ( &QtDcmManager::fetchFinished ) ) ) {
+        emit fetchFinished ( data.patientsHash(), data.seriesHash() );
     }
-    return seData;
 }
 
 void QtDcmManager::addPatientDataToFetch(const QString &patientID, const QString &patientName, const QString &birthDate, const QString &gender)
 {
-    QHash<QString, QVariant> &patientEntry = d->patientData[patientID];
-    if (patientEntry.isEmpty())
-    {
-        patientEntry["PatientName"] = patientName;
-        patientEntry["BirthDate"] = QDate::fromString ( birthDate, "dd/MM/yyyy" ).toString ( "yyyyMMdd" );
-        patientEntry["Gender"] = gender;
-    }
+    QtDcmPatientEntry patient;
+    patient.name = patientName;
+    patient.birthDate = QDate::fromString ( birthDate, "dd/MM/yyyy" ).toString ( "yyyyMMdd" );
+    patient.gender = gender;
+    d->fetchModel.addPatient ( patientID, patient );
 }
 
 void QtDcmManager::clearPatientDataToFetch()
 {
-    d->patientData.clear();
+    d->fetchModel.clearPatients();
 }
 
 void QtDcmManager::clearSeriesDataToFetch()
 {
-    d->seriesData.clear();
+    d->fetchModel.clearSeries();
 }
 void QtDcmManager::importToDirectory ( const QString &directory )
 {
@@ -742,22 +1326,59 @@ void QtDcmManager::importToDirectory ( const QString &directory )
 
 void QtDcmManager::onSerieMoved ( const QString &directory , const QString &serie , int number )
 {
+    Q_UNUSED ( number );
+
+    const QtDcmSliceManifest manifest = d->manifests.take ( serie );
+    const QSharedPointer<QtDcmVolumeAssembler> volume = d->volumes.take ( serie );
+
     if ( d->useConverter ) {
-        qDebug() << "Starting reconstruction of series" << serie;
-        
-        QtDcmConvert converter( this );
-        converter.setInputDirectory ( directory );
-        converter.setOutputFilename ( serie + ".nii" );
-        converter.setOutputDirectory ( d->outputDir );
-        converter.setTempDirectory ( d->tempDir.absolutePath() );
-        converter.setSerieUID ( serie );
-        converter.convert();
-        qDebug() << "Conversion complete";
-        
-        if ( number == this->dataToImportSize() - 1 ) {
-            emit importFinished(directory);
-        }
+        qDebug() << "Queueing reconstruction of series" << serie;
+
+        // importFinished is emitted once all the series are converted, see finishImport
+        d->convertedSeries.insert ( serie, directory );
+        d->convertQueue->enqueue ( directory, d->outputDir, serie + "." + QtDcmPreferences::instance()->outputFormat(),
+                                   d->tempDir.absolutePath(), serie, manifest, volume );
+        return;
     }
+
+    // importFinished is emitted once the move is done, see finishImport
+    d->importedDirectory = directory;
+}
+
+void QtDcmManager::onSerieManifest ( const QString &serie, const QtDcmSliceManifest &manifest )
+{
+    // Always received before the serieMoved signal of the same serie
+    d->manifests.insert ( serie, manifest );
+}
+
+void QtDcmManager::onSerieVolume ( const QString &serie, QSharedPointer<QtDcmVolumeAssembler> volume )
+{
+    d->volumes.insert ( serie, volume );
+}
+
+void QtDcmManager::onSerieConverted ( const QString &serie )
+{
+    qDebug() << "Conversion complete" << serie;
+
+    const QString directory = d->convertedSeries.take ( serie );
+    if ( !directory.isEmpty() ) {
+        d->importedDirectory = directory;
+    }
+    this->finishImport();
+}
+
+void QtDcmManager::finishImport()
+{
+    // The queue may run dry between two series of the same import
+    if ( d->importMoving || !d->convertedSeries.isEmpty() ) {
+        return;
+    }
+
+    const QString directory = d->importedDirectory;
+    d->importedDirectory.clear();
+    d->manifests.clear();
+    d->volumes.clear();
+
     emit importFinished(directory);
 }
 
@@ -767,6 +1388,10 @@ void QtDcmManager::moveSeriesFinished()
         d->importWidget->importProgressBar->setValue ( 0 );
         d->importWidget->hideProgressLabel();
     }
+
+    // The serieMoved signals of the mover are all handled, so every serie is queued by now
+    d->importMoving = false;
+    this->finishImport();
 }
 
 void QtDcmManager::updateProgressBar ( int i )
@@ -835,82 +1460,7 @@ void QtDcmManager::deleteCurrentSerieDir()
 
 void QtDcmManager::makePreview ( const QString &filename )
 {
-    DcmRLEDecoderRegistration::registerCodecs ( OFFalse, OFFalse );
-    DJDecoderRegistration::registerCodecs ( EDC_photometricInterpretation, EUC_default, EPC_default, OFFalse );
-    OFFilename dcmFileName(filename.toStdString().c_str(), OFTrue);
-    DcmFileFormat file;
-    file.loadFile (dcmFileName);
-    DcmDataset * dset = file.getDataset();
-    DicomImage* dcimage = new DicomImage ( dset, file.getDataset()->getOriginalXfer(), CIF_MayDetachPixelData );
-
-
-    if ( dcimage != NULL ) {
-        dcimage->setNoDisplayFunction();
-        dcimage->hideAllOverlays();
-        dcimage->setNoVoiTransformation();
-
-        if ( dcimage->getStatus() == EIS_Normal ) {
-            Uint32 *pixelData = ( Uint32 * ) ( dcimage->getOutputData ( 32 /* bits per sample */ ) );
-
-            if ( pixelData != NULL ) {
-                Uint8 *colored = new Uint8[dcimage->getWidth() * dcimage->getHeight() * 4]; //4 * dcimage->getWidth() * dcimage->getHeight() matrix
-                Uint8 *col = colored;
-                Uint32 *p = pixelData;
-                //get the highest values for RGBA, then use them to scale the pixel luminosity
-                Uint32 p_max = 0;
-#ifdef WIN32                
-                Uint32 p_min = UINT_LEAST32_MAX;
-#else
-                Uint32 p_min = std::numeric_limits<Uint32>::max();
-#endif                
-
-                for ( unsigned i = 0; i < dcimage->getWidth(); ++i ) {
-                    for ( unsigned j = 0; j < dcimage->getHeight(); ++j, ++p ) {
-                        if ( *p > p_max ) {
-                            p_max = *p;
-                        }
-                        
-                        if ( *p < p_min ) {
-                            p_min = *p;
-                        }
-                    }
-                }
-
-                double a = 4294967295.f / ( ( double ) p_max - ( double ) p_min );
-
-                //re-initialize 'col'
-                p = pixelData;
-                //copy the pixels in our QImage
-
-                for ( unsigned i = 0; i < dcimage->getWidth(); ++i ) {
-                    for ( unsigned j = 0; j < dcimage->getHeight(); ++j, ++p ) {
-                        *col = ( Uint8 ) ( ( 255.f / 4294967295.f ) * ( a * ( ( double ) ( *p ) - ( double ) p_min ) ) );
-                        ++col;
-                        *col = ( Uint8 ) ( ( 255.f / 4294967295.f ) * ( a * ( ( double ) ( *p ) - ( double ) p_min ) ) );
-                        ++col;
-                        *col = ( Uint8 ) ( ( 255.f / 4294967295.f ) * ( a * ( ( double ) ( *p ) - ( double ) p_min ) ) );
-                        ++col;
-                        *col = 255;
-                        ++col;
-                    }
-                }
-
-                QImage image ( colored, dcimage->getWidth(), dcimage->getHeight(), QImage::Format_ARGB32 );
-
-                if ( d->previewWidget ) {
-                    d->previewWidget->imageLabel->setPixmap ( QPixmap::fromImage ( image.scaled ( 130,130 ), Qt::AutoColor ) );
-                }
-
-                delete[] colored;
-
-            }
-        }
-
-        delete dcimage;
-    }
-    
-    DcmRLEDecoderRegistration::cleanup();
-    DJDecoderRegistration::cleanup();
+    d->startPreview ( this, filename, d->previewRequest.fetchAndAddOrdered ( 1 ) + 1 );
 }
 
 // Getters and setters
@@ -922,6 +1472,7 @@ QString QtDcmManager::dicomdir() const
 void QtDcmManager::setDicomdir ( const QString &dicomdir )
 {
     d->dicomdir = dicomdir;
+    d->mediaIndex.clear();
     //Load dicomdir in a DCMTK DicomFileFormat object
     OFCondition status;
     OFFilename dcmFileName(d->dicomdir.toStdString().c_str(), OFTrue);
@@ -1062,6 +1613,17 @@ void QtDcmManager::addPatient()
     d->patients.append ( QtDcmPatient() );
 }
 
+QList<QtDcmPatient> QtDcmManager::patients() const
+{
+    return d->patients;
+}
+
+QtDcmPatient QtDcmManager::patient ( const QString &id ) const
+{
+    const int index = d->patientIndex.value ( id, -1 );
+    return ( index >= 0 ) ? d->patients.at ( index ) : QtDcmPatient();
+}
+
 QtDcmManager::eMoveMode QtDcmManager::mode() const 
 {
     return d->mode;
@@ -1081,6 +1643,9 @@ void QtDcmManager::clearListOfImages()
 {
     d->listImages.clear();
     d->mapImages.clear();
+    d->previewSerie.clear();
+    d->previewQuerySerie.clear();
+    d->previewInstanceCount = 0;
 }
 
 void QtDcmManager::setSerieId ( const QString &id )
@@ -1138,3 +1703,53 @@ void QtDcmManager::setUseExternalConverter ( bool use )
     d->useConverter = use;
 }
 
+bool QtDcmManager::assembleVolumes() const
+{
+    return d->assembleVolumes;
+}
+
+void QtDcmManager::setAssembleVolumes ( bool assemble )
+{
+    d->assembleVolumes = assemble;
+}
+
+bool QtDcmManager::writeDicomFiles() const
+{
+    return d->writeDicomFiles;
+}
+
+void QtDcmManager::setWriteDicomFiles ( bool write )
+{
+    d->writeDicomFiles = write;
+}
+
+bool QtDcmManager::handOverVolumes() const
+{
+    return d->convertQueue->keepVolumes();
+}
+
+void QtDcmManager::setHandOverVolumes ( bool handOver )
+{
+    d->convertQueue->setKeepVolumes ( handOver );
+}
+
+bool QtDcmManager::writeConvertedFiles() const
+{
+    return d->convertQueue->writeFiles();
+}
+
+void QtDcmManager::setWriteConvertedFiles ( bool write )
+{
+    d->convertQueue->setWriteFiles ( write );
+}
+
+int QtDcmManager::conversionThreadCount() const
+{
+    return d->convertQueue->maxThreadCount();
+}
+
+void QtDcmManager::setConversionThreadCount ( int count )
+{
+    d->convertQueue->setMaxThreadCount ( count );
+}
+
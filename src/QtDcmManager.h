@@ -23,6 +23,10 @@
 #include "qtdcmExports.h"
 #include <QtGui>
 #include <QtNetwork>
+#include <QtDcmFetchModel.h>
+#include <QtDcmSliceManifest.h>
+#include <QtDcmVolume.h>
+#include <QtDcmVolumeAssembler.h>
 
 class QTreeWidget;
 class QtDcm;
@@ -32,6 +36,7 @@ class QtDcmFindScuSignalManager;
 class QtDcmPreviewWidget;
 class QtDcmImportWidget;
 class QtDcmSerieInfoWidget;
+class QtDcmPatient;
 
 class QtDcmManagerPrivate;
 
@@ -77,19 +82,39 @@ public:
     void findStudiesScu ( const QString &patientId,  const QString &patientName );
     void findSeriesScu ( const QString &studyUID );
     void findImagesScu ( const QString &uid );
+
+    /**
+     * Query the identifier of the instance to preview instead of all the instances of the serie.
+     * The instance numbered instanceCount / 2 is queried first, if the PACS has none the serie
+     * query is cancelled once the middle instance has been received.
+     *
+     * @param instanceCount NumberOfSeriesRelatedInstances of the serie, the whole serie is queried if unknown
+     * @return the index to give to getPreviewFromSelectedSerie, -1 if no instance was found
+     */
+    int findPreviewImageScu ( const QString &uid, int instanceCount );
     void foundPatient ( const QMap<QString, QString> &infosMap );
     void foundStudy ( const QMap<QString, QString> &infosMap );
     void foundSerie ( const QMap<QString, QString> &infosMap );
 //     void foundImage ( QMap<QString, QString> infosMap );
-    void foundImage ( const QString &image, int number );
+    void foundImage ( const QString &image, int number, const QString &serieUid = QString() );
     void moveSelectedSeries();
     void getPreviewFromSelectedSerie ( const QString &uid, int elementCount );
+
+    /**
+     * Show a contact sheet of count evenly spaced slices of a serie in the preview widget.
+     * Only these instances are retrieved, the tiles are drawn as they are decoded.
+     */
+    void getMosaicFromSelectedSerie ( const QString &uid, int count );
 //     void getPreviewFromSelectedSerie ( int elementIndex );
 
     void findPatientsDicomdir();
-    void findStudiesDicomdir ( const QString &patientName );
+    /**
+     * The patient id is only used by a media index, a DICOMDIR is browsed by patient name
+     */
+    void findStudiesDicomdir ( const QString &patientName, const QString &patientId = QString() );
     void findSeriesDicomdir ( const QString &patientName,
-                              const QString &studyDescription );
+                              const QString &studyDescription,
+                              const QString &patientId = QString() );
     void findImagesDicomdir ( const QString &serieUID );
 
     void setQtDcmWidget ( QtDcm * widget );
@@ -115,6 +140,14 @@ public:
      */
     void loadDicomdir();
 
+    /**
+     * This method scans a directory that has no dicomdir (in a separate thread)
+     * and populate the patient treewidget once done
+     *
+     * @param directory the root directory of the media
+     */
+    void loadDirectory ( const QString &directory );
+
     /**
      * Convenience method that display error message in a QMessageBox window.
      *
@@ -280,6 +313,17 @@ public:
      */
     void addPatient();
 
+    /**
+     * Patients found by the last patient query, on a PACS or in a media, with the studies,
+     * series and images found for them since. Copies are cheap, the hierarchy is implicitly shared.
+     */
+    QList<QtDcmPatient> patients() const;
+
+    /**
+     * Patient of patients() with this id, an empty patient if not found
+     */
+    QtDcmPatient patient ( const QString &id ) const;
+
     /**
      * Mode getter
      */
@@ -300,6 +344,46 @@ public:
 
     void setUseExternalConverter ( bool use );
 
+    /**
+     * Build the volumes of the series retrieved from a PACS directly from the received datasets,
+     * instead of writing the dicom files and reading them back (ITK conversion only, off by default)
+     */
+    bool assembleVolumes() const;
+
+    void setAssembleVolumes ( bool assemble );
+
+    /**
+     * Write the retrieved dicom files in the temporary directory (on by default).
+     * Can only be turned off when the volumes are assembled, the series that can't be
+     * assembled are still written.
+     */
+    bool writeDicomFiles() const;
+
+    void setWriteDicomFiles ( bool write );
+
+    /**
+     * Hand the converted images over with volumesConverted(), so that the host application
+     * does not have to read back the converted files (ITK conversion only, off by default)
+     */
+    bool handOverVolumes() const;
+
+    void setHandOverVolumes ( bool handOver );
+
+    /**
+     * Write the converted series to the output directory (on by default).
+     * Can be turned off when the volumes are handed over.
+     */
+    bool writeConvertedFiles() const;
+
+    void setWriteConvertedFiles ( bool write );
+
+    /**
+     * Number of series converted in parallel while the next ones are retrieved
+     */
+    int conversionThreadCount() const;
+
+    void setConversionThreadCount ( int count );
+
     /**
      * This method try to delete the temporary directory when closing the QtDcm widget
      * (Doesn't work for the moment)
@@ -321,6 +405,12 @@ public slots:
     void clearPreview();
     void makePreview ( const QString &filename );
     void onSerieMoved ( const QString &directory, const QString &uid, int number );
+    void onSerieManifest ( const QString &uid, const QtDcmSliceManifest &manifest );
+    void onSerieVolume ( const QString &uid, QSharedPointer<QtDcmVolumeAssembler> volume );
+    /**
+     * Only the successful conversions, the failed ones are dropped from the import
+     */
+    void onSerieConverted ( const QString &uid );
 
     void importSelectedSeries();
     void fetchSelectedData();
@@ -329,12 +419,39 @@ public slots:
 
 signals:
     void serieMoved ( const QString &directory );
+
+    /**
+     * Emitted once per import, when all the series are moved and, if the converter is used,
+     * all their conversions are done. directory is the dicom directory of the last serie
+     * imported successfully (moved, and converted if the converter is used), empty if the
+     * whole import failed. See conversionFinished() and conversionFailed() for each serie.
+     */
     void importFinished(const QString &directory);
     void updateProgressLevel(int level);
     void gettingPreview();
     void fetchFinished(QHash<QString, QHash<QString, QVariant>> patientData,
                        QHash<QString, QHash<QString, QVariant>> seriesData);
+
+    /**
+     * Emitted by fetchSelectedData() with the selected patients, studies and series,
+     * the same content as fetchFinished() without building the nested hashes.
+     */
+    void dataFetched ( const QtDcmFetchModel & data );
     void moveState(int status, const QString &pathOrMessage);
+    void conversionStarted ( const QString &uid );
+    void conversionFinished ( const QString &uid, const QString &filename );
+
+    /**
+     * All the files written for a serie, forwarded from QtDcmConvertQueue
+     */
+    void filesConverted ( const QString &uid, const QStringList &filenames );
+    void conversionFailed ( const QString &uid );
+    void volumesConverted ( const QString &uid, const QList<QtDcmVolume> &volumes );
+
+    /**
+     * The conversion queue is empty, forwarded from QtDcmConvertQueue
+     */
+    void allConversionsFinished();
 private:
     /*!
      * \brief QtDcmManager constructor, private on purpose as it's a singleton
@@ -347,8 +464,11 @@ private:
 
     void deleteCurrentSerieDir();
 
-    QHash<QString, QHash<QString, QVariant>> getPatientsToFetch(QList<QString> studyUIDs);
-    QHash<QString, QHash<QString, QVariant>> getSeriesToFetch(QList<QString> seriesUIDs);
+    /**
+     * Emit importFinished once the import moves are done and all their series converted.
+     * Does nothing before.
+     */
+    void finishImport();
 
     /**
      * Create the temporary directory (/tmp/qtdcm on Unix) and the logging directory.
@@ -0,0 +1,575 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <QtDcmMediaIndex.h>
+
+namespace
+{
+const char Magic[8] = { 'Q', 'T', 'D', 'C', 'M', 'I', 'D', 'X' };
+const quint32 Version = 1;
+
+/**
+ * Layout of an index file : the header, the key, the root directory (both padded to 4 bytes),
+ * then the patient, study, serie and instance records and the string pool, as they are in memory.
+ */
+struct FileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 keySize;
+    quint32 rootSize;
+    quint32 patientCount;
+    quint32 studyCount;
+    quint32 seriesCount;
+    quint32 instanceCount;
+    quint32 stringSize;
+};
+
+quint32 padded ( quint32 size )
+{
+    return ( size + 3 ) & ~3u;
+}
+
+bool validRange ( quint32 first, quint32 count, quint32 size )
+{
+    return quint64 ( first ) + count <= size;
+}
+
+bool validString ( quint32 offset, quint32 stringSize )
+{
+    return offset < stringSize;
+}
+}
+
+class QtDcmMediaIndex::Private
+{
+public:
+    QString rootDirectory;                      /** Media root directory */
+    QByteArray strings;                         /** UTF-8 string pool, each string is NUL terminated */
+
+    QVector<PatientRecord> patients;
+    QVector<StudyRecord> studies;
+    QVector<SeriesRecord> series;
+    QVector<InstanceRecord> instances;
+
+    // Records actually browsed, either in the vectors above or in the mapped file
+    const PatientRecord * patientData;
+    const StudyRecord * studyData;
+    const SeriesRecord * seriesData;
+    const InstanceRecord * instanceData;
+    const char * stringData;
+    int patientCount;
+    int studyCount;
+    int seriesCount;
+    int instanceCount;
+    int stringSize;
+
+    QFile file;                                 /** Mapped index file, when loaded */
+
+    void useVectors();
+
+    // Lookup tables only used while building
+    QHash<QByteArray, quint32> stringOffsets;   /** Already pooled strings */
+    QHash<QByteArray, quint32> patientIndex;    /** PatientID + PatientName => patient record */
+    QHash<QByteArray, quint32> studyIndex;      /** StudyInstanceUID => study record */
+    QHash<QByteArray, quint32> seriesIndex;     /** SeriesInstanceUID => serie record */
+    QSet<QByteArray> instanceUids;              /** Known SOPInstanceUIDs */
+
+    quint32 pool ( const QByteArray & value );   /** Shared strings (names, descriptions, uids) */
+    quint32 append ( const QByteArray & value ); /** Unique strings (filenames, instance uids), not worth a lookup entry */
+};
+
+quint32 QtDcmMediaIndex::Private::pool ( const QByteArray & value )
+{
+    if ( value.isEmpty() ) {
+        return 0;
+    }
+
+    QHash<QByteArray, quint32>::const_iterator it = stringOffsets.constFind ( value );
+    if ( it != stringOffsets.constEnd() ) {
+        return it.value();
+    }
+
+    const quint32 offset = this->append ( value );
+    stringOffsets.insert ( value, offset );
+    return offset;
+}
+
+quint32 QtDcmMediaIndex::Private::append ( const QByteArray & value )
+{
+    if ( value.isEmpty() ) {
+        return 0;
+    }
+
+    const quint32 offset = strings.size();
+    strings.append ( value );
+    strings.append ( '\0' );
+    return offset;
+}
+
+void QtDcmMediaIndex::Private::useVectors()
+{
+    patientData = patients.constData();
+    studyData = studies.constData();
+    seriesData = series.constData();
+    instanceData = instances.constData();
+    stringData = strings.constData();
+    patientCount = patients.size();
+    studyCount = studies.size();
+    seriesCount = series.size();
+    instanceCount = instances.size();
+    stringSize = strings.size();
+}
+
+namespace
+{
+// Stable sort of the records, returns old index => new index
+template <typename Record, typename LessThan>
+QVector<quint32> sortRecords ( QVector<Record> & records, LessThan lessThan )
+{
+    QVector<quint32> order ( records.size() );
+    for ( int i = 0; i < order.size(); ++i ) {
+        order[i] = i;
+    }
+
+    std::stable_sort ( order.begin(), order.end(), [&records, &lessThan] ( quint32 a, quint32 b ) {
+        return lessThan ( records.at ( a ), records.at ( b ) );
+    } );
+
+    QVector<Record> sorted;
+    sorted.reserve ( records.size() );
+    QVector<quint32> newIndex ( records.size() );
+    for ( int i = 0; i < order.size(); ++i ) {
+        sorted.append ( records.at ( order.at ( i ) ) );
+        newIndex[order.at ( i )] = i;
+    }
+    records.swap ( sorted );
+
+    return newIndex;
+}
+}
+
+QtDcmMediaIndex::QtDcmMediaIndex() : d ( new QtDcmMediaIndex::Private )
+{
+    // Offset 0 is the empty string
+    d->strings.append ( '\0' );
+    d->useVectors();
+}
+
+QtDcmMediaIndex::~QtDcmMediaIndex()
+{
+    delete d;
+    d = NULL;
+}
+
+QString QtDcmMediaIndex::rootDirectory() const
+{
+    return d->rootDirectory;
+}
+
+void QtDcmMediaIndex::setRootDirectory ( const QString & directory )
+{
+    d->rootDirectory = directory;
+}
+
+void QtDcmMediaIndex::addInstance ( const InstanceInfo & info )
+{
+    if ( info.sopInstanceUid.isEmpty() || info.seriesUid.isEmpty() ) {
+        return;
+    }
+
+    if ( d->instanceUids.contains ( info.sopInstanceUid ) ) {
+        return;
+    }
+    d->instanceUids.insert ( info.sopInstanceUid );
+
+    const QByteArray patientKey = info.patientId + '\\' + info.patientName;
+    quint32 patient = d->patientIndex.value ( patientKey, d->patients.size() );
+    if ( patient == quint32 ( d->patients.size() ) ) {
+        PatientRecord record;
+        record.name = d->pool ( info.patientName );
+        record.id = d->pool ( info.patientId );
+        record.birthdate = d->pool ( info.patientBirthdate );
+        record.sex = d->pool ( info.patientSex );
+        record.firstStudy = 0;
+        record.studyCount = 0;
+        d->patients.append ( record );
+        d->patientIndex.insert ( patientKey, patient );
+    }
+
+    quint32 study = d->studyIndex.value ( info.studyUid, d->studies.size() );
+    if ( study == quint32 ( d->studies.size() ) ) {
+        StudyRecord record;
+        record.uid = d->pool ( info.studyUid );
+        record.id = d->pool ( info.studyId );
+        record.description = d->pool ( info.studyDescription );
+        record.date = d->pool ( info.studyDate );
+        record.patient = patient;
+        record.firstSeries = 0;
+        record.seriesCount = 0;
+        d->studies.append ( record );
+        d->studyIndex.insert ( info.studyUid, study );
+    }
+
+    quint32 serie = d->seriesIndex.value ( info.seriesUid, d->series.size() );
+    if ( serie == quint32 ( d->series.size() ) ) {
+        SeriesRecord record;
+        record.uid = d->pool ( info.seriesUid );
+        record.description = d->pool ( info.seriesDescription );
+        record.modality = d->pool ( info.modality );
+        record.institution = d->pool ( info.institution );
+        record.acquisitionNumber = d->pool ( info.acquisitionNumber );
+        record.performingPhysician = d->pool ( info.performingPhysician );
+        record.study = study;
+        record.firstInstance = 0;
+        record.instanceCount = 0;
+        d->series.append ( record );
+        d->seriesIndex.insert ( info.seriesUid, serie );
+    }
+
+    InstanceRecord record;
+    record.uid = d->append ( info.sopInstanceUid );
+    record.number = info.instanceNumber;
+    record.file = d->append ( info.file );
+    record.series = serie;
+    d->instances.append ( record );
+}
+
+void QtDcmMediaIndex::finalize()
+{
+    // Group the studies by patient, the series by study and the instances by serie
+    const QVector<quint32> studyMap = sortRecords ( d->studies, [] ( const StudyRecord & a, const StudyRecord & b ) {
+        return a.patient < b.patient;
+    } );
+    for ( SeriesRecord & record : d->series ) {
+        record.study = studyMap.at ( record.study );
+    }
+
+    const QVector<quint32> seriesMap = sortRecords ( d->series, [] ( const SeriesRecord & a, const SeriesRecord & b ) {
+        return a.study < b.study;
+    } );
+    for ( InstanceRecord & record : d->instances ) {
+        record.series = seriesMap.at ( record.series );
+    }
+
+    sortRecords ( d->instances, [] ( const InstanceRecord & a, const InstanceRecord & b ) {
+        return ( a.series < b.series ) || ( a.series == b.series && a.number < b.number );
+    } );
+
+    // Children ranges
+    for ( int i = 0; i < d->studies.size(); ++i ) {
+        PatientRecord & parent = d->patients[d->studies.at ( i ).patient];
+        if ( parent.studyCount++ == 0 ) {
+            parent.firstStudy = i;
+        }
+    }
+
+    for ( int i = 0; i < d->series.size(); ++i ) {
+        StudyRecord & parent = d->studies[d->series.at ( i ).study];
+        if ( parent.seriesCount++ == 0 ) {
+            parent.firstSeries = i;
+        }
+    }
+
+    for ( int i = 0; i < d->instances.size(); ++i ) {
+        SeriesRecord & parent = d->series[d->instances.at ( i ).series];
+        if ( parent.instanceCount++ == 0 ) {
+            parent.firstInstance = i;
+        }
+    }
+
+    d->stringOffsets.clear();
+    d->patientIndex.clear();
+    d->studyIndex.clear();
+    d->seriesIndex.clear();
+    d->instanceUids.clear();
+    d->strings.squeeze();
+    d->patients.squeeze();
+    d->studies.squeeze();
+    d->series.squeeze();
+    d->instances.squeeze();
+    d->useVectors();
+}
+
+bool QtDcmMediaIndex::save ( const QString & filename, const QByteArray & key ) const
+{
+    const QByteArray root = d->rootDirectory.toUtf8();
+
+    FileHeader header;
+    memcpy ( header.magic, Magic, sizeof ( Magic ) );
+    header.version = Version;
+    header.keySize = key.size();
+    header.rootSize = root.size();
+    header.patientCount = d->patientCount;
+    header.studyCount = d->studyCount;
+    header.seriesCount = d->seriesCount;
+    header.instanceCount = d->instanceCount;
+    header.stringSize = d->stringSize;
+
+    const QByteArray padding ( 3, '\0' );
+
+    QSaveFile file ( filename );
+    if ( !file.open ( QIODevice::WriteOnly ) ) {
+        qWarning() << "Cannot write media index" << filename;
+        return false;
+    }
+
+    file.write ( reinterpret_cast<const char *> ( &header ), sizeof ( header ) );
+    file.write ( key );
+    file.write ( padding.constData(), padded ( key.size() ) - key.size() );
+    file.write ( root );
+    file.write ( padding.constData(), padded ( root.size() ) - root.size() );
+    file.write ( reinterpret_cast<const char *> ( d->patientData ), d->patientCount * sizeof ( PatientRecord ) );
+    file.write ( reinterpret_cast<const char *> ( d->studyData ), d->studyCount * sizeof ( StudyRecord ) );
+    file.write ( reinterpret_cast<const char *> ( d->seriesData ), d->seriesCount * sizeof ( SeriesRecord ) );
+    file.write ( reinterpret_cast<const char *> ( d->instanceData ), d->instanceCount * sizeof ( InstanceRecord ) );
+    file.write ( d->stringData, d->stringSize );
+
+    return file.commit();
+}
+
+bool QtDcmMediaIndex::load ( const QString & filename, const QByteArray & key )
+{
+    if ( d->file.isOpen() ) {
+        d->file.close();
+        d->useVectors();
+    }
+
+    d->file.setFileName ( filename );
+    if ( !d->file.open ( QIODevice::ReadOnly ) || d->file.size() < qint64 ( sizeof ( FileHeader ) ) ) {
+        d->file.close();
+        return false;
+    }
+
+    const uchar * data = d->file.map ( 0, d->file.size() );
+    if ( !data ) {
+        d->file.close();
+        return false;
+    }
+
+    FileHeader header;
+    memcpy ( &header, data, sizeof ( header ) );
+
+    // The sizes must fit in the file before any offset is computed from them, padded() wraps near 2^32
+    if ( header.keySize > d->file.size() || header.rootSize > d->file.size()
+         || header.keySize > INT_MAX || header.rootSize > INT_MAX ) {
+        d->file.close();
+        return false;
+    }
+
+    const qint64 keyOffset = sizeof ( FileHeader );
+    const qint64 rootOffset = keyOffset + padded ( header.keySize );
+    const qint64 patientOffset = rootOffset + padded ( header.rootSize );
+    if ( rootOffset < keyOffset + header.keySize || rootOffset + header.rootSize > patientOffset
+         || patientOffset > d->file.size() ) {
+        d->file.close();
+        return false;
+    }
+
+    const qint64 studyOffset = patientOffset + qint64 ( header.patientCount ) * sizeof ( PatientRecord );
+    const qint64 seriesOffset = studyOffset + qint64 ( header.studyCount ) * sizeof ( StudyRecord );
+    const qint64 instanceOffset = seriesOffset + qint64 ( header.seriesCount ) * sizeof ( SeriesRecord );
+    const qint64 stringOffset = instanceOffset + qint64 ( header.instanceCount ) * sizeof ( InstanceRecord );
+
+    // Anything unexpected (older version, other media, truncated file) means the index must be rebuilt
+    if ( memcmp ( header.magic, Magic, sizeof ( Magic ) ) != 0
+         || header.version != Version
+         || stringOffset + header.stringSize != d->file.size()
+         || header.stringSize == 0
+         || QByteArray::fromRawData ( reinterpret_cast<const char *> ( data + keyOffset ), header.keySize ) != key ) {
+        d->file.close();
+        return false;
+    }
+
+    const PatientRecord * patients = reinterpret_cast<const PatientRecord *> ( data + patientOffset );
+    const StudyRecord * studies = reinterpret_cast<const StudyRecord *> ( data + studyOffset );
+    const SeriesRecord * series = reinterpret_cast<const SeriesRecord *> ( data + seriesOffset );
+    const InstanceRecord * instances = reinterpret_cast<const InstanceRecord *> ( data + instanceOffset );
+    const char * strings = reinterpret_cast<const char *> ( data + stringOffset );
+
+    // The records are browsed without any check, so a corrupted file must not get further
+    bool valid = header.patientCount <= INT_MAX && header.studyCount <= INT_MAX
+                 && header.seriesCount <= INT_MAX && header.instanceCount <= INT_MAX
+                 && header.stringSize <= INT_MAX && strings[header.stringSize - 1] == '\0';
+
+    for ( quint32 i = 0; valid && i < header.patientCount; ++i ) {
+        const PatientRecord & record = patients[i];
+        valid = validRange ( record.firstStudy, record.studyCount, header.studyCount )
+                && validString ( record.name, header.stringSize ) && validString ( record.id, header.stringSize )
+                && validString ( record.birthdate, header.stringSize ) && validString ( record.sex, header.stringSize );
+    }
+
+    for ( quint32 i = 0; valid && i < header.studyCount; ++i ) {
+        const StudyRecord & record = studies[i];
+        valid = record.patient < header.patientCount
+                && validRange ( record.firstSeries, record.seriesCount, header.seriesCount )
+                && validString ( record.uid, header.stringSize ) && validString ( record.id, header.stringSize )
+                && validString ( record.description, header.stringSize ) && validString ( record.date, header.stringSize );
+    }
+
+    for ( quint32 i = 0; valid && i < header.seriesCount; ++i ) {
+        const SeriesRecord & record = series[i];
+        valid = record.study < header.studyCount
+                && validRange ( record.firstInstance, record.instanceCount, header.instanceCount )
+                && validString ( record.uid, header.stringSize ) && validString ( record.description, header.stringSize )
+                && validString ( record.modality, header.stringSize ) && validString ( record.institution, header.stringSize )
+                && validString ( record.acquisitionNumber, header.stringSize )
+                && validString ( record.performingPhysician, header.stringSize );
+    }
+
+    for ( quint32 i = 0; valid && i < header.instanceCount; ++i ) {
+        const InstanceRecord & record = instances[i];
+        valid = record.series < header.seriesCount
+                && validString ( record.uid, header.stringSize ) && validString ( record.file, header.stringSize );
+    }
+
+    if ( !valid ) {
+        qWarning() << "Corrupted media index" << filename;
+        d->file.close();
+        return false;
+    }
+
+    d->patients.clear();
+    d->studies.clear();
+    d->series.clear();
+    d->instances.clear();
+    d->strings.clear();
+
+    d->rootDirectory = QString::fromUtf8 ( reinterpret_cast<const char *> ( data + rootOffset ), header.rootSize );
+    d->patientData = patients;
+    d->studyData = studies;
+    d->seriesData = series;
+    d->instanceData = instances;
+    d->stringData = strings;
+    d->patientCount = header.patientCount;
+    d->studyCount = header.studyCount;
+    d->seriesCount = header.seriesCount;
+    d->instanceCount = header.instanceCount;
+    d->stringSize = header.stringSize;
+
+    return true;
+}
+
+bool QtDcmMediaIndex::isEmpty() const
+{
+    return d->instanceCount == 0;
+}
+
+int QtDcmMediaIndex::patientCount() const
+{
+    return d->patientCount;
+}
+
+int QtDcmMediaIndex::studyCount() const
+{
+    return d->studyCount;
+}
+
+int QtDcmMediaIndex::seriesCount() const
+{
+    return d->seriesCount;
+}
+
+int QtDcmMediaIndex::instanceCount() const
+{
+    return d->instanceCount;
+}
+
+const QtDcmMediaIndex::PatientRecord & QtDcmMediaIndex::patient ( int index ) const
+{
+    return d->patientData[index];
+}
+
+const QtDcmMediaIndex::StudyRecord & QtDcmMediaIndex::study ( int index ) const
+{
+    return d->studyData[index];
+}
+
+const QtDcmMediaIndex::SeriesRecord & QtDcmMediaIndex::serie ( int index ) const
+{
+    return d->seriesData[index];
+}
+
+const QtDcmMediaIndex::InstanceRecord & QtDcmMediaIndex::instance ( int index ) const
+{
+    return d->instanceData[index];
+}
+
+QString QtDcmMediaIndex::string ( quint32 offset ) const
+{
+    if ( offset >= quint32 ( d->stringSize ) ) {
+        return QString();
+    }
+
+    return QString::fromUtf8 ( d->stringData + offset );
+}
+
+QString QtDcmMediaIndex::filename ( const InstanceRecord & instance ) const
+{
+    return d->rootDirectory + "/" + this->string ( instance.file );
+}
+
+int QtDcmMediaIndex::findSerie ( const QString & uid ) const
+{
+    for ( int i = 0; i < d->seriesCount; ++i ) {
+        if ( this->string ( d->seriesData[i].uid ) == uid ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+QStringList QtDcmMediaIndex::serieFilenames ( const QString & uid ) const
+{
+    QStringList filenames;
+    const int index = this->findSerie ( uid );
+    if ( index < 0 ) {
+        return filenames;
+    }
+
+    const SeriesRecord & record = d->seriesData[index];
+    filenames.reserve ( record.instanceCount );
+    for ( quint32 i = record.firstInstance; i < record.firstInstance + record.instanceCount; ++i ) {
+        filenames.append ( this->filename ( d->instanceData[i] ) );
+    }
+
+    return filenames;
+}
+
+QString QtDcmMediaIndex::instanceFilename ( const QString & serieUid, const QString & instanceUid ) const
+{
+    const int index = this->findSerie ( serieUid );
+    if ( index < 0 ) {
+        return QString();
+    }
+
+    const SeriesRecord & record = d->seriesData[index];
+    for ( quint32 i = record.firstInstance; i < record.firstInstance + record.instanceCount; ++i ) {
+        if ( this->string ( d->instanceData[i].uid ) == instanceUid ) {
+            return this->filename ( d->instanceData[i] );
+        }
+    }
+
+    return QString();
+}
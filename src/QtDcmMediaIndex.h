@@ -0,0 +1,192 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMMEDIAINDEX_H_
+#define QTDCMMEDIAINDEX_H_
+
+#include <QtGui>
+
+/**
+ * This class is a compact patient/study/series/instance hierarchy of a dicom media
+ * that has no DICOMDIR. It is filled by QtDcmMediaScanner and browsed by QtDcmFindMediaIndex.
+ *
+ * All strings are stored once in a single UTF-8 pool and records only keep offsets in it,
+ * so that hundreds of thousands of instances stay cheap to hold in memory.
+ * Once finalize() has been called, the children of each record are contiguous
+ * (firstXxx / xxxCount ranges).
+ *
+ * The records only hold integers, so a finalized index is saved as is and loaded back
+ * by memory mapping the file, without any parsing.
+ */
+class QtDcmMediaIndex
+{
+public:
+    struct PatientRecord
+    {
+        quint32 name;
+        quint32 id;
+        quint32 birthdate;
+        quint32 sex;
+        quint32 firstStudy;
+        quint32 studyCount;
+    };
+
+    struct StudyRecord
+    {
+        quint32 uid;
+        quint32 id;
+        quint32 description;
+        quint32 date;
+        quint32 patient;
+        quint32 firstSeries;
+        quint32 seriesCount;
+    };
+
+    struct SeriesRecord
+    {
+        quint32 uid;
+        quint32 description;
+        quint32 modality;
+        quint32 institution;
+        quint32 acquisitionNumber;
+        quint32 performingPhysician;
+        quint32 study;
+        quint32 firstInstance;
+        quint32 instanceCount;
+    };
+
+    struct InstanceRecord
+    {
+        quint32 uid;
+        qint32 number;
+        quint32 file;
+        quint32 series;
+    };
+
+    /**
+     * Header attributes read from one dicom file, as produced by the scanner
+     */
+    struct InstanceInfo
+    {
+        QByteArray patientName;
+        QByteArray patientId;
+        QByteArray patientBirthdate;
+        QByteArray patientSex;
+        QByteArray studyUid;
+        QByteArray studyId;
+        QByteArray studyDescription;
+        QByteArray studyDate;
+        QByteArray seriesUid;
+        QByteArray seriesDescription;
+        QByteArray modality;
+        QByteArray institution;
+        QByteArray acquisitionNumber;
+        QByteArray performingPhysician;
+        QByteArray sopInstanceUid;
+        qint32 instanceNumber;
+        QByteArray file; /** UTF-8 path relative to the root directory */
+    };
+
+    QtDcmMediaIndex();
+    virtual ~QtDcmMediaIndex();
+
+    /**
+     * Root directory of the media, instance files are stored relative to it
+     */
+    QString rootDirectory() const;
+    void setRootDirectory ( const QString & directory );
+
+    /**
+     * Add an instance to the hierarchy, creating its patient, study and serie if needed.
+     * Instances already present (same SOPInstanceUID) are ignored.
+     */
+    void addInstance ( const InstanceInfo & info );
+
+    /**
+     * Sort the records so that children are contiguous and release the lookup tables
+     * used while building. Must be called before browsing the index.
+     */
+    void finalize();
+
+    /**
+     * Write the finalized index to a file
+     *
+     * @param filename the index file
+     * @param key identifies the media the index was built from, checked by load()
+     * @return true if the file has been written
+     */
+    bool save ( const QString & filename, const QByteArray & key ) const;
+
+    /**
+     * Map an index file written by save(). The file stays mapped until the index is destroyed,
+     * the index can only be browsed afterwards.
+     *
+     * @param filename the index file
+     * @param key must be the key given to save()
+     * @return false if the file is missing, invalid, or was built for another key
+     */
+    bool load ( const QString & filename, const QByteArray & key );
+
+    bool isEmpty() const;
+
+    int patientCount() const;
+    int studyCount() const;
+    int seriesCount() const;
+    int instanceCount() const;
+
+    const PatientRecord & patient ( int index ) const;
+    const StudyRecord & study ( int index ) const;
+    const SeriesRecord & serie ( int index ) const;
+    const InstanceRecord & instance ( int index ) const;
+
+    /**
+     * Decode a string of the pool
+     *
+     * @param offset as stored in a record
+     */
+    QString string ( quint32 offset ) const;
+
+    /**
+     * Absolute filename of an instance
+     */
+    QString filename ( const InstanceRecord & instance ) const;
+
+    /**
+     * Index of the serie with the given SeriesInstanceUID, -1 if not found
+     */
+    int findSerie ( const QString & uid ) const;
+
+    /**
+     * Absolute filenames of all the instances of a serie
+     */
+    QStringList serieFilenames ( const QString & uid ) const;
+
+    /**
+     * Absolute filename of an instance of a serie, empty if not found
+     */
+    QString instanceFilename ( const QString & serieUid, const QString & instanceUid ) const;
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmMediaIndex )
+};
+
+#endif /* QTDCMMEDIAINDEX_H_ */
@@ -0,0 +1,255 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcdatset.h>
+
+#include <QtDcmMediaIndex.h>
+#include <QtDcmMediaScanner.h>
+#include <QtDcmThreadBudget.h>
+
+namespace
+{
+const int BatchSize = 128;                /** Number of files parsed by one pool task */
+const Uint32 MaxReadLength = 1024;        /** Larger elements are left on disk while parsing */
+
+/**
+ * State shared between the scanner and its parsing tasks
+ */
+struct ScanState
+{
+    QtDcmMediaScanner * scanner;
+    QtDcmMediaIndex * index;
+    QDir root;
+    QMutex mutex;                         /** Protects index */
+    QAtomicInt done;
+    int total;
+};
+
+QByteArray tagValue ( DcmItem * item, const DcmTagKey & key )
+{
+    OFString value;
+    if ( item->findAndGetOFStringArray ( key, value ).bad() ) {
+        return QByteArray();
+    }
+
+    return QByteArray ( value.c_str() ).trimmed();
+}
+
+bool readHeader ( const QString & filename, const QDir & root, QtDcmMediaIndex::InstanceInfo & info )
+{
+    DcmFileFormat file;
+    OFFilename dcmFileName ( filename.toStdString().c_str(), OFTrue );
+
+    // Stop before the pixel data, everything we need is in the header
+    if ( file.loadFileUntilTag ( dcmFileName, EXS_Unknown, EGL_noChange, MaxReadLength, ERM_autoDetect, DCM_PixelData ).bad() ) {
+        return false;
+    }
+
+    DcmDataset * dset = file.getDataset();
+    info.sopInstanceUid = tagValue ( dset, DCM_SOPInstanceUID );
+    info.seriesUid = tagValue ( dset, DCM_SeriesInstanceUID );
+    if ( info.sopInstanceUid.isEmpty() || info.seriesUid.isEmpty() ) {
+        return false;
+    }
+
+    info.patientName = tagValue ( dset, DCM_PatientName );
+    info.patientId = tagValue ( dset, DCM_PatientID );
+    info.patientBirthdate = tagValue ( dset, DCM_PatientBirthDate );
+    info.patientSex = tagValue ( dset, DCM_PatientSex );
+    info.studyUid = tagValue ( dset, DCM_StudyInstanceUID );
+    info.studyId = tagValue ( dset, DCM_StudyID );
+    info.studyDescription = tagValue ( dset, DCM_StudyDescription );
+    info.studyDate = tagValue ( dset, DCM_StudyDate );
+    info.seriesDescription = tagValue ( dset, DCM_SeriesDescription );
+    info.modality = tagValue ( dset, DCM_Modality );
+    info.institution = tagValue ( dset, DCM_InstitutionName );
+    info.acquisitionNumber = tagValue ( dset, DCM_AcquisitionNumber );
+    info.performingPhysician = tagValue ( dset, DCM_PerformingPhysicianName );
+    info.instanceNumber = tagValue ( dset, DCM_InstanceNumber ).toInt();
+    info.file = root.relativeFilePath ( filename ).toUtf8();
+
+    return true;
+}
+
+/**
+ * Identifies the content of a media : its root directory, the volume it is on and the most
+ * recent change in its tree. Adding or removing a file updates the modification time of its
+ * directory, so only the directories are listed here.
+ */
+QByteArray mediaKey ( const QString & root )
+{
+    const QStorageInfo volume ( root );
+    qint64 lastModified = QFileInfo ( root ).lastModified().toMSecsSinceEpoch();
+    int directoryCount = 1;
+
+    QDirIterator it ( root, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories );
+    while ( it.hasNext() ) {
+        it.next();
+        lastModified = qMax ( lastModified, it.fileInfo().lastModified().toMSecsSinceEpoch() );
+        directoryCount++;
+    }
+
+    return root.toUtf8() + '\n'
+           + volume.device() + '\n'
+           + QByteArray::number ( volume.bytesTotal() ) + '\n'
+           + QByteArray::number ( directoryCount ) + '\n'
+           + QByteArray::number ( lastModified );
+}
+
+class ScanTask : public QRunnable
+{
+public:
+    ScanTask ( ScanState * state, const QStringList & files )
+        : state ( state ), files ( files ) {}
+
+    void run()
+    {
+        QVector<QtDcmMediaIndex::InstanceInfo> infos;
+        infos.reserve ( files.size() );
+
+        for ( const QString & filename : files ) {
+            QtDcmMediaIndex::InstanceInfo info;
+            if ( readHeader ( filename, state->root, info ) ) {
+                infos.append ( info );
+            }
+        }
+
+        {
+            QMutexLocker locker ( &state->mutex );
+            for ( const QtDcmMediaIndex::InstanceInfo & info : infos ) {
+                state->index->addInstance ( info );
+            }
+        }
+
+        const int done = state->done.fetchAndAddOrdered ( files.size() ) + files.size();
+        emit state->scanner->updateProgress ( ( int ) ( ( 100.0 * done ) / state->total ) );
+    }
+
+private:
+    ScanState * state;
+    QStringList files;
+};
+}
+
+class QtDcmMediaScanner::Private
+{
+public:
+    QString directory;
+    QString cacheDirectory;
+    int maxThreadCount;
+    QSharedPointer<QtDcmMediaIndex> index;
+};
+
+QtDcmMediaScanner::QtDcmMediaScanner ( QObject * parent )
+    : QThread ( parent ),
+      d ( new QtDcmMediaScanner::Private )
+{
+    d->maxThreadCount = QtDcmThreadBudget::decodingThreads();
+    d->cacheDirectory = QDir::homePath() + QDir::separator() + ".qtdcm" + QDir::separator() + "mediaindex";
+}
+
+QtDcmMediaScanner::~QtDcmMediaScanner()
+{
+    delete d;
+    d = NULL;
+}
+
+void QtDcmMediaScanner::setDirectory ( const QString & directory )
+{
+    d->directory = directory;
+}
+
+void QtDcmMediaScanner::setCacheDirectory ( const QString & directory )
+{
+    d->cacheDirectory = directory;
+}
+
+void QtDcmMediaScanner::setMaxThreadCount ( int count )
+{
+    d->maxThreadCount = count;
+}
+
+QSharedPointer<QtDcmMediaIndex> QtDcmMediaScanner::index() const
+{
+    return d->index;
+}
+
+void QtDcmMediaScanner::run()
+{
+    d->index.clear();
+    emit updateProgress ( 0 );
+
+    QSharedPointer<QtDcmMediaIndex> index ( new QtDcmMediaIndex );
+    index->setRootDirectory ( QDir ( d->directory ).absolutePath() );
+
+    // One index file per root directory, reused as long as the media has not changed
+    QString cacheFile;
+    QByteArray key;
+    if ( !d->cacheDirectory.isEmpty() ) {
+        const QByteArray rootHash = QCryptographicHash::hash ( index->rootDirectory().toUtf8(), QCryptographicHash::Sha1 ).toHex();
+        cacheFile = d->cacheDirectory + QDir::separator() + QString::fromLatin1 ( rootHash ) + ".idx";
+        key = mediaKey ( index->rootDirectory() );
+
+        if ( index->load ( cacheFile, key ) ) {
+            qDebug() << "Using media index" << cacheFile;
+            d->index = index;
+            emit updateProgress ( 100 );
+            return;
+        }
+    }
+
+    // Only list the files here, the headers are read by the pool
+    QStringList files;
+    QDirIterator it ( d->directory, QDir::Files | QDir::Readable, QDirIterator::Subdirectories );
+    while ( it.hasNext() ) {
+        const QString filename = it.next();
+        if ( it.fileName().compare ( "DICOMDIR", Qt::CaseInsensitive ) != 0 ) {
+            files.append ( filename );
+        }
+    }
+
+    qDebug() << "Scanning" << files.size() << "files in" << index->rootDirectory();
+
+    ScanState state;
+    state.scanner = this;
+    state.index = index.data();
+    state.root = QDir ( index->rootDirectory() );
+    state.total = files.size();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount ( qMax ( 1, d->maxThreadCount ) );
+    for ( int i = 0; i < files.size(); i += BatchSize ) {
+        pool.start ( new ScanTask ( &state, files.mid ( i, BatchSize ) ) );
+    }
+    pool.waitForDone();
+
+    index->finalize();
+    qDebug() << "Found" << index->instanceCount() << "instances in" << index->seriesCount() << "series";
+
+    if ( !cacheFile.isEmpty() && QDir().mkpath ( d->cacheDirectory ) ) {
+        index->save ( cacheFile, key );
+    }
+
+    d->index = index;
+    emit updateProgress ( 100 );
+}
@@ -0,0 +1,70 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMMEDIASCANNER_H_
+#define QTDCMMEDIASCANNER_H_
+
+#include <QtGui>
+
+class QtDcmMediaIndex;
+
+/**
+ * This class crawls a directory tree that has no DICOMDIR and builds a QtDcmMediaIndex.
+ *
+ * Files are parsed in parallel on a thread pool and only up to the pixel data,
+ * large elements are never loaded in memory.
+ * The index is saved in a cache directory, so that reopening an unchanged media only maps it back.
+ */
+class QtDcmMediaScanner : public QThread
+{
+    Q_OBJECT
+
+public:
+    QtDcmMediaScanner ( QObject * parent = 0 );
+    virtual ~QtDcmMediaScanner();
+
+    void setDirectory ( const QString & directory );
+
+    /**
+     * Directory where the built indexes are kept (~/.qtdcm/mediaindex by default),
+     * an empty string disables the cache
+     */
+    void setCacheDirectory ( const QString & directory );
+
+    /**
+     * Maximum number of parsing threads, QtDcmThreadBudget::decodingThreads() by default
+     */
+    void setMaxThreadCount ( int count );
+
+    /**
+     * The index built by the last run, null until the scan is finished
+     */
+    QSharedPointer<QtDcmMediaIndex> index() const;
+
+    void run();
+
+signals:
+    void updateProgress ( int i );
+
+private:
+    class Private;
+    Private * d;
+};
+
+#endif /* QTDCMMEDIASCANNER_H_ */
@@ -27,6 +27,7 @@
 #include <QtDcmManager.h>
 #include <QtDcmMoveDicomdir.h>
 #include <QtDcmConvert.h>
+#include <QtDcmMediaIndex.h>
 
 class QtDcmMoveDicomdirPrivate
 {
@@ -35,12 +36,13 @@ public:
     QString outputDir;
     QString importDir;
     DcmItem * dcmObject;
+    QSharedPointer<QtDcmMediaIndex> mediaIndex;     /** Used instead of the dicomdir when set */
     DcmStack dicomdirItems;
     QStringList filenames;
     QStringList series;
     QtDcmMoveDicomdir::eMoveMode mode;
     int index;
-    QString uid;
+    QStringList uids;
 };
 
 QtDcmMoveDicomdir::QtDcmMoveDicomdir ( QObject * parent ) 
@@ -66,6 +68,11 @@ void QtDcmMoveDicomdir::setDcmItem ( DcmItem * item )
     d->dcmObject = item;
 }
 
+void QtDcmMoveDicomdir::setMediaIndex ( QSharedPointer<QtDcmMediaIndex> index )
+{
+    d->mediaIndex = index;
+}
+
 void QtDcmMoveDicomdir::setSeries ( const QStringList & series )
 {
     d->series = series;
@@ -78,7 +85,12 @@ void QtDcmMoveDicomdir::setIndex ( int index )
 
 void QtDcmMoveDicomdir::setImageId ( const QString & uid)
 {
-    d->uid = uid;
+    d->uids = QStringList() << uid;
+}
+
+void QtDcmMoveDicomdir::setImageIds ( const QStringList & uids )
+{
+    d->uids = uids;
 }
 
 
@@ -105,87 +117,133 @@ void QtDcmMoveDicomdir::run()
 
         d->filenames.clear();
 
-        bool proceed = false;
-        bool proceedIndex = false;
-
-        static const OFString Patient ( "PATIENT" );
-        static const OFString Study ( "STUDY" );
-        static const OFString Series ( "SERIES" );
-        static const OFString Image ( "IMAGE" );
+        if ( d->mediaIndex ) {
+            if ( d->mode == QtDcmMoveDicomdir::IMPORT ) {
+                d->filenames = d->mediaIndex->serieFilenames ( d->series.at ( s ) );
+            }
+            else {
+                for ( const QString & uid : d->uids ) {
+                    const QString filename = d->mediaIndex->instanceFilename ( d->series.at ( s ), uid );
+                    if ( !filename.isEmpty() ) {
+                        d->filenames.append ( filename );
+                    }
+                }
+            }
+        }
+        else if ( !this->findDicomdirFilenames ( d->series.at ( s ) ) ) {
+            return;
+        }
 
-        // Loading all the dicomdir items in a stack
-        DcmStack itemsTmp;
+        if ( d->mode == QtDcmMoveDicomdir::IMPORT ) {
+            for ( int i = 0; i < d->filenames.size(); i++ ) {
+                QFile image ( d->filenames.at ( i ) );
 
-        if ( !d->dcmObject->findAndGetElements ( DCM_Item, itemsTmp ).good() )
-            return;
+                if ( image.exists() ) {
+                    QString zeroStr;
+                    zeroStr.fill ( QChar ( '0' ), 5 - QString::number ( i ).size() );
+                    QString newFile(serieDir.absolutePath() + QDir::separator() + "ima" + zeroStr + QString::number ( i ));
+                    image.copy(newFile);
+                    QFile(newFile).setPermissions(QFileDevice::WriteOwner);
+                    
+                    emit updateProgress ( progress + ( int ) ( ( ( float ) ( step * ( i + 1 ) / d->filenames.size() ) ) ) );
+                }
+            }
 
-        while ( itemsTmp.card() > 0 ) {
-            d->dicomdirItems.push ( itemsTmp.top() );
-            itemsTmp.pop();
+            progress += step;
+            emit updateProgress(progress);
+            emit serieMoved ( serieDir.absolutePath(), d->series.at ( s ) , s );
+        }
+        else {
+            for ( const QString & filename : d->filenames ) {
+                emit previewSlice ( filename );
+            }
         }
+    }
+}
 
-        OFString strName;
-        OFString strDate;
-        OFString strDesc;
+bool QtDcmMoveDicomdir::findDicomdirFilenames ( const QString & serie )
+{
+    bool proceed = false;
+    bool proceedIndex = false;
 
-        //Unstacking and loading the different lists
+    static const OFString Patient ( "PATIENT" );
+    static const OFString Study ( "STUDY" );
+    static const OFString Series ( "SERIES" );
+    static const OFString Image ( "IMAGE" );
 
-        while ( d->dicomdirItems.card() > 0 ) {
-            DcmItem* lobj = ( DcmItem* ) d->dicomdirItems.top();
-            DcmStack dirent;
+    // Loading all the dicomdir items in a stack
+    DcmStack itemsTmp;
 
-            OFCondition condition = lobj->findAndGetElements ( DCM_DirectoryRecordType, dirent );
+    if ( !d->dcmObject->findAndGetElements ( DCM_Item, itemsTmp ).good() )
+        return false;
 
-            if ( !condition.good() ) {
-                d->dicomdirItems.pop();
-                continue;
-            }
+    while ( itemsTmp.card() > 0 ) {
+        d->dicomdirItems.push ( itemsTmp.top() );
+        itemsTmp.pop();
+    }
 
-            while ( dirent.card() ) {
-                DcmElement* elt = ( DcmElement* ) dirent.top();
-                OFString cur;
-                elt->getOFStringArray ( cur );
+    OFString strName;
+    OFString strDate;
+    OFString strDesc;
 
-                if ( cur ==Patient ) {
-                    DcmElement* lelt;
+    //Unstacking and loading the different lists
 
-                    if ( lobj->findAndGetElement ( DCM_PatientName, lelt ).good() )
-                        lelt->getOFStringArray ( strName );
-                }
+    while ( d->dicomdirItems.card() > 0 ) {
+        DcmItem* lobj = ( DcmItem* ) d->dicomdirItems.top();
+        DcmStack dirent;
 
-                if ( cur == Study ) {
-                    DcmElement* lelt;
+        OFCondition condition = lobj->findAndGetElements ( DCM_DirectoryRecordType, dirent );
 
-                    if ( lobj->findAndGetElement ( DCM_StudyDate, lelt ).good() )
-                        lelt->getOFStringArray ( strDate );
-                }
+        if ( !condition.good() ) {
+            d->dicomdirItems.pop();
+            continue;
+        }
 
-                if ( cur == Series ) {
-                    DcmElement* lelt;
+        while ( dirent.card() ) {
+            DcmElement* elt = ( DcmElement* ) dirent.top();
+            OFString cur;
+            elt->getOFStringArray ( cur );
 
-                    if ( lobj->findAndGetElement ( DCM_SeriesInstanceUID, lelt ).good() ) {
-                        OFString strID;
-                        lelt->getOFStringArray ( strID );
-                        proceed = ( QString ( strID.c_str() ) == d->series.at ( s ) );
-                    }
+            if ( cur ==Patient ) {
+                DcmElement* lelt;
 
-                    if ( proceed ) {
-                        if ( lobj->findAndGetElement ( DCM_SeriesDescription, lelt ).good() )
-                            lelt->getOFStringArray ( strDesc );
-                    }
+                if ( lobj->findAndGetElement ( DCM_PatientName, lelt ).good() )
+                    lelt->getOFStringArray ( strName );
+            }
+
+            if ( cur == Study ) {
+                DcmElement* lelt;
+
+                if ( lobj->findAndGetElement ( DCM_StudyDate, lelt ).good() )
+                    lelt->getOFStringArray ( strDate );
+            }
+
+            if ( cur == Series ) {
+                DcmElement* lelt;
+
+                if ( lobj->findAndGetElement ( DCM_SeriesInstanceUID, lelt ).good() ) {
+                    OFString strID;
+                    lelt->getOFStringArray ( strID );
+                    proceed = ( QString ( strID.c_str() ) == serie );
+                }
+
+                if ( proceed ) {
+                    if ( lobj->findAndGetElement ( DCM_SeriesDescription, lelt ).good() )
+                        lelt->getOFStringArray ( strDesc );
                 }
+            }
 
-                if ( ( cur == Image ) && proceed ) {
-                    DcmElement* lelt;
+            if ( ( cur == Image ) && proceed ) {
+                DcmElement* lelt;
 
-                    if ( lobj->findAndGetElement ( DCM_ReferencedSOPInstanceUIDInFile, lelt ).good() ) {
-                        OFString strNumber;
-                        lelt->getOFStringArray ( strNumber );
+                if ( lobj->findAndGetElement ( DCM_ReferencedSOPInstanceUIDInFile, lelt ).good() ) {
+                    OFString strNumber;
+                    lelt->getOFStringArray ( strNumber );
 
-                        if ( d->mode == QtDcmMoveDicomdir::PREVIEW ) {
-                            proceedIndex = ( QString ( strNumber.c_str() ) == d->uid );
-                        }
+                    if ( d->mode == QtDcmMoveDicomdir::PREVIEW ) {
+                        proceedIndex = d->uids.contains ( QString ( strNumber.c_str() ) );
                     }
+                }
 
 //                     if ( lobj->findAndGetElement ( DCM_InstanceNumber, lelt ).good() )
 //                     {
@@ -196,59 +254,34 @@ void QtDcmMoveDicomdir::run()
 //                             proceedIndex = ( QString ( strNumber.c_str() ).toInt() == d->index );
 //                     }
 
-                    if ( lobj->findAndGetElement ( DCM_ReferencedFileID, lelt ).good() ) {
-                        OFString strFilename;
-                        lelt->getOFStringArray ( strFilename );
+                if ( lobj->findAndGetElement ( DCM_ReferencedFileID, lelt ).good() ) {
+                    OFString strFilename;
+                    lelt->getOFStringArray ( strFilename );
 
-                        if ( d->mode == QtDcmMoveDicomdir::IMPORT ) {
+                    if ( d->mode == QtDcmMoveDicomdir::IMPORT ) {
+                        d->filenames.append ( this->fixFilename ( QString ( strFilename.c_str() ) ) );
+                    }
+                    else {
+                        if ( proceedIndex ) {
                             d->filenames.append ( this->fixFilename ( QString ( strFilename.c_str() ) ) );
                         }
-                        else {
-                            if ( proceedIndex ) {
-                                d->filenames.append ( this->fixFilename ( QString ( strFilename.c_str() ) ) );
-                            }
-                        }
-
                     }
 
-                    if ( lobj->findAndGetElement ( DCM_SeriesDescription, lelt ).good() )
-                        lelt->getOFStringArray ( strDesc );
                 }
 
-                dirent.pop();
+                if ( lobj->findAndGetElement ( DCM_SeriesDescription, lelt ).good() )
+                    lelt->getOFStringArray ( strDesc );
             }
 
-            d->dicomdirItems.pop();
+            dirent.pop();
         }
 
-        d->dicomdirItems.clear();
-
-        if ( d->mode == QtDcmMoveDicomdir::IMPORT ) {
-            for ( int i = 0; i < d->filenames.size(); i++ ) {
-                QFile image ( d->filenames.at ( i ) );
+        d->dicomdirItems.pop();
+    }
 
-                if ( image.exists() ) {
-                    QString zeroStr;
-                    zeroStr.fill ( QChar ( '0' ), 5 - QString::number ( i ).size() );
-                    QString newFile(serieDir.absolutePath() + QDir::separator() + "ima" + zeroStr + QString::number ( i ));
-                    image.copy(newFile);
-                    QFile(newFile).setPermissions(QFileDevice::WriteOwner);
-                    
-                    emit updateProgress ( progress + ( int ) ( ( ( float ) ( step * ( i + 1 ) / d->filenames.size() ) ) ) );
-                }
-            }
+    d->dicomdirItems.clear();
 
-            progress += step;
-            emit updateProgress(progress);
-            emit serieMoved ( serieDir.absolutePath(), d->series.at ( s ) , s );
-        }
-        else {
-            if ( !d->filenames.isEmpty() ) {
-                QFile filename ( d->filenames.first() );
-                emit previewSlice ( filename.fileName() );
-            }
-        }
-    }
+    return true;
 }
 
 QString QtDcmMoveDicomdir::fixFilename ( const QString & name ) const
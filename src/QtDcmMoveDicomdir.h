@@ -23,6 +23,7 @@
 #include <QtGui>
 
 class DcmItem;
+class QtDcmMediaIndex;
 
 class QtDcmMoveDicomdirPrivate;
 
@@ -43,6 +44,11 @@ public:
 
     void setDcmItem ( DcmItem * item );
 
+    /**
+     * Take the filenames from a scanned media instead of the dicomdir
+     */
+    void setMediaIndex ( QSharedPointer<QtDcmMediaIndex> index );
+
     void setOutputDir ( const QString & dir );
 
     void setImportDir ( const QString & dir );
@@ -53,6 +59,11 @@ public:
 
     void setImageId ( const QString & uid );
 
+    /**
+     * Preview several instances of the serie, previewSlice is emitted for each of them
+     */
+    void setImageIds ( const QStringList & uids );
+
     void run();
 
 signals:
@@ -61,6 +72,8 @@ signals:
     void serieMoved(const QString & directory, const QString & serie, int number);
 
 private:
+    bool findDicomdirFilenames ( const QString & serie );
+
     QString fixFilename ( const QString & name ) const;
 
     QtDcmMoveDicomdirPrivate * d;
@@ -28,6 +28,7 @@
 #include <QtDcmServer.h>
 #include <QtDcmManager.h>
 #include <QtDcmMoveScu.h>
+#include <QtDcmVolumeAssembler.h>
 
 class QtDcmMoveScu::Private
 {
@@ -38,6 +39,14 @@ public:
     QString outputDir;
     QString importDir;
     QString currentSerie;
+    QtDcmSliceManifest manifest;             /** Slices of the current serie */
+    bool assembleVolumes;                    /** Build the volume of each serie from the received datasets */
+    bool writeFiles;                         /** Write the received datasets in the output directory */
+    QSharedPointer<QtDcmVolumeAssembler> assembler; /** Volume of the current serie */
+    bool slicesLost;                         /** Slices of the current serie were neither assembled nor written */
+    QAtomicInt cancelled;                    /** Set by onStopMove() from any thread, read by the mover thread */
+    bool cancelRequested;                    /** The C-CANCEL of the running move has been sent */
+    DIC_US moveMessageId;                    /** Message ID of the running C-MOVE request */
 
     QtDcmMoveScu::eMoveMode mode;
     QString queryLevel;
@@ -76,8 +85,102 @@ public:
     OFBool ignorePendingDatasets;
     DcmDataset overrideKeys;
     OFString outputDirectory;
+
+    /**
+     * Send a C-CANCEL for the running move, once. Only called from the callbacks of the move,
+     * so that the association is only used by the mover thread.
+     */
+    void requestCancel();
+
+    /**
+     * Record a written slice of the current serie in its manifest
+     */
+    void recordSlice ( DcmDataset * dataset, const QString & filename, const QString & sopInstanceUid );
+
+    /**
+     * Write the slices the volume assembler gave back when it could not assemble the serie
+     *
+     * @return false if a slice could not be written
+     */
+    bool writeAssembledSlices();
 };
 
+void QtDcmMoveScu::Private::requestCancel()
+{
+    if ( cancelRequested || !assoc || presId == 0 ) {
+        return;
+    }
+
+    qDebug() << "Cancelling the move";
+    DIMSE_sendCancelRequest ( assoc, presId, moveMessageId );
+    cancelRequested = true;
+}
+
+void QtDcmMoveScu::Private::recordSlice ( DcmDataset * dataset, const QString & filename, const QString & sopInstanceUid )
+{
+    // Record the geometry while the dataset is in memory, the converter won't read the file headers again
+    QtDcmSlice slice;
+    slice.filename = filename;
+    slice.sopInstanceUid = sopInstanceUid;
+    for ( int i = 0; i < 3; i++ ) {
+        slice.position[i] = 0;
+        dataset->findAndGetFloat64 ( DCM_ImagePositionPatient, slice.position[i], i );
+    }
+    for ( int i = 0; i < 6; i++ ) {
+        slice.orientation[i] = 0;
+        dataset->findAndGetFloat64 ( DCM_ImageOrientationPatient, slice.orientation[i], i );
+    }
+    Sint32 instanceNumber = 0;
+    dataset->findAndGetSint32 ( DCM_InstanceNumber, instanceNumber );
+    slice.instanceNumber = instanceNumber;
+    Uint16 rows = 0;
+    Uint16 columns = 0;
+    dataset->findAndGetUint16 ( DCM_Rows, rows );
+    dataset->findAndGetUint16 ( DCM_Columns, columns );
+    slice.rows = rows;
+    slice.columns = columns;
+    OFString acquisitionTime;
+    dataset->findAndGetOFString ( DCM_AcquisitionTime, acquisitionTime );
+    slice.acquisitionTime = QString ( acquisitionTime.c_str() ).trimmed();
+    manifest.append ( slice );
+}
+
+bool QtDcmMoveScu::Private::writeAssembledSlices()
+{
+    bool success = true;
+
+    // The assembler keeps the pixel data decompressed
+    const E_TransferSyntax xfer = ( writeTransferSyntax == EXS_Unknown ) ? EXS_LittleEndianExplicit : writeTransferSyntax;
+
+    for ( DcmDataset * dataset : assembler->takeDatasets() ) {
+        OFString sopClass;
+        OFString sopInstance;
+        dataset->findAndGetOFString ( DCM_SOPClassUID, sopClass );
+        dataset->findAndGetOFString ( DCM_SOPInstanceUID, sopInstance );
+
+        char imageFile[4096];
+        std::snprintf ( imageFile, sizeof ( imageFile ), "%s.%s", dcmSOPClassUIDToModality ( sopClass.c_str() ), sopInstance.c_str() );
+
+        OFFilename dcmFileName;
+        OFStandard::combineDirAndFilename ( dcmFileName, OFFilename ( outputDirectory, OFTrue ), OFFilename ( imageFile, OFTrue ), OFTrue );
+
+        DcmFileFormat fileFormat ( dataset );
+        const OFCondition cond = fileFormat.saveFile ( dcmFileName, xfer, sequenceType, groupLength,
+                                                       paddingType, OFstatic_cast ( Uint32, filepad ), OFstatic_cast ( Uint32, itempad ),
+                                                       useMetaheader ? EWM_fileformat : EWM_dataset );
+        if ( cond.good() ) {
+            recordSlice ( dataset, QString ( dcmFileName.getCharPointer() ), QString ( sopInstance.c_str() ) );
+        }
+        else {
+            qWarning() << "Cannot write" << dcmFileName.getCharPointer() << ":" << cond.text();
+            success = false;
+        }
+        delete dataset;
+    }
+
+    return success;
+}
+
 QtDcmMoveScu::QtDcmMoveScu ( QObject * parent ) 
     : QThread(parent), 
       d ( new QtDcmMoveScu::Private )
@@ -85,6 +188,9 @@ QtDcmMoveScu::QtDcmMoveScu ( QObject * parent )
     d->net = 0;
     d->assoc = 0;
     d->params = 0;
+    d->presId = 0;
+    d->cancelRequested = false;
+    d->moveMessageId = 0;
     d->file = 0;
     d->maxPDU = ASC_DEFAULTMAXPDU;
     d->useMetaheader = OFTrue;
@@ -111,6 +217,9 @@ QtDcmMoveScu::QtDcmMoveScu ( QObject * parent )
     d->queryLevel = "undefined";
 
     d->mode = QtDcmMoveScu::IMPORT;
+    d->assembleVolumes = false;
+    d->slicesLost = false;
+    d->writeFiles = true;
 }
 
 QtDcmMoveScu::~QtDcmMoveScu()
@@ -129,6 +238,12 @@ void QtDcmMoveScu::setImageId ( const QString & id )
     d->imageId = id;
 }
 
+void QtDcmMoveScu::setImageIds ( const QStringList & ids )
+{
+    // A list of UIDs is a multi-valued SOPInstanceUID key
+    d->imageId = ids.join ( "\\" );
+}
+
 void QtDcmMoveScu::setData ( const QStringList & data )
 {
     d->data = data;
@@ -149,11 +264,20 @@ void QtDcmMoveScu::setImportDir ( const QString & dir )
     d->importDir = dir;
 }
 
+void QtDcmMoveScu::setAssembleVolumes ( bool assemble )
+{
+    d->assembleVolumes = assemble;
+}
+
+void QtDcmMoveScu::setWriteFiles ( bool write )
+{
+    d->writeFiles = write;
+}
+
 void QtDcmMoveScu::onStopMove()
 {
-    if ( this->isRunning() ) {
-        ASC_dropNetwork ( &d->net );
-    }
+    // The network belongs to the mover thread, the move is cancelled from its callbacks
+    d->cancelled.storeRelease ( 1 );
 }
 
 void QtDcmMoveScu::run()
@@ -164,7 +288,7 @@ void QtDcmMoveScu::run()
     int step = (100-lowThreshold)/(d->data.size());
     emit updateProgress ( lowThreshold );
 
-    for ( int i = 0; i < d->data.size(); i++ ) {
+    for ( int i = 0; i < d->data.size() && !d->cancelled.loadAcquire(); i++ ) {
         d->currentSerie = d->data.at ( i );
         const QDir serieDir ( d->outputDir + QDir::separator() + d->data.at ( i ) );
 
@@ -172,13 +296,36 @@ void QtDcmMoveScu::run()
             QDir ( d->outputDir ).mkdir ( d->data.at ( i ) );
         }
 
+        d->manifest.clear();
+        d->assembler.clear();
+        d->slicesLost = false;
+        if ( d->assembleVolumes && d->mode == IMPORT ) {
+            d->assembler = QSharedPointer<QtDcmVolumeAssembler> ( new QtDcmVolumeAssembler );
+            d->assembler->setKeepDatasets ( !d->writeFiles );
+        }
         d->outputDirectory = QString ( d->outputDir + QDir::separator() + d->currentSerie ).toUtf8().constData(); //OK because this std::string contain utf8 and will be wrap into OFFilename with utf16 conversion if needed at line 755
 
         if ( d->mode == IMPORT ) {
             cond = this->move ( d->data.at ( i ) );
-            if (cond.status()==OF_ok)
+            if ( d->cancelled.loadAcquire() )
+            {
+                // A cancelled serie is incomplete, it must not be converted
+                emit updateProgress (0);
+                emit moveFailed ( QString ( "Move cancelled" ) );
+            }
+            else if ( cond.status()==OF_ok && d->slicesLost )
+            {
+                // Converting what was written would give an incomplete volume
+                emit updateProgress (0);
+                emit moveFailed ( QString ( "Some slices of the serie %1 could not be written" ).arg ( d->data.at ( i ) ) );
+            }
+            else if (cond.status()==OF_ok)
             {
                 emit updateProgress ( lowThreshold + ((i+1)*step));
+                if ( d->assembler && d->assembler->isValid() && d->assembler->sliceCount() > 0 ) {
+                    emit serieVolume ( d->data.at ( i ), d->assembler );
+                }
+                emit serieManifest ( d->data.at ( i ), d->manifest );
                 emit serieMoved ( serieDir.absolutePath(), d->data.at ( i ), i );
             }
             else
@@ -743,8 +890,6 @@ OFCondition QtDcmMoveScu::storeSCP ( T_ASC_Association *assoc, T_DIMSE_Message *
               dcmSOPClassUIDToModality(req->AffectedSOPClassUID),
               req->AffectedSOPInstanceUID);
 
-    self->d->assoc = assoc;
-
     self->d->imageFile = imageFile;
     DcmFileFormat dcmff;
     self->d->file = &dcmff;
@@ -780,6 +925,13 @@ void QtDcmMoveScu::storeSCPCallback ( void *callbackData, T_DIMSE_StoreProgress
     if ( progress->state == DIMSE_StoreEnd ) {
 
         *statusDetail = NULL;
+
+        // Nothing is kept once the move is cancelled, the PACS is asked to stop if no pending response did it yet
+        if ( self->d->cancelled.loadAcquire() ) {
+            self->d->requestCancel();
+            rsp->DimseStatus = STATUS_STORE_Refused_OutOfResources;
+            return;
+        }
         if ( ( imageDataSet != NULL ) && ( *imageDataSet != NULL ) && !self->d->bitPreserving && !self->d->ignore ) {
             /* create full path name for the output file */
             OFFilename dcmFileName;
@@ -787,16 +939,48 @@ void QtDcmMoveScu::storeSCPCallback ( void *callbackData, T_DIMSE_StoreProgress
             OFFilename dcmImageFile(self->d->imageFile, OFTrue);
             OFStandard::combineDirAndFilename (dcmFileName, dcmOutputDirectory, dcmImageFile, OFTrue /* allowEmptyDirName */ );
 
-            E_TransferSyntax xfer = self->d->writeTransferSyntax;
+            OFCondition cond = EC_Normal;
+            bool assembled = false;
+            bool written = false;
 
-            if ( xfer == EXS_Unknown ) xfer = ( *imageDataSet )->getOriginalXfer();
+            // Without dicom files the volume must take the slice, if it can't the slice is written as usual,
+            // after the ones the volume held
+            if ( self->d->assembler && !self->d->writeFiles ) {
+                assembled = self->d->assembler->addSlice ( *imageDataSet );
+                if ( !assembled && !self->d->writeAssembledSlices() ) {
+                    self->d->slicesLost = true;
+                }
+            }
+
+            if ( !assembled ) {
+                E_TransferSyntax xfer = self->d->writeTransferSyntax;
+
+                if ( xfer == EXS_Unknown ) xfer = ( *imageDataSet )->getOriginalXfer();
 
-            OFCondition cond = self->d->file->saveFile (dcmFileName, xfer, self->d->sequenceType, self->d->groupLength,
-                               self->d->paddingType, OFstatic_cast ( Uint32, self->d->filepad ), OFstatic_cast ( Uint32, self->d->itempad ),
-                               ( self->d->useMetaheader ) ? EWM_fileformat : EWM_dataset );
+                cond = self->d->file->saveFile (dcmFileName, xfer, self->d->sequenceType, self->d->groupLength,
+                                   self->d->paddingType, OFstatic_cast ( Uint32, self->d->filepad ), OFstatic_cast ( Uint32, self->d->itempad ),
+                                   ( self->d->useMetaheader ) ? EWM_fileformat : EWM_dataset );
+                written = true;
 
-            if ( QFile (dcmFileName.getCharPointer()).exists() ) {
-                emit self->previewSlice ( QString (dcmFileName.getCharPointer()) );
+                if ( QFile (dcmFileName.getCharPointer()).exists() ) {
+                    emit self->previewSlice ( QString (dcmFileName.getCharPointer()) );
+                }
+            }
+
+            // A slice missing from the manifest would silently leave a hole in the volume
+            if ( written && cond.bad() ) {
+                qWarning() << "Cannot write" << dcmFileName.getCharPointer() << ":" << cond.text();
+                self->d->slicesLost = true;
+                rsp->DimseStatus = STATUS_STORE_Refused_OutOfResources;
+            }
+
+            if ( written && cond.good() ) {
+                self->d->recordSlice ( *imageDataSet, QString (dcmFileName.getCharPointer()), QString ( req->AffectedSOPInstanceUID ) );
+
+                // Once written, the dataset can be decompressed in place for the volume
+                if ( self->d->assembler ) {
+                    self->d->assembler->addSlice ( *imageDataSet );
+                }
             }
 
             if ( ( rsp->DimseStatus == STATUS_Success ) && !self->d->ignore ) {
@@ -905,6 +1089,17 @@ void QtDcmMoveScu::moveCallback ( void *caller, T_DIMSE_C_MoveRQ * req, int resp
 
     DIMSE_dumpMessage ( temp_str, *rsp, DIMSE_INCOMING );
 
+    QtDcmMoveScu * self = reinterpret_cast<QtDcmMoveScu *> ( caller );
+    if ( self->d->cancelled.loadAcquire() ) {
+        self->d->requestCancel();
+    }
+
+    // The first response gives the number of slices of the serie, the volume is allocated once
+    if ( self->d->assembler && ( rsp->opts & O_MOVE_NUMBEROFREMAININGSUBOPERATIONS ) ) {
+        self->d->assembler->reserve ( rsp->NumberOfRemainingSubOperations + rsp->NumberOfCompletedSubOperations
+                                      + rsp->NumberOfFailedSubOperations + rsp->NumberOfWarningSubOperations );
+    }
+
     qDebug() << "Move Response " << responseCount << ":";
     foreach (const QString &msg, QString ( temp_str.c_str() ).split('\n')) {
         qDebug() << msg;   
@@ -969,6 +1164,8 @@ OFCondition QtDcmMoveScu::moveSCU ( T_ASC_Association * assoc, const char *fname
     if ( d->presId == 0 ) return DIMSE_NOVALIDPRESENTATIONCONTEXTID;
 
     req.MessageID = msgId;
+    d->moveMessageId = msgId;
+    d->cancelRequested = false;
 
     strcpy ( req.AffectedSOPClassUID, sopClass );
 
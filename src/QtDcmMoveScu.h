@@ -46,6 +46,8 @@
 #define INCLUDE_CSIGNAL
 
 #include <QtDcmConvert.h>
+#include <QtDcmSliceManifest.h>
+#include <QtDcmVolumeAssembler.h>
 
 class QtDcmMoveScu : public QThread
 {
@@ -84,10 +86,27 @@ public:
 
     void setImageId ( const QString & id );
 
+    /**
+     * Preview several instances of the serie with a single IMAGE level move,
+     * previewSlice is emitted as each of them is received
+     */
+    void setImageIds ( const QStringList & ids );
+
     void setOutputDir ( const QString & dir );
 
     void setImportDir ( const QString & dir );
 
+    /**
+     * Build the volume of each imported serie from the datasets as they arrive (off by default)
+     */
+    void setAssembleVolumes ( bool assemble );
+
+    /**
+     * Write the received datasets in the output directory (on by default). When volumes are assembled
+     * the files are only needed by other tools, the slices that can't be assembled are always written.
+     */
+    void setWriteFiles ( bool write );
+
     void setData ( const QStringList & data );
 
     void setQueryLevel( const QString &queryLevel);
@@ -96,11 +115,24 @@ public:
 
     QString getOutputDir();
 public slots:
+    /**
+     * Ask the move to stop, returns at once. The mover thread sends a C-CANCEL to the PACS from
+     * the callbacks of the move and finishes once the PACS has answered : wait for finished()
+     * before starting another move on the local port.
+     */
     void onStopMove();
     
 signals:
     void updateProgress ( int i );
     void previewSlice ( const QString & filename );
+    /**
+     * Slices received for a serie, emitted just before serieMoved
+     */
+    void serieManifest(const QString & uid, const QtDcmSliceManifest & manifest);
+    /**
+     * Volume assembled from the received datasets, emitted just before serieMoved
+     */
+    void serieVolume(const QString & uid, QSharedPointer<QtDcmVolumeAssembler> volume);
     void serieMoved(const QString & directory, const QString & uid, int number);
     void moveFailed(const QString &message);
     void moveInProgress(const QString &message);
@@ -0,0 +1,331 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <cmath>
+#include <cstring>
+
+#include <QtDcmGzipWriter.h>
+#include <QtDcmNiftiWriter.h>
+
+namespace
+{
+const int HeaderSize = 348;
+const int VoxOffset = 352;                  /** Header and the 4 bytes of the (empty) extension flag */
+
+template <typename T>
+void put ( char * header, int offset, T value )
+{
+    memcpy ( header + offset, &value, sizeof ( T ) );
+}
+
+int bitsPerVoxel ( QtDcmNiftiWriter::eDatatype datatype )
+{
+    switch ( datatype ) {
+    case QtDcmNiftiWriter::UINT8:
+    case QtDcmNiftiWriter::INT8:
+        return 8;
+    case QtDcmNiftiWriter::INT16:
+    case QtDcmNiftiWriter::UINT16:
+        return 16;
+    case QtDcmNiftiWriter::RGB24:
+        return 24;
+    case QtDcmNiftiWriter::INT32:
+    case QtDcmNiftiWriter::UINT32:
+    case QtDcmNiftiWriter::FLOAT32:
+        return 32;
+    case QtDcmNiftiWriter::FLOAT64:
+        return 64;
+    }
+    return 0;
+}
+}
+
+class QtDcmNiftiWriter::Private
+{
+public:
+    QSaveFile file;
+    QScopedPointer<QtDcmGzipWriter> gzip;   /** Compresses the voxels of a .nii.gz */
+    int compressionLevel;
+    eDatatype datatype;
+    int dimensions[4];
+    double spacing[3];
+    double origin[3];
+    double direction[3][3];
+    qint64 written;
+
+    QByteArray header() const;
+};
+
+QByteArray QtDcmNiftiWriter::Private::header() const
+{
+    QByteArray bytes ( VoxOffset, '\0' );
+    char * h = bytes.data();
+
+    const int dimensionCount = ( dimensions[3] > 1 ) ? 4 : 3;
+
+    put<qint32> ( h, 0, HeaderSize );
+    put<qint16> ( h, 40, dimensionCount );
+    for ( int i = 0; i < 4; i++ ) {
+        put<qint16> ( h, 42 + 2 * i, dimensions[i] );
+    }
+    for ( int i = 4; i < 7; i++ ) {
+        put<qint16> ( h, 42 + 2 * i, 1 );
+    }
+    put<qint16> ( h, 70, datatype );
+    put<qint16> ( h, 72, bitsPerVoxel ( datatype ) );
+
+    // Voxel to RAS matrix : the DICOM (LPS) x and y axes are flipped
+    double matrix[3][4];
+    for ( int i = 0; i < 3; i++ ) {
+        const double flip = ( i < 2 ) ? -1 : 1;
+        for ( int j = 0; j < 3; j++ ) {
+            matrix[i][j] = flip * direction[i][j] * spacing[j];
+        }
+        matrix[i][3] = flip * origin[i];
+    }
+
+    // Rotation part as a quaternion (nifti_mat44_to_quatern, the direction is orthonormal)
+    double r[3][3];
+    for ( int i = 0; i < 3; i++ ) {
+        const double flip = ( i < 2 ) ? -1 : 1;
+        for ( int j = 0; j < 3; j++ ) {
+            r[i][j] = flip * direction[i][j];
+        }
+    }
+    const double determinant = r[0][0] * ( r[1][1] * r[2][2] - r[1][2] * r[2][1] )
+                             - r[0][1] * ( r[1][0] * r[2][2] - r[1][2] * r[2][0] )
+                             + r[0][2] * ( r[1][0] * r[2][1] - r[1][1] * r[2][0] );
+    double qfac = 1;
+    if ( determinant < 0 ) {
+        qfac = -1;
+        for ( int i = 0; i < 3; i++ ) {
+            r[i][2] = -r[i][2];
+        }
+    }
+
+    double a = r[0][0] + r[1][1] + r[2][2] + 1;
+    double b, c, q;
+    if ( a > 0.5 ) {
+        a = 0.5 * std::sqrt ( a );
+        b = 0.25 * ( r[2][1] - r[1][2] ) / a;
+        c = 0.25 * ( r[0][2] - r[2][0] ) / a;
+        q = 0.25 * ( r[1][0] - r[0][1] ) / a;
+    }
+    else {
+        const double xd = 1 + r[0][0] - ( r[1][1] + r[2][2] );
+        const double yd = 1 + r[1][1] - ( r[0][0] + r[2][2] );
+        const double zd = 1 + r[2][2] - ( r[0][0] + r[1][1] );
+        if ( xd > 1 ) {
+            b = 0.5 * std::sqrt ( xd );
+            c = 0.25 * ( r[0][1] + r[1][0] ) / b;
+            q = 0.25 * ( r[0][2] + r[2][0] ) / b;
+            a = 0.25 * ( r[2][1] - r[1][2] ) / b;
+        }
+        else if ( yd > 1 ) {
+            c = 0.5 * std::sqrt ( yd );
+            b = 0.25 * ( r[0][1] + r[1][0] ) / c;
+            q = 0.25 * ( r[1][2] + r[2][1] ) / c;
+            a = 0.25 * ( r[0][2] - r[2][0] ) / c;
+        }
+        else {
+            q = 0.5 * std::sqrt ( zd );
+            b = 0.25 * ( r[0][2] + r[2][0] ) / q;
+            c = 0.25 * ( r[1][2] + r[2][1] ) / q;
+            a = 0.25 * ( r[1][0] - r[0][1] ) / q;
+        }
+        if ( a < 0 ) {
+            b = -b;
+            c = -c;
+            q = -q;
+        }
+    }
+
+    put<float> ( h, 76, qfac );                             // pixdim[0]
+    for ( int i = 0; i < 3; i++ ) {
+        put<float> ( h, 80 + 4 * i, spacing[i] );
+    }
+    put<float> ( h, 92, 1 );                                // pixdim[4], the repetition time is unknown
+    put<float> ( h, 108, VoxOffset );
+    h[123] = 2 | 8;                                         // xyzt_units : mm and s
+
+    put<qint16> ( h, 252, 1 );                              // qform_code : scanner
+    put<qint16> ( h, 254, 1 );                              // sform_code : scanner
+    put<float> ( h, 256, b );
+    put<float> ( h, 260, c );
+    put<float> ( h, 264, q );
+    for ( int i = 0; i < 3; i++ ) {
+        put<float> ( h, 268 + 4 * i, matrix[i][3] );
+        for ( int j = 0; j < 4; j++ ) {
+            put<float> ( h, 280 + 16 * i + 4 * j, matrix[i][j] );
+        }
+    }
+    memcpy ( h + 344, "n+1", 4 );
+
+    return bytes;
+}
+
+QtDcmNiftiWriter::QtDcmNiftiWriter() : d ( new QtDcmNiftiWriter::Private )
+{
+    d->datatype = INT16;
+    d->compressionLevel = 6;
+    d->written = 0;
+    for ( int i = 0; i < 4; i++ ) {
+        d->dimensions[i] = 1;
+    }
+    for ( int i = 0; i < 3; i++ ) {
+        d->spacing[i] = 1;
+        d->origin[i] = 0;
+        for ( int j = 0; j < 3; j++ ) {
+            d->direction[i][j] = ( i == j ) ? 1 : 0;
+        }
+    }
+}
+
+QtDcmNiftiWriter::~QtDcmNiftiWriter()
+{
+    delete d;
+    d = NULL;
+}
+
+QtDcmNiftiWriter::eDatatype QtDcmNiftiWriter::datatype ( QtDcmVolume::eComponentType type, int components )
+{
+    switch ( type ) {
+    case QtDcmVolume::UINT8:
+        return ( components == 3 ) ? RGB24 : UINT8;
+    case QtDcmVolume::INT8:
+        return INT8;
+    case QtDcmVolume::UINT16:
+        return UINT16;
+    case QtDcmVolume::INT16:
+        return INT16;
+    case QtDcmVolume::UINT32:
+        return UINT32;
+    case QtDcmVolume::INT32:
+        return INT32;
+    case QtDcmVolume::FLOAT32:
+        return FLOAT32;
+    case QtDcmVolume::FLOAT64:
+        return FLOAT64;
+    }
+    return INT16;
+}
+
+void QtDcmNiftiWriter::setDatatype ( QtDcmNiftiWriter::eDatatype datatype )
+{
+    d->datatype = datatype;
+}
+
+void QtDcmNiftiWriter::setDimensions ( int x, int y, int z, int t )
+{
+    d->dimensions[0] = x;
+    d->dimensions[1] = y;
+    d->dimensions[2] = z;
+    d->dimensions[3] = t;
+}
+
+void QtDcmNiftiWriter::setSpacing ( double x, double y, double z )
+{
+    d->spacing[0] = x;
+    d->spacing[1] = y;
+    d->spacing[2] = z;
+}
+
+void QtDcmNiftiWriter::setOrigin ( const double origin[3] )
+{
+    for ( int i = 0; i < 3; i++ ) {
+        d->origin[i] = origin[i];
+    }
+}
+
+void QtDcmNiftiWriter::setCompressionLevel ( int level )
+{
+    d->compressionLevel = level;
+}
+
+void QtDcmNiftiWriter::setDirection ( const double direction[3][3] )
+{
+    for ( int i = 0; i < 3; i++ ) {
+        for ( int j = 0; j < 3; j++ ) {
+            d->direction[i][j] = direction[i][j];
+        }
+    }
+}
+
+bool QtDcmNiftiWriter::open ( const QString & filename )
+{
+    // The file is renamed over filename once complete, a previous output hard linked by
+    // QtDcmConversionCache is never written through
+    d->file.setFileName ( filename );
+    if ( !d->file.open ( QIODevice::WriteOnly ) ) {
+        qWarning() << "Cannot write" << filename;
+        return false;
+    }
+
+    d->written = 0;
+    d->gzip.reset();
+    if ( filename.endsWith ( ".gz" ) ) {
+        d->gzip.reset ( new QtDcmGzipWriter ( &d->file, d->compressionLevel ) );
+    }
+
+    const int reserved = d->gzip ? QtDcmGzipWriter::storedMemberSize ( VoxOffset ) : VoxOffset;
+    return d->file.write ( QByteArray ( reserved, '\0' ) ) == reserved;
+}
+
+bool QtDcmNiftiWriter::writeData ( const char * data, qint64 size )
+{
+    const bool success = d->gzip ? d->gzip->write ( data, size ) : ( d->file.write ( data, size ) == size );
+    if ( !success ) {
+        qWarning() << "Cannot write" << d->file.fileName();
+        return false;
+    }
+
+    d->written += size;
+    return true;
+}
+
+bool QtDcmNiftiWriter::close()
+{
+    if ( !d->file.isOpen() ) {
+        return false;
+    }
+
+    const qint64 expected = qint64 ( d->dimensions[0] ) * d->dimensions[1] * d->dimensions[2] * d->dimensions[3]
+                            * bitsPerVoxel ( d->datatype ) / 8;
+
+    bool success = d->written == expected;
+    if ( success && d->gzip ) {
+        const QByteArray header = QtDcmGzipWriter::storedMember ( d->header() );
+        success = d->gzip->flush() && d->file.seek ( 0 ) && d->file.write ( header ) == header.size();
+    }
+    else if ( success ) {
+        success = d->file.seek ( 0 ) && d->file.write ( d->header() ) == VoxOffset;
+    }
+    d->gzip.reset();
+
+    if ( !success ) {
+        qWarning() << "Incomplete image" << d->file.fileName();
+        d->file.cancelWriting();
+    }
+
+    // Discards the file if the writing was cancelled
+    return d->file.commit() && success;
+}
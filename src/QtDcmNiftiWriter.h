@@ -0,0 +1,110 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMNIFTIWRITER_H
+#define QTDCMNIFTIWRITER_H
+
+#include <QtGui>
+#include <QtDcmVolume.h>
+
+/**
+ * This class writes a single file NIfTI-1 image (.nii or .nii.gz) whose voxels are
+ * appended slab by slab, so that a volume never has to be held in memory as a whole.
+ * The file only replaces an existing one when close() succeeds, it is discarded otherwise.
+ *
+ * A .nii.gz is compressed as the voxels are appended, on several threads (see QtDcmGzipWriter).
+ * Its header is an uncompressed gzip member of a known size, written in place by close().
+ *
+ * The geometry can be set at any time before close(), the header is written last.
+ * The geometry is given in the ITK/DICOM (LPS) convention and converted to RAS.
+ */
+class QtDcmNiftiWriter
+{
+public:
+    /**
+     * NIfTI-1 datatype codes
+     */
+    enum eDatatype
+    {
+        UINT8 = 2,
+        INT16 = 4,
+        INT32 = 8,
+        FLOAT32 = 16,
+        FLOAT64 = 64,
+        RGB24 = 128,
+        INT8 = 256,
+        UINT16 = 512,
+        UINT32 = 768
+    };
+
+    QtDcmNiftiWriter();
+    virtual ~QtDcmNiftiWriter();
+
+    /**
+     * NIfTI datatype of a QtDcmVolume component type, UINT8 with 3 components is RGB24
+     */
+    static eDatatype datatype ( QtDcmVolume::eComponentType type, int components = 1 );
+
+    void setDatatype ( eDatatype datatype );
+
+    /**
+     * Number of voxels along x, y, z and t (1 for a 3D image)
+     */
+    void setDimensions ( int x, int y, int z, int t = 1 );
+
+    void setSpacing ( double x, double y, double z );
+
+    void setOrigin ( const double origin[3] );
+
+    /**
+     * Direction cosines, direction[i][j] is the i coordinate of the j axis (as itk::Image::GetDirection)
+     */
+    void setDirection ( const double direction[3][3] );
+
+    /**
+     * Compression level of a .nii.gz, from 0 to 9 (6 by default)
+     */
+    void setCompressionLevel ( int level );
+
+    /**
+     * Create the file and reserve the header, the file is compressed if its name ends with .gz
+     */
+    bool open ( const QString & filename );
+
+    /**
+     * Append voxels, x varying fastest, then y, z and t
+     */
+    bool writeData ( const char * data, qint64 size );
+
+    /**
+     * Write the header and close the file
+     *
+     * @return false if the amount of data written does not match the dimensions, nothing is written then
+     */
+    bool close();
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmNiftiWriter )
+};
+
+#endif // QTDCMNIFTIWRITER_H
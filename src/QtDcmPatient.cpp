@@ -17,13 +17,10 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-
-#include <QtDcmImage.h>
-#include <QtDcmSerie.h>
 #include <QtDcmStudy.h>
 #include <QtDcmPatient.h>
 
-class QtDcmPatient::Private
+class QtDcmPatient::Private : public QSharedData
 {
     public:
         QString id; /** Patient dicom identificator */
@@ -32,14 +29,32 @@ class QtDcmPatient::Private
         QString sex; /** Patient sex */
 
         QList<QtDcmStudy> studies; /** List of a study for this patient */
+        QHash<QString, int> studyIndex; /** key : study uid => value : position in studies */
+
+        void reindex()
+        {
+            studyIndex.clear();
+            studyIndex.reserve ( studies.size() );
+            for ( int i = 0; i < studies.size(); i++ ) {
+                studyIndex.insert ( studies[i].uid(), i );
+            }
+        }
 };
 
 QtDcmPatient::QtDcmPatient() : d(new QtDcmPatient::Private)
 {}
 
+QtDcmPatient::QtDcmPatient ( const QtDcmPatient & other ) : d ( other.d )
+{}
+
 QtDcmPatient::~QtDcmPatient()
 {
-    delete d;
+}
+
+QtDcmPatient & QtDcmPatient::operator= ( const QtDcmPatient & other )
+{
+    d = other.d;
+    return *this;
 }
 
 QString QtDcmPatient::id() const
@@ -90,14 +105,50 @@ QList<QtDcmStudy> QtDcmPatient::studies() const
 void QtDcmPatient::setStudies(const QList<QtDcmStudy> &studies)
 {
     d->studies = studies;
+    d->reindex();
 }
 
 void QtDcmPatient::addStudy(const QtDcmStudy &study)
 {
+    const int index = d->studyIndex.value ( study.uid(), -1 );
+    if ( index >= 0 ) {
+        d->studies[index] = study;
+        return;
+    }
+
+    d->studyIndex.insert ( study.uid(), d->studies.size() );
     d->studies.append(study);
 }
 
 void QtDcmPatient::removeStudy(int index)
 {
     d->studies.removeAt(index);
+    d->reindex();
+}
+
+bool QtDcmPatient::hasStudy ( const QString & uid ) const
+{
+    return d->studyIndex.contains ( uid );
+}
+
+QtDcmStudy QtDcmPatient::study ( const QString & uid ) const
+{
+    const int index = d->studyIndex.value ( uid, -1 );
+    return ( index >= 0 ) ? d->studies.at ( index ) : QtDcmStudy();
+}
+
+QtDcmStudy & QtDcmPatient::study ( const QString & uid )
+{
+    int index = d->studyIndex.value ( uid, -1 );
+    if ( index < 0 ) {
+        QtDcmStudy added;
+        added.setUid ( uid );
+        added.setPatientId ( d->id );
+
+        index = d->studies.size();
+        d->studyIndex.insert ( uid, index );
+        d->studies.append ( added );
+    }
+
+    return d->studies[index];
 }
@@ -17,7 +17,6 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-
 #ifndef QTDCMPATIENT_H_
 #define QTDCMPATIENT_H_
 
@@ -27,6 +26,9 @@ class QtDcmStudy;
 
 /**
  * This class is a representation of a dicom patient
+ *
+ * The patient is implicitly shared : copies are cheap and only detach when modified.
+ * Its studies are indexed on their StudyInstanceUID.
  */
 class QtDcmPatient
 {
@@ -36,10 +38,14 @@ public:
      */
     QtDcmPatient();
 
+    QtDcmPatient ( const QtDcmPatient & other );
+
     /**
      * Default destructor
      */
-    virtual ~QtDcmPatient();
+    ~QtDcmPatient();
+
+    QtDcmPatient & operator= ( const QtDcmPatient & other );
 
     /**
      * Id getter
@@ -114,7 +120,7 @@ public:
     void setStudies( const QList<QtDcmStudy>& studies );
 
     /**
-     * Add study in the list
+     * Add study in the list, a study with the same uid is replaced
      */
     void addStudy(const QtDcmStudy & study);
 
@@ -122,11 +128,27 @@ public:
      * Remove study at position index
      */
     void removeStudy(int index);
-    
+
+    /**
+     * @return true if the patient has a study with this StudyInstanceUID
+     */
+    bool hasStudy ( const QString & uid ) const;
+
+    /**
+     * Study with this StudyInstanceUID, an empty study if there is none
+     */
+    QtDcmStudy study ( const QString & uid ) const;
+
+    /**
+     * Study with this StudyInstanceUID, an empty study having this uid is added if there is none
+     */
+    QtDcmStudy & study ( const QString & uid );
     
 private:
     class Private;
-    Private *d;
+    QSharedDataPointer<Private> d;
   };
 
+Q_DECLARE_TYPEINFO ( QtDcmPatient, Q_MOVABLE_TYPE );
+
 #endif /* QTDCMPATIENT_H_ */
@@ -20,6 +20,7 @@
 
 #include <QtDcmPreferences.h>
 #include <QtDcmManager.h>
+#include <QtDcmThreadBudget.h>
 
 class QtDcmPreferencesPrivate
 {
@@ -28,9 +29,19 @@ public:
     QString aetitle;      /** Local aetitle of QtDcm */
     QString port;         /** Local port of qtdcm */
     QString hostname;     /** Local hostname of qtdcm */
+    int threadBudget;     /** Number of threads QtDcm may use, 0 for all the cores */
 
     bool useDcm2nii;      /** Use dcm2nii as a conversion tool */
     QString dcm2niiPath;  /** The dcm2nii binary path */
+    int subSeriesMode;    /** QtDcmConvert::eSubSeriesMode of the ITK conversion */
+    int memoryLimit;      /** Memory ceiling of the ITK conversion in MB */
+    QString outputFormat; /** Extension of the converted files */
+    int compressionLevel; /** Compression level of the converted files */
+    int dcm2niiProcessCount; /** Maximum number of concurrent dcm2nii processes */
+    int dcm2niiTimeout;   /** dcm2nii timeout in seconds */
+    bool useConversionCache; /** Reuse the outputs of series already converted */
+    int thumbnailCacheSize; /** Size of the thumbnail cache on disk in MB */
+    bool prefetchPreviews; /** Retrieve the previews of the neighbor series */
 
     QList<QtDcmServer> servers; /** List of server that QtDcm can query */
 };
@@ -41,6 +52,16 @@ QtDcmPreferences::QtDcmPreferences(QObject * parent)
     : QObject(parent),
       d ( new QtDcmPreferencesPrivate )
 {
+    d->threadBudget = 0;
+    d->subSeriesMode = 1;
+    d->memoryLimit = 2048;
+    d->outputFormat = "nii";
+    d->compressionLevel = 6;
+    d->dcm2niiProcessCount = 0;
+    d->dcm2niiTimeout = 600;
+    d->useConversionCache = true;
+    d->thumbnailCacheSize = 64;
+    d->prefetchPreviews = false;
 }
 
 QtDcmPreferences::~QtDcmPreferences()
@@ -88,11 +109,25 @@ void QtDcmPreferences::readSettings()
     d->aetitle = prefs.value ( "AETitle" ).toString();
     d->port = prefs.value ( "Port" ).toString();
     d->hostname = prefs.value ( "Hostname" ).toString();
+    d->threadBudget = prefs.value ( "ThreadBudget", 0 ).toInt();
+    QtDcmThreadBudget::setTotal ( d->threadBudget );
     prefs.endGroup();
 
     prefs.beginGroup ( "Converter" );
     d->useDcm2nii = prefs.value ( "UseDcm2nii" ).toBool();
     d->dcm2niiPath = prefs.value ( "Dcm2nii" ).toString();
+    d->subSeriesMode = prefs.value ( "SubSeries", 1 ).toInt();
+    d->memoryLimit = prefs.value ( "MemoryLimit", 2048 ).toInt();
+    d->outputFormat = prefs.value ( "OutputFormat", "nii" ).toString();
+    d->compressionLevel = prefs.value ( "CompressionLevel", 6 ).toInt();
+    d->dcm2niiProcessCount = prefs.value ( "Dcm2niiProcesses", 0 ).toInt();
+    d->dcm2niiTimeout = prefs.value ( "Dcm2niiTimeout", 600 ).toInt();
+    d->useConversionCache = prefs.value ( "UseCache", true ).toBool();
+    prefs.endGroup();
+
+    prefs.beginGroup ( "Preview" );
+    d->thumbnailCacheSize = prefs.value ( "ThumbnailCacheSize", 64 ).toInt();
+    d->prefetchPreviews = prefs.value ( "PrefetchPreviews", false ).toBool();
     prefs.endGroup();
 
     //For each server load corresponding settings
@@ -122,11 +157,24 @@ void QtDcmPreferences::writeSettings()
     prefs.setValue ( "AETitle", d->aetitle );
     prefs.setValue ( "Port", d->port );
     prefs.setValue ( "Hostname", d->hostname );
+    prefs.setValue ( "ThreadBudget", d->threadBudget );
     prefs.endGroup();
 
     prefs.beginGroup ( "Converter" );
     prefs.setValue ( "Dcm2nii", d->dcm2niiPath );
     prefs.setValue ( "UseDcm2nii", d->useDcm2nii );
+    prefs.setValue ( "SubSeries", d->subSeriesMode );
+    prefs.setValue ( "MemoryLimit", d->memoryLimit );
+    prefs.setValue ( "OutputFormat", d->outputFormat );
+    prefs.setValue ( "CompressionLevel", d->compressionLevel );
+    prefs.setValue ( "Dcm2niiProcesses", d->dcm2niiProcessCount );
+    prefs.setValue ( "Dcm2niiTimeout", d->dcm2niiTimeout );
+    prefs.setValue ( "UseCache", d->useConversionCache );
+    prefs.endGroup();
+
+    prefs.beginGroup ( "Preview" );
+    prefs.setValue ( "ThumbnailCacheSize", d->thumbnailCacheSize );
+    prefs.setValue ( "PrefetchPreviews", d->prefetchPreviews );
     prefs.endGroup();
 
     //Do the job for each server
@@ -152,9 +200,20 @@ void QtDcmPreferences::setDefaultIniFile()
     d->aetitle = "QTDCM";
     d->port = "2010";
     d->hostname = "localhost";
+    d->threadBudget = 0;
+    QtDcmThreadBudget::setTotal ( d->threadBudget );
 
     d->dcm2niiPath = "";
     d->useDcm2nii = 0;
+    d->subSeriesMode = 1;
+    d->memoryLimit = 2048;
+    d->outputFormat = "nii";
+    d->compressionLevel = 6;
+    d->dcm2niiProcessCount = 0;
+    d->dcm2niiTimeout = 600;
+    d->useConversionCache = true;
+    d->thumbnailCacheSize = 64;
+    d->prefetchPreviews = false;
 
     QtDcmServer server;
     server.setAetitle ( "SERVER" );
@@ -216,6 +275,17 @@ QString QtDcmPreferences::hostname() const
     return d->hostname;
 }
 
+int QtDcmPreferences::threadBudget() const
+{
+    return d->threadBudget;
+}
+
+void QtDcmPreferences::setThreadBudget ( int threads )
+{
+    d->threadBudget = threads;
+    QtDcmThreadBudget::setTotal ( d->threadBudget );
+}
+
 void QtDcmPreferences::setAetitle ( const QString & aetitle )
 {
     d->aetitle = aetitle;
@@ -251,3 +321,92 @@ void QtDcmPreferences::setUseDcm2nii ( bool use )
     d->useDcm2nii = use;
 }
 
+int QtDcmPreferences::subSeriesMode() const
+{
+    return d->subSeriesMode;
+}
+
+void QtDcmPreferences::setSubSeriesMode ( int mode )
+{
+    d->subSeriesMode = mode;
+}
+
+int QtDcmPreferences::memoryLimit() const
+{
+    return d->memoryLimit;
+}
+
+void QtDcmPreferences::setMemoryLimit ( int megabytes )
+{
+    d->memoryLimit = megabytes;
+}
+
+QString QtDcmPreferences::outputFormat() const
+{
+    return d->outputFormat;
+}
+
+void QtDcmPreferences::setOutputFormat ( const QString & extension )
+{
+    d->outputFormat = extension;
+}
+
+int QtDcmPreferences::compressionLevel() const
+{
+    return d->compressionLevel;
+}
+
+void QtDcmPreferences::setCompressionLevel ( int level )
+{
+    d->compressionLevel = level;
+}
+
+int QtDcmPreferences::dcm2niiProcessCount() const
+{
+    return d->dcm2niiProcessCount;
+}
+
+void QtDcmPreferences::setDcm2niiProcessCount ( int count )
+{
+    d->dcm2niiProcessCount = count;
+}
+
+int QtDcmPreferences::dcm2niiTimeout() const
+{
+    return d->dcm2niiTimeout;
+}
+
+void QtDcmPreferences::setDcm2niiTimeout ( int seconds )
+{
+    d->dcm2niiTimeout = seconds;
+}
+
+bool QtDcmPreferences::useConversionCache() const
+{
+    return d->useConversionCache;
+}
+
+void QtDcmPreferences::setUseConversionCache ( bool use )
+{
+    d->useConversionCache = use;
+}
+
+int QtDcmPreferences::thumbnailCacheSize() const
+{
+    return d->thumbnailCacheSize;
+}
+
+void QtDcmPreferences::setThumbnailCacheSize ( int size )
+{
+    d->thumbnailCacheSize = size;
+}
+
+bool QtDcmPreferences::prefetchPreviews() const
+{
+    return d->prefetchPreviews;
+}
+
+void QtDcmPreferences::setPrefetchPreviews ( bool prefetch )
+{
+    d->prefetchPreviews = prefetch;
+}
@@ -33,7 +33,23 @@ class QtDcmPreferencesPrivate;
  * [LocalSettings]\n
  * AETitle=""\n
  * Port=""\n
- * Encoding=""\n
+ * Hostname=""\n
+ * ThreadBudget=0\n
+ *\n
+ * [Converter]\n
+ * UseDcm2nii=false\n
+ * Dcm2nii=""\n
+ * SubSeries=1\n
+ * MemoryLimit=2048\n
+ * OutputFormat=nii\n
+ * CompressionLevel=6\n
+ * Dcm2niiProcesses=0\n
+ * Dcm2niiTimeout=600\n
+ * UseCache=true\n
+ *\n
+ * [Preview]\n
+ * ThumbnailCacheSize=64\n
+ * PrefetchPreviews=false\n
  *\n
  * [Servers]\n
  * Server1\\AETitle=""\n
@@ -42,9 +58,21 @@ class QtDcmPreferencesPrivate;
  * Server1\\Name=""\n
  * ...\n
  *\n
+ * QtDcmPreferencesDialog only edits the local settings, the servers, UseDcm2nii and Dcm2nii.
+ * The other keys are only set in the ini file (or through the setters), the values above
+ * are their defaults :
+ * - ThreadBudget : threads shared by conversion, decompression and previews, 0 for all the cores
+ * - SubSeries : 0 converts the first sub-serie only, 1 writes one volume per sub-serie, 2 stacks them in a 4D volume
+ * - MemoryLimit : MB a volume may use before it is written slab by slab, 0 for no limit
+ * - OutputFormat : extension of the converted files, nii, nii.gz, nrrd or mha
+ * - CompressionLevel : 0 to 9, for the compressed formats
+ * - Dcm2niiProcesses : dcm2nii processes running at the same time, 0 for QtDcmThreadBudget::concurrentConversions()
+ * - Dcm2niiTimeout : seconds after which dcm2nii is killed, 0 for no timeout
+ * - UseCache : reuse the outputs of a serie already converted with the same instances and settings
+ * - ThumbnailCacheSize : MB of previews kept on disk between sessions, 0 disables the disk cache
+ * - PrefetchPreviews : render in the background the previews of the series next to the selected one
  *
- *
- * @todo Add path to dcm2nii and dcm4che in the preferences
+ * @todo Add path to dcm4che in the preferences
  */
 
 class QTDCM_EXPORT QtDcmPreferences : public QObject
@@ -102,6 +130,16 @@ public:
 
     QString hostname() const;
 
+    /**
+     * Number of threads QtDcm may use for conversion, decompression and previews,
+     * shared between them by QtDcmThreadBudget
+     *
+     * @return the number of threads, 0 (default) for all the cores
+     */
+    int threadBudget() const;
+
+    void setThreadBudget ( int threads );
+
     /**
      * QtDcm local AETitle setter
      *
@@ -125,6 +163,80 @@ public:
 
     void setUseDcm2nii ( bool use );
 
+    /**
+     * How the ITK conversion handles several sub-series in a serie
+     *
+     * @return a QtDcmConvert::eSubSeriesMode value, ALL_SUBSERIES by default
+     */
+    int subSeriesMode() const;
+
+    void setSubSeriesMode ( int mode );
+
+    /**
+     * Memory the ITK conversion may use for a volume before writing it slab by slab
+     *
+     * @return the limit in MB, 2048 by default, 0 for no limit
+     */
+    int memoryLimit() const;
+
+    void setMemoryLimit ( int megabytes );
+
+    /**
+     * Format of the converted files
+     *
+     * @return the extension without the leading dot : "nii" (default), "nii.gz", "nrrd" or "mha"
+     */
+    QString outputFormat() const;
+
+    void setOutputFormat ( const QString & extension );
+
+    /**
+     * Compression level of the compressed formats, from 0 to 9 (6 by default)
+     */
+    int compressionLevel() const;
+
+    void setCompressionLevel ( int level );
+
+    /**
+     * Maximum number of dcm2nii processes running at the same time
+     *
+     * @return the number of processes, 0 (default) for QtDcmThreadBudget::concurrentConversions()
+     */
+    int dcm2niiProcessCount() const;
+
+    void setDcm2niiProcessCount ( int count );
+
+    /**
+     * Time after which a dcm2nii process is killed
+     *
+     * @return the timeout in seconds, 600 by default, 0 for no timeout
+     */
+    int dcm2niiTimeout() const;
+
+    void setDcm2niiTimeout ( int seconds );
+
+    /**
+     * Reuse the outputs of a serie already converted with the same instances and settings
+     * instead of converting it again (true by default)
+     */
+    bool useConversionCache() const;
+
+    void setUseConversionCache ( bool use );
+
+    /**
+     * Size in MB of the previews kept on disk between sessions, 0 disables the disk cache
+     */
+    int thumbnailCacheSize() const;
+
+    void setThumbnailCacheSize ( int size );
+
+    /**
+     * Retrieve and render in the background the previews of the series next to the selected one
+     */
+    bool prefetchPreviews() const;
+
+    void setPrefetchPreviews ( bool prefetch );
+
     /**
      * Add server to the QList
      */
@@ -0,0 +1,245 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmnet/dfindscu.h>
+
+#include <QtDcmMoveScu.h>
+#include <QtDcmPreferences.h>
+#include <QtDcmPreviewRenderer.h>
+#include <QtDcmServer.h>
+#include <QtDcmThumbnailCache.h>
+#include <QtDcmPreviewPrefetcher.h>
+
+namespace
+{
+const int NetworkTimeout = 30;            /** Seconds */
+
+/**
+ * Keeps the SOPInstanceUIDs of the responses, instead of handing them to the manager
+ */
+class InstanceCollector : public DcmFindSCUCallback
+{
+public:
+    void callback ( T_DIMSE_C_FindRQ * request, int & responseCount, T_DIMSE_C_FindRSP * rsp, DcmDataset * responseIdentifiers )
+    {
+        Q_UNUSED ( request )
+        Q_UNUSED ( responseCount )
+        Q_UNUSED ( rsp )
+
+        OFString uid;
+        if ( responseIdentifiers->findAndGetOFString ( DCM_SOPInstanceUID, uid ).good() ) {
+            uids.append ( QString::fromLatin1 ( uid.c_str() ) );
+        }
+    }
+
+    QStringList uids;
+};
+}
+
+class QtDcmPreviewPrefetcher::Private
+{
+public:
+    QStringList series;
+    QList<int> instanceCounts;
+    QString address;
+    int port;
+    QByteArray aetitle;
+    QByteArray peerAetitle;
+    QString outputDir;
+    QtDcmThumbnailCache * cache;
+    int previewSize;
+
+    QMutex mutex;                         /** Protects cancelled and mover */
+    bool cancelled;
+    QtDcmMoveScu * mover;                 /** The running move, NULL between two moves */
+
+    bool isCancelled()
+    {
+        QMutexLocker locker ( &mutex );
+        return cancelled;
+    }
+
+    /**
+     * Query the instances of a serie, with the same keys as QtDcmFindScu::findImagesScu
+     */
+    QStringList findInstances ( const QString & serie, int instanceNumber, int maxResponses )
+    {
+        OFList<OFString> keys;
+        keys.push_back ( "QueryRetrieveLevel=IMAGE" );
+        keys.push_back ( QString ( "SeriesInstanceUID=" + serie ).toUtf8().data() );
+        keys.push_back ( "PatientID=*" );
+        keys.push_back ( "StudyInstanceUID=*" );
+        keys.push_back ( "SOPInstanceUID" );
+        if ( instanceNumber > 0 ) {
+            keys.push_back ( QString ( "InstanceNumber=" + QString::number ( instanceNumber ) ).toUtf8().data() );
+        }
+        else {
+            keys.push_back ( "InstanceNumber" );
+        }
+
+        DcmFindSCU findscu;
+        InstanceCollector collector;
+        OFList<OFString> fileNameList;
+
+        if ( findscu.initializeNetwork ( NetworkTimeout ).bad() ) {
+            return QStringList();
+        }
+
+        const OFCondition cond = findscu.performQuery ( address.toUtf8().data(), port, aetitle.data(), peerAetitle.data(),
+                                                        UID_FINDPatientRootQueryRetrieveInformationModel, EXS_Unknown,
+                                                        DIMSE_BLOCKING, 0, ASC_DEFAULTMAXPDU, false, false, 1,
+                                                        DcmFindSCUExtractMode::FEM_none, maxResponses,
+                                                        &keys, &collector, &fileNameList );
+        if ( cond.bad() ) {
+            qDebug() << "Prefetch query failed for serie" << serie << ":" << cond.text();
+        }
+
+        findscu.dropNetwork();
+        return collector.uids;
+    }
+};
+
+QtDcmPreviewPrefetcher::QtDcmPreviewPrefetcher ( QObject * parent )
+    : QThread ( parent ),
+      d ( new QtDcmPreviewPrefetcher::Private )
+{
+    d->port = 0;
+    d->cache = NULL;
+    d->previewSize = 0;
+    d->cancelled = false;
+    d->mover = NULL;
+}
+
+QtDcmPreviewPrefetcher::~QtDcmPreviewPrefetcher()
+{
+    this->cancel();
+    this->wait();
+    delete d;
+    d = NULL;
+}
+
+void QtDcmPreviewPrefetcher::setSeries ( const QStringList & uids, const QList<int> & instanceCounts )
+{
+    d->series = uids;
+    d->instanceCounts = instanceCounts;
+}
+
+void QtDcmPreviewPrefetcher::setServer ( const QtDcmServer & server )
+{
+    d->address = server.address();
+    d->port = server.port().toInt();
+    d->peerAetitle = server.aetitle().toUtf8();
+    d->aetitle = QtDcmPreferences::instance()->aetitle().toUtf8();
+}
+
+void QtDcmPreviewPrefetcher::setOutputDir ( const QString & dir )
+{
+    d->outputDir = dir;
+}
+
+void QtDcmPreviewPrefetcher::setCache ( QtDcmThumbnailCache * cache, int previewSize )
+{
+    d->cache = cache;
+    d->previewSize = previewSize;
+}
+
+void QtDcmPreviewPrefetcher::cancel()
+{
+    {
+        QMutexLocker locker ( &d->mutex );
+        d->cancelled = true;
+        if ( d->mover ) {
+            d->mover->onStopMove();
+        }
+    }
+}
+
+void QtDcmPreviewPrefetcher::run()
+{
+    if ( !d->cache ) {
+        return;
+    }
+
+    for ( int i = 0; i < d->series.size() && !d->isCancelled(); i++ ) {
+        const QString & serie = d->series.at ( i );
+        const int instanceCount = d->instanceCounts.value ( i );
+        if ( instanceCount < 1 ) {
+            continue;
+        }
+
+        // Same instance as the one QtDcmManager::findPreviewImageScu picks
+        QStringList instances = d->findInstances ( serie, qMax ( 1, instanceCount / 2 ), 1 );
+        if ( instances.isEmpty() && !d->isCancelled() ) {
+            instances = d->findInstances ( serie, 0, instanceCount / 2 + 1 );
+        }
+        if ( instances.isEmpty() ) {
+            continue;
+        }
+
+        const QString instance = instances.last();
+        const QByteArray key = QtDcmThumbnailCache::key ( instance, QString::number ( d->previewSize ) );
+        if ( !d->cache->find ( key ).isNull() ) {
+            continue;
+        }
+
+        QtDcmMoveScu mover;
+        mover.setMode ( QtDcmMoveScu::PREVIEW );
+        mover.setOutputDir ( d->outputDir );
+        mover.setData ( QStringList() << serie );
+        mover.setImageId ( instance );
+
+        // Emitted from the mover thread, read once it has finished
+        QStringList files;
+        connect ( &mover, &QtDcmMoveScu::previewSlice, [&files] ( const QString & filename ) {
+            files.append ( filename );
+        } );
+
+        {
+            QMutexLocker locker ( &d->mutex );
+            if ( d->cancelled ) {
+                break;
+            }
+            d->mover = &mover;
+            mover.start ( QThread::LowestPriority );
+        }
+
+        mover.wait();
+
+        {
+            QMutexLocker locker ( &d->mutex );
+            d->mover = NULL;
+        }
+
+        for ( const QString & filename : files ) {
+            if ( d->isCancelled() ) {
+                break;
+            }
+
+            QString instanceUid;
+            const QImage image = QtDcmPreviewRenderer::renderFile ( filename, d->previewSize, &instanceUid );
+            if ( !image.isNull() && !instanceUid.isEmpty() ) {
+                d->cache->insert ( QtDcmThumbnailCache::key ( instanceUid, QString::number ( d->previewSize ) ), image );
+                emit previewPrefetched ( serie, instanceUid );
+            }
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMPREVIEWPREFETCHER_H
+#define QTDCMPREVIEWPREFETCHER_H
+
+#include <QtGui>
+
+class QtDcmServer;
+class QtDcmThumbnailCache;
+
+/**
+ * This class retrieves and renders in the background the previews of a few series of the PACS,
+ * typically the neighbors of the selected one, so that they are already in the thumbnail cache
+ * when the user selects them.
+ *
+ * The series are handled one at a time at the lowest thread priority : for each of them the
+ * identifier of the middle instance is queried, the instance is moved unless its preview is
+ * already cached, then rendered. A move needs the local port of QtDcm, so the prefetcher must be
+ * cancelled before any other move is started. A cancelled prefetcher never starts another move
+ * and cannot be restarted.
+ */
+class QtDcmPreviewPrefetcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    QtDcmPreviewPrefetcher ( QObject * parent = 0 );
+    virtual ~QtDcmPreviewPrefetcher();
+
+    /**
+     * Series to prefetch, in order, with their NumberOfSeriesRelatedInstances
+     */
+    void setSeries ( const QStringList & uids, const QList<int> & instanceCounts );
+
+    void setServer ( const QtDcmServer & server );
+
+    /**
+     * Directory where the instances are moved
+     */
+    void setOutputDir ( const QString & dir );
+
+    /**
+     * The rendered previews are added to this cache with the given size
+     */
+    void setCache ( QtDcmThumbnailCache * cache, int previewSize );
+
+    /**
+     * Stop the running move and skip the remaining series, returns at once
+     */
+    void cancel();
+
+    void run();
+
+signals:
+    void previewPrefetched ( const QString & serieUid, const QString & instanceUid );
+
+private:
+    class Private;
+    Private * d;
+};
+
+#endif // QTDCMPREVIEWPREFETCHER_H
@@ -0,0 +1,294 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define QTDCM_USE_SSE2
+#endif
+
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmimgle/dcmimage.h>
+#include <dcmtk/dcmimgle/dipixel.h>
+
+#include <QtDcmCodecs.h>
+#include <QtDcmPreviewRenderer.h>
+
+namespace
+{
+const size_t Lanes = 16;                  /** Independent accumulators of the generic min/max loop */
+const Uint32 PreviewReadLength = 4096;    /** Larger elements (the pixel data) are only read when decoded */
+
+/**
+ * Lowest and highest values of a buffer. The accumulators have no dependency
+ * on each other, so that the compiler turns the loop into vector code.
+ */
+template <typename T>
+void minMax ( const T * data, size_t count, double & low, double & high )
+{
+    T lo[Lanes];
+    T hi[Lanes];
+    std::fill ( lo, lo + Lanes, std::numeric_limits<T>::max() );
+    std::fill ( hi, hi + Lanes, std::numeric_limits<T>::lowest() );
+
+    size_t i = 0;
+    for ( ; i + Lanes <= count; i += Lanes ) {
+        for ( size_t k = 0; k < Lanes; k++ ) {
+            lo[k] = std::min ( lo[k], data[i + k] );
+            hi[k] = std::max ( hi[k], data[i + k] );
+        }
+    }
+    for ( ; i < count; i++ ) {
+        lo[0] = std::min ( lo[0], data[i] );
+        hi[0] = std::max ( hi[0], data[i] );
+    }
+
+    low = *std::min_element ( lo, lo + Lanes );
+    high = *std::max_element ( hi, hi + Lanes );
+}
+
+#ifdef QTDCM_USE_SSE2
+/**
+ * SSE2 only has signed 16 bits min/max : unsigned values are biased by 0x8000 first.
+ */
+void minMax16 ( const void * data, size_t count, bool isSigned, double & low, double & high )
+{
+    const __m128i bias = _mm_set1_epi16 ( isSigned ? 0 : ( short ) 0x8000 );
+    const __m128i * src = reinterpret_cast<const __m128i *> ( data );
+    __m128i lo = _mm_set1_epi16 ( std::numeric_limits<short>::max() );
+    __m128i hi = _mm_set1_epi16 ( std::numeric_limits<short>::min() );
+
+    const size_t blocks = count / 8;
+    for ( size_t i = 0; i < blocks; i++ ) {
+        const __m128i v = _mm_xor_si128 ( _mm_loadu_si128 ( src + i ), bias );
+        lo = _mm_min_epi16 ( lo, v );
+        hi = _mm_max_epi16 ( hi, v );
+    }
+
+    short los[8];
+    short his[8];
+    _mm_storeu_si128 ( reinterpret_cast<__m128i *> ( los ), lo );
+    _mm_storeu_si128 ( reinterpret_cast<__m128i *> ( his ), hi );
+
+    const int offset = isSigned ? 0 : 0x8000;
+    int l = *std::min_element ( los, los + 8 ) + offset;
+    int h = *std::max_element ( his, his + 8 ) + offset;
+
+    for ( size_t i = blocks * 8; i < count; i++ ) {
+        const int v = isSigned ? reinterpret_cast<const Sint16 *> ( data ) [i] : reinterpret_cast<const Uint16 *> ( data ) [i];
+        l = std::min ( l, v );
+        h = std::max ( h, v );
+    }
+
+    low = l;
+    high = h;
+}
+
+template <>
+void minMax<Uint16> ( const Uint16 * data, size_t count, double & low, double & high )
+{
+    minMax16 ( data, count, false, low, high );
+}
+
+template <>
+void minMax<Sint16> ( const Sint16 * data, size_t count, double & low, double & high )
+{
+    minMax16 ( data, count, true, low, high );
+}
+
+template <>
+void minMax<Uint8> ( const Uint8 * data, size_t count, double & low, double & high )
+{
+    const __m128i * src = reinterpret_cast<const __m128i *> ( data );
+    __m128i lo = _mm_set1_epi8 ( ( char ) 0xff );
+    __m128i hi = _mm_setzero_si128();
+
+    const size_t blocks = count / 16;
+    for ( size_t i = 0; i < blocks; i++ ) {
+        const __m128i v = _mm_loadu_si128 ( src + i );
+        lo = _mm_min_epu8 ( lo, v );
+        hi = _mm_max_epu8 ( hi, v );
+    }
+
+    Uint8 los[16];
+    Uint8 his[16];
+    _mm_storeu_si128 ( reinterpret_cast<__m128i *> ( los ), lo );
+    _mm_storeu_si128 ( reinterpret_cast<__m128i *> ( his ), hi );
+
+    Uint8 l = *std::min_element ( los, los + 16 );
+    Uint8 h = *std::max_element ( his, his + 16 );
+    for ( size_t i = blocks * 16; i < count; i++ ) {
+        l = std::min ( l, data[i] );
+        h = std::max ( h, data[i] );
+    }
+
+    low = l;
+    high = h;
+}
+#endif
+
+/**
+ * Window the frame and resample it to the size of the preview. Only the pixels
+ * falling at the centre of an output pixel are read.
+ */
+template <typename T>
+QImage windowFrame ( const T * data, int width, int height, double low, double high, bool invert, const QSize & size )
+{
+    QImage preview ( size, QImage::Format_Grayscale8 );
+
+    // Source column of each preview column, the same for all the rows
+    QVector<int> columns ( size.width() );
+    for ( int x = 0; x < size.width(); x++ ) {
+        columns[x] = ( int ) ( ( ( 2 * ( qint64 ) x + 1 ) * width ) / ( 2 * size.width() ) );
+    }
+
+    float scale = high > low ? ( float ) ( 255.0 / ( high - low ) ) : 0.f;
+    float offset = - ( float ) low * scale;
+    if ( invert ) {
+        scale = -scale;
+        offset = 255.f - offset;
+    }
+
+    for ( int y = 0; y < size.height(); y++ ) {
+        const int row = ( int ) ( ( ( 2 * ( qint64 ) y + 1 ) * height ) / ( 2 * size.height() ) );
+        const T * src = data + ( size_t ) row * width;
+        uchar * dst = preview.scanLine ( y );
+
+        for ( int x = 0; x < size.width(); x++ ) {
+            const float value = src[columns[x]] * scale + offset;
+            dst[x] = ( uchar ) ( qBound ( 0.f, value, 255.f ) + 0.5f );
+        }
+    }
+
+    return preview;
+}
+
+template <typename T>
+QImage renderMonochrome ( DicomImage * image, const void * pixels, const QSize & size )
+{
+    const T * data = static_cast<const T *> ( pixels );
+    const int width = ( int ) image->getWidth();
+    const int height = ( int ) image->getHeight();
+
+    double low = 0;
+    double high = 0;
+    double center = 0;
+    double windowWidth = 0;
+    if ( image->getWindowCount() > 0 && image->setWindow ( 0 ) && image->getWindow ( center, windowWidth ) && windowWidth > 0 ) {
+        low = center - windowWidth / 2;
+        high = center + windowWidth / 2;
+    }
+    else {
+        minMax ( data, ( size_t ) width * height, low, high );
+    }
+
+    return windowFrame ( data, width, height, low, high, image->getPhotometricInterpretation() == EPI_Monochrome1, size );
+}
+
+QImage renderColor ( DicomImage * image, const QSize & size )
+{
+    // The output data is only built at the size of the preview
+    QScopedPointer<DicomImage> scaled ( image->createScaledImage ( ( unsigned long ) size.width(), ( unsigned long ) size.height(), 1, 0 ) );
+    if ( !scaled || scaled->getStatus() != EIS_Normal ) {
+        return QImage();
+    }
+
+    // Interleaved 8 bits RGB
+    const uchar * rgb = static_cast<const uchar *> ( scaled->getOutputData ( 8, 0, 0 ) );
+    if ( !rgb ) {
+        return QImage();
+    }
+
+    // copy() detaches the image from the output data, that belongs to the scaled dicom image
+    return QImage ( rgb, size.width(), size.height(), 3 * size.width(), QImage::Format_RGB888 ).copy();
+}
+}
+
+QImage QtDcmPreviewRenderer::render ( DicomImage * image, int size )
+{
+    if ( !image || image->getStatus() != EIS_Normal || !image->getWidth() || !image->getHeight() ) {
+        return QImage();
+    }
+
+    image->hideAllOverlays();
+
+    const QSize previewSize = QSize ( ( int ) image->getWidth(), ( int ) image->getHeight() )
+                              .scaled ( size, size, Qt::KeepAspectRatio )
+                              .expandedTo ( QSize ( 1, 1 ) );
+
+    if ( !image->isMonochrome() ) {
+        return renderColor ( image, previewSize );
+    }
+
+    const DiPixel * pixels = image->getInterData();
+    if ( !pixels || !pixels->getData() ) {
+        return QImage();
+    }
+
+    switch ( pixels->getRepresentation() ) {
+    case EPR_Uint8:
+        return renderMonochrome<Uint8> ( image, pixels->getData(), previewSize );
+    case EPR_Sint8:
+        return renderMonochrome<Sint8> ( image, pixels->getData(), previewSize );
+    case EPR_Uint16:
+        return renderMonochrome<Uint16> ( image, pixels->getData(), previewSize );
+    case EPR_Sint16:
+        return renderMonochrome<Sint16> ( image, pixels->getData(), previewSize );
+    case EPR_Uint32:
+        return renderMonochrome<Uint32> ( image, pixels->getData(), previewSize );
+    case EPR_Sint32:
+        return renderMonochrome<Sint32> ( image, pixels->getData(), previewSize );
+    default:
+        qWarning() << "Unsupported pixel representation for the preview";
+        return QImage();
+    }
+}
+
+QImage QtDcmPreviewRenderer::renderFile ( const QString & filename, int size, QString * instanceUid )
+{
+    QtDcmCodecs::registerDecoders();
+    OFFilename dcmFileName ( filename.toStdString().c_str(), OFTrue );
+    DcmFileFormat file;
+    if ( file.loadFile ( dcmFileName, EXS_Unknown, EGL_noChange, PreviewReadLength ).bad() ) {
+        return QImage();
+    }
+    DcmDataset * dset = file.getDataset();
+
+    // The middle frame represents a multi-frame object (cine, enhanced MR/CT, tomosynthesis) best.
+    // Only this frame is read from the file and decoded, not the whole pixel data.
+    Sint32 frameCount = 1;
+    if ( dset->findAndGetSint32 ( DCM_NumberOfFrames, frameCount ).bad() || frameCount < 1 ) {
+        frameCount = 1;
+    }
+    DicomImage image ( dset, dset->getOriginalXfer(), CIF_MayDetachPixelData | CIF_UsePartialAccessToPixelData, frameCount / 2, 1 );
+
+    const QImage preview = render ( &image, size );
+
+    OFString uid;
+    if ( instanceUid && dset->findAndGetOFString ( DCM_SOPInstanceUID, uid ).good() ) {
+        *instanceUid = QString::fromLatin1 ( uid.c_str() );
+    }
+
+    return preview;
+}
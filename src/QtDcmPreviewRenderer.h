@@ -0,0 +1,58 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMPREVIEWRENDERER_H
+#define QTDCMPREVIEWRENDERER_H
+
+#include <QtGui>
+
+class DicomImage;
+
+/**
+ * This class turns a decoded dicom image into a small preview image.
+ *
+ * Monochrome images are windowed straight from their native 8/16/32 bits pixel data
+ * (modality LUT applied), with the first VOI window of the file or the min/max of the frame,
+ * and resampled to the preview size in the same pass into a Format_Grayscale8 image.
+ * The min/max pass is the only one reading the whole frame and uses SSE2 when available.
+ */
+class QtDcmPreviewRenderer
+{
+public:
+    /**
+     * Render the first frame held by an image, the caller chooses which frame of
+     * a multi-frame object it decodes
+     *
+     * @param image a decoded image, its VOI window may be changed
+     * @param size the preview fits in a size x size square, keeping the aspect ratio
+     * @return a null image if the image could not be decoded
+     */
+    static QImage render ( DicomImage * image, int size );
+
+    /**
+     * Decode a dicom file and render its preview. Only the middle frame of a multi-frame
+     * object is read and decoded.
+     *
+     * @param instanceUid set to the SOPInstanceUID of the file if not NULL
+     * @return a null image if the file could not be decoded
+     */
+    static QImage renderFile ( const QString & filename, int size, QString * instanceUid = NULL );
+};
+
+#endif // QTDCMPREVIEWRENDERER_H
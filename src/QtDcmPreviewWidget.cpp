@@ -17,10 +17,79 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <cmath>
 
 #include "QtDcmPreviewWidget.h"
 
-QtDcmPreviewWidget::QtDcmPreviewWidget(QWidget* parent): QWidget(parent)
+class QtDcmPreviewWidget::Private
+{
+public:
+    QImage mosaic;                        /** The contact sheet, black until the tiles arrive */
+    int columns;
+    int tileSize;
+
+    void showMosaic ( QLabel * label ) const
+    {
+        label->setPixmap ( QPixmap::fromImage ( mosaic.scaled ( tileSize, tileSize, Qt::KeepAspectRatio, Qt::SmoothTransformation ) ) );
+    }
+};
+
+QtDcmPreviewWidget::QtDcmPreviewWidget(QWidget* parent): QWidget(parent),
+    d ( new QtDcmPreviewWidget::Private )
 {
   this->setupUi(this);
+  d->columns = 1;
+  d->tileSize = 0;
+}
+
+QtDcmPreviewWidget::~QtDcmPreviewWidget()
+{
+    delete d;
+    d = NULL;
+}
+
+void QtDcmPreviewWidget::startMosaic ( int count, int tileSize )
+{
+    if ( count < 1 || tileSize < 1 ) {
+        d->mosaic = QImage();
+        imageLabel->setPixmap ( QPixmap() );
+        return;
+    }
+
+    d->columns = ( int ) std::ceil ( std::sqrt ( ( double ) count ) );
+    d->tileSize = tileSize;
+    const int rows = ( count + d->columns - 1 ) / d->columns;
+
+    d->mosaic = QImage ( d->columns * tileSize, rows * tileSize, QImage::Format_RGB32 );
+    d->mosaic.fill ( Qt::black );
+    d->showMosaic ( imageLabel );
+    emit mosaicUpdated();
+}
+
+void QtDcmPreviewWidget::setMosaicTile ( int index, const QImage & image )
+{
+    if ( d->mosaic.isNull() || index < 0 || image.isNull() ) {
+        return;
+    }
+
+    const QRect tile ( ( index % d->columns ) * d->tileSize, ( index / d->columns ) * d->tileSize, d->tileSize, d->tileSize );
+    if ( !d->mosaic.rect().contains ( tile ) ) {
+        return;
+    }
+
+    const QImage scaled = image.scaled ( tile.size(), Qt::KeepAspectRatio, Qt::SmoothTransformation );
+    QRect target ( QPoint(), scaled.size() );
+    target.moveCenter ( tile.center() );
+
+    QPainter painter ( &d->mosaic );
+    painter.drawImage ( target.topLeft(), scaled );
+    painter.end();
+
+    d->showMosaic ( imageLabel );
+    emit mosaicUpdated();
+}
+
+QImage QtDcmPreviewWidget::mosaic() const
+{
+    return d->mosaic;
 }
@@ -30,7 +30,33 @@ class QTDCM_EXPORT QtDcmPreviewWidget : public QWidget, public Ui::QtDcmPreviewW
     Q_OBJECT
 public:
     explicit QtDcmPreviewWidget ( QWidget * parent = 0 );
-    virtual ~QtDcmPreviewWidget() {}
+    virtual ~QtDcmPreviewWidget();
+
+    /**
+     * Show an empty contact sheet in place of the preview, the tiles are filled
+     * by setMosaicTile() as the slices are decoded
+     *
+     * @param count number of tiles, laid out on a square grid
+     * @param tileSize the tiles are tileSize x tileSize pixels
+     */
+    void startMosaic ( int count, int tileSize );
+
+    /**
+     * Draw a slice in its tile, centered
+     */
+    void setMosaicTile ( int index, const QImage & image );
+
+    /**
+     * The contact sheet at full resolution, null if no mosaic has been started
+     */
+    QImage mosaic() const;
+
+signals:
+    void mosaicUpdated();
+
+private:
+    class Private;
+    Private * d;
 };
 
 #endif // QTDCMPREVIEWWIDGET_H
@@ -17,27 +17,43 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-
 #include <QtDcmImage.h>
-#include <QtDcmStudy.h>
 
 #include <QtDcmSerie.h>
 
-class QtDcmSerie::Private
+class QtDcmSerie::Private : public QSharedData
 {
 public:
     QString id; /** Serie dicom identificator */
     QString description; /** Serie description */
     QString date; /** Study date */
+    QString modality; /** Serie modality */
     QList<QtDcmImage> images; /** List of images in the serie */
-    QtDcmStudy study; /** Pointer on the parent study */
+    QHash<QString, int> imageIndex; /** key : image id => value : position in images */
+    QString studyUid; /** Uid of the parent study */
+
+    void reindex()
+    {
+        imageIndex.clear();
+        imageIndex.reserve ( images.size() );
+        for ( int i = 0; i < images.size(); i++ ) {
+            imageIndex.insert ( images[i].id(), i );
+        }
+    }
 };
 
 QtDcmSerie::QtDcmSerie() : d ( new QtDcmSerie::Private ) {}
 
+QtDcmSerie::QtDcmSerie ( const QtDcmSerie & other ) : d ( other.d ) {}
+
 QtDcmSerie::~QtDcmSerie()
 {
-    delete d;
+}
+
+QtDcmSerie & QtDcmSerie::operator= ( const QtDcmSerie & other )
+{
+    d = other.d;
+    return *this;
 }
 
 QString QtDcmSerie::id() const
@@ -70,6 +86,16 @@ void QtDcmSerie::setDescription (const QString &description)
     d->description = description;
 }
 
+QString QtDcmSerie::modality() const
+{
+    return d->modality;
+}
+
+void QtDcmSerie::setModality ( const QString & modality )
+{
+    d->modality = modality;
+}
+
 QList<QtDcmImage> QtDcmSerie::images() const
 {
     return d->images;
@@ -78,16 +104,60 @@ QList<QtDcmImage> QtDcmSerie::images() const
 void QtDcmSerie::setImages ( const QList<QtDcmImage> & images )
 {
     d->images = images;
+    d->reindex();
+}
+
+void QtDcmSerie::addImage ( const QtDcmImage & image )
+{
+    const int index = d->imageIndex.value ( image.id(), -1 );
+    if ( index >= 0 ) {
+        d->images[index] = image;
+        return;
+    }
+
+    d->imageIndex.insert ( image.id(), d->images.size() );
+    d->images.append ( image );
+}
+
+void QtDcmSerie::removeImage ( int index )
+{
+    d->images.removeAt ( index );
+    d->reindex();
+}
+
+bool QtDcmSerie::hasImage ( const QString & id ) const
+{
+    return d->imageIndex.contains ( id );
 }
 
-QtDcmStudy QtDcmSerie::study() const
+QtDcmImage QtDcmSerie::image ( const QString & id ) const
 {
-    return d->study;
+    const int index = d->imageIndex.value ( id, -1 );
+    return ( index >= 0 ) ? d->images.at ( index ) : QtDcmImage();
 }
 
-void QtDcmSerie::setStudy ( const QtDcmStudy & study )
+QtDcmImage & QtDcmSerie::image ( const QString & id )
 {
-    d->study = study;
+    int index = d->imageIndex.value ( id, -1 );
+    if ( index < 0 ) {
+        QtDcmImage added;
+        added.setId ( id );
+        added.setSerieUid ( d->id );
+
+        index = d->images.size();
+        d->imageIndex.insert ( id, index );
+        d->images.append ( added );
+    }
+
+    return d->images[index];
 }
 
+QString QtDcmSerie::studyUid() const
+{
+    return d->studyUid;
+}
 
+void QtDcmSerie::setStudyUid ( const QString & uid )
+{
+    d->studyUid = uid;
+}
@@ -17,18 +17,18 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-
 #ifndef QTDCMSERIE_H_
 #define QTDCMSERIE_H_
 
 #include <QtGui>
 
-class QtDcmSeriePrivate;
-class QtDcmStudy;
 class QtDcmImage;
 
 /**
  * This class is a representation of a dicom serie
+ *
+ * The serie is implicitly shared : copies are cheap and only detach when modified.
+ * Its images are indexed on their SOPInstanceUID.
  */
 
 class QtDcmSerie
@@ -39,15 +39,19 @@ public:
      */
     QtDcmSerie();
 
+    QtDcmSerie ( const QtDcmSerie & other );
+
     /**
      * Default destructor
      */
-    virtual ~QtDcmSerie();
+    ~QtDcmSerie();
+
+    QtDcmSerie & operator= ( const QtDcmSerie & other );
 
     /**
      * Serie Id getter
      *
-     * @return _id a QString
+     * @return the SeriesInstanceUID
      */
     QString id() const;
 
@@ -86,6 +90,20 @@ public:
      */
     void setDescription ( const QString & description );
 
+    /**
+     * Serie modality getter
+     *
+     * @return the Modality
+     */
+    QString modality() const;
+
+    /**
+     * Serie modality setter
+     *
+     * @param modality a QString
+     */
+    void setModality ( const QString & modality );
+
     /**
      * Image list getter
      *
@@ -102,25 +120,52 @@ public:
      */
     void setImages ( const QList<QtDcmImage> & images );
 
+    /**
+     * Add an image in the list, an image with the same id is replaced
+     */
+    void addImage ( const QtDcmImage & image );
+
+    /**
+     * Remove image at position index
+     */
+    void removeImage ( int index );
+
+    /**
+     * @return true if the serie has an image with this SOPInstanceUID
+     */
+    bool hasImage ( const QString & id ) const;
+
+    /**
+     * Image with this SOPInstanceUID, an empty image if there is none
+     */
+    QtDcmImage image ( const QString & id ) const;
+
+    /**
+     * Image with this SOPInstanceUID, an empty image having this id is added if there is none
+     */
+    QtDcmImage & image ( const QString & id );
+
     /**
      * Parent study getter
      *
-     * @return _p_study a pointer on the parent study
+     * @return the StudyInstanceUID of the parent study
      * @see QtDcmStudy
      */
-    QtDcmStudy study() const;
+    QString studyUid() const;
 
     /**
      * Parent study setter
      *
-     * @param study a pointer on the parent study
+     * @param uid the StudyInstanceUID of the parent study
      * @see QtDcmStudy
      */
-    void setStudy ( const QtDcmStudy & study );
+    void setStudyUid ( const QString & uid );
     
 private:
     class Private;
-    Private * d;
+    QSharedDataPointer<Private> d;
 };
 
+Q_DECLARE_TYPEINFO ( QtDcmSerie, Q_MOVABLE_TYPE );
+
 #endif /* QTDCMSERIE_H_ */
@@ -0,0 +1,49 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMSLICEMANIFEST_H
+#define QTDCMSLICEMANIFEST_H
+
+#include <QtGui>
+
+/**
+ * Geometry of a received slice, recorded by the move SCU when the dataset is stored
+ * so that the converter does not have to parse the file again.
+ */
+struct QtDcmSlice
+{
+    QString filename;           /** Absolute path of the stored file */
+    QString sopInstanceUid;     /** SOPInstanceUID */
+    double position[3];         /** ImagePositionPatient, 0 if missing */
+    double orientation[6];      /** ImageOrientationPatient, 0 if missing */
+    int instanceNumber;         /** InstanceNumber, 0 if missing */
+    int rows;                   /** Rows, 0 if missing */
+    int columns;                /** Columns, 0 if missing */
+    QString acquisitionTime;    /** AcquisitionTime (HHMMSS.FFFFFF) */
+};
+
+/**
+ * All the slices of a serie, in reception order
+ */
+typedef QList<QtDcmSlice> QtDcmSliceManifest;
+
+Q_DECLARE_METATYPE ( QtDcmSliceManifest )
+
+#endif // QTDCMSLICEMANIFEST_H
@@ -19,24 +19,41 @@
 
 #include <QtDcmStudy.h>
 #include <QtDcmSerie.h>
-#include <QtDcmPatient.h>
 
-class QtDcmStudy::Private
+class QtDcmStudy::Private : public QSharedData
 {
 public:
     QString id; /** Dicom study identificator */
+    QString uid; /** Dicom study instance uid */
     QString description; /** Dicom study description */
     QDate date; /** Dicom study date */
     QString time; /** Dicom study time */
     QList<QtDcmSerie> series; /** List of series in the study */
-    QtDcmPatient patient; /** Patient corresponding to the study */
+    QHash<QString, int> serieIndex; /** key : serie id => value : position in series */
+    QString patientId; /** Id of the patient corresponding to the study */
+
+    void reindex()
+    {
+        serieIndex.clear();
+        serieIndex.reserve ( series.size() );
+        for ( int i = 0; i < series.size(); i++ ) {
+            serieIndex.insert ( series[i].id(), i );
+        }
+    }
 };
 
 QtDcmStudy::QtDcmStudy() : d ( new QtDcmStudy::Private ) {}
 
+QtDcmStudy::QtDcmStudy ( const QtDcmStudy & other ) : d ( other.d ) {}
+
 QtDcmStudy::~QtDcmStudy()
 {
-    delete d;
+}
+
+QtDcmStudy & QtDcmStudy::operator= ( const QtDcmStudy & other )
+{
+    d = other.d;
+    return *this;
 }
 
 QString QtDcmStudy::id() const
@@ -49,6 +66,16 @@ void QtDcmStudy::setId ( const QString & id )
     d->id = id;
 }
 
+QString QtDcmStudy::uid() const
+{
+    return d->uid;
+}
+
+void QtDcmStudy::setUid ( const QString & uid )
+{
+    d->uid = uid;
+}
+
 QString QtDcmStudy::description() const
 {
     return d->description;
@@ -87,24 +114,60 @@ QList<QtDcmSerie> QtDcmStudy::series() const
 void QtDcmStudy::setSeries ( const QList<QtDcmSerie> & series )
 {
     d->series = series;
+    d->reindex();
 }
 
-QtDcmPatient QtDcmStudy::patient() const
+QString QtDcmStudy::patientId() const
 {
-    return d->patient;
+    return d->patientId;
 }
 
-void QtDcmStudy::setPatient ( const QtDcmPatient & patient )
+void QtDcmStudy::setPatientId ( const QString & id )
 {
-    d->patient = patient;
+    d->patientId = id;
 }
 
 void QtDcmStudy::addSerie ( const QtDcmSerie & serie )
 {
+    const int index = d->serieIndex.value ( serie.id(), -1 );
+    if ( index >= 0 ) {
+        d->series[index] = serie;
+        return;
+    }
+
+    d->serieIndex.insert ( serie.id(), d->series.size() );
     d->series.append ( serie );
 }
 
 void QtDcmStudy::removeSerie ( int index )
 {
     d->series.removeAt ( index );
+    d->reindex();
+}
+
+bool QtDcmStudy::hasSerie ( const QString & id ) const
+{
+    return d->serieIndex.contains ( id );
+}
+
+QtDcmSerie QtDcmStudy::serie ( const QString & id ) const
+{
+    const int index = d->serieIndex.value ( id, -1 );
+    return ( index >= 0 ) ? d->series.at ( index ) : QtDcmSerie();
+}
+
+QtDcmSerie & QtDcmStudy::serie ( const QString & id )
+{
+    int index = d->serieIndex.value ( id, -1 );
+    if ( index < 0 ) {
+        QtDcmSerie added;
+        added.setId ( id );
+        added.setStudyUid ( d->uid );
+
+        index = d->series.size();
+        d->serieIndex.insert ( id, index );
+        d->series.append ( added );
+    }
+
+    return d->series[index];
 }
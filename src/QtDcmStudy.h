@@ -23,11 +23,13 @@
 #include <QtGui>
 #include <QList>
 
-class QtDcmPatient;
 class QtDcmSerie;
 
 /**
  * This class is representation of a Dicom study.
+ *
+ * The study is implicitly shared : copies are cheap and only detach when modified.
+ * Its series are indexed on their SeriesInstanceUID.
  */
 
 class QtDcmStudy
@@ -38,10 +40,14 @@ public:
      */
     QtDcmStudy();
 
+    QtDcmStudy ( const QtDcmStudy & other );
+
     /**
      * Default destructor
      */
-    virtual ~QtDcmStudy();
+    ~QtDcmStudy();
+
+    QtDcmStudy & operator= ( const QtDcmStudy & other );
 
     /**
      * Study Id getter
@@ -57,6 +63,20 @@ public:
      */
     void setId ( const QString & id );
 
+    /**
+     * Study instance uid getter
+     *
+     * @return the StudyInstanceUID
+     */
+    QString uid() const;
+
+    /**
+     * Study instance uid setter
+     *
+     * @param uid as a QString
+     */
+    void setUid ( const QString & uid );
+
     /**
      * Study description getter
      *
@@ -118,21 +138,21 @@ public:
     /**
      * Patient getter
      *
-     * @return _p_patient as a patient
+     * @return the PatientID of the parent patient
      * @see QtDcmPatient
      */
-    QtDcmPatient  patient() const;
+    QString patientId() const;
 
     /**
      * Patient setter
      *
-     * @param patient
+     * @param id the PatientID of the parent patient
      * @see QtDcmPatient
      */
-    void setPatient ( const QtDcmPatient & patient );
+    void setPatientId ( const QString & id );
 
     /**
-     * Add serie in the list
+     * Add serie in the list, a serie with the same id is replaced
      */
     void addSerie ( const QtDcmSerie & serie );
 
@@ -140,10 +160,27 @@ public:
      * Remove serie at position index
      */
     void removeSerie ( int index );
+
+    /**
+     * @return true if the study has a serie with this SeriesInstanceUID
+     */
+    bool hasSerie ( const QString & id ) const;
+
+    /**
+     * Serie with this SeriesInstanceUID, an empty serie if there is none
+     */
+    QtDcmSerie serie ( const QString & id ) const;
+
+    /**
+     * Serie with this SeriesInstanceUID, an empty serie having this id is added if there is none
+     */
+    QtDcmSerie & serie ( const QString & id );
     
 private:
     class Private;
-    Private * d;
+    QSharedDataPointer<Private> d;
 };
 
+Q_DECLARE_TYPEINFO ( QtDcmStudy, Q_MOVABLE_TYPE );
+
 #endif /* QTDCMSTUDY_H_ */
@@ -0,0 +1,71 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmThreadBudget.h>
+
+Q_GLOBAL_STATIC ( QThreadPool, sharedDecodingPool )
+
+namespace
+{
+QAtomicInt budget ( 0 );
+}
+
+int QtDcmThreadBudget::total()
+{
+    const int threads = budget.loadAcquire();
+    return ( threads > 0 ) ? threads : qMax ( 1, QThread::idealThreadCount() );
+}
+
+void QtDcmThreadBudget::setTotal ( int threads )
+{
+    budget.storeRelease ( threads );
+}
+
+int QtDcmThreadBudget::concurrentConversions()
+{
+    // Two threads per conversion, for the ITK filters and the compression of a serie
+    const int conversionThreads = qMax ( 1, total() / 2 );
+    return qMax ( 1, conversionThreads / 2 );
+}
+
+int QtDcmThreadBudget::threadsPerConversion()
+{
+    return qMax ( 1, qMax ( 1, total() / 2 ) / concurrentConversions() );
+}
+
+int QtDcmThreadBudget::decodingThreads()
+{
+    return qMax ( 1, total() / 4 );
+}
+
+QThreadPool * QtDcmThreadBudget::decodingPool()
+{
+    // The budget may have been changed in the preferences since the last call
+    QThreadPool * pool = sharedDecodingPool();
+    pool->setMaxThreadCount ( decodingThreads() );
+    return pool;
+}
+
+int QtDcmThreadBudget::previewThreads()
+{
+    return qMax ( 1, total() / 4 );
+}
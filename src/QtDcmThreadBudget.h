@@ -0,0 +1,76 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMTHREADBUDGET_H
+#define QTDCMTHREADBUDGET_H
+
+#include <QtGui>
+
+/**
+ * This class shares the threads of QtDcmPreferences::threadBudget() between the kinds of work
+ * QtDcm runs in parallel : half for the conversions, a quarter for the decompression and
+ * header parsing, a quarter for the previews (at least one thread each).
+ *
+ * The conversion share is split between series converted at the same time and the threads
+ * each conversion gives to ITK and to the compression, so that several conversions in
+ * parallel do not each start a thread per core.
+ */
+class QtDcmThreadBudget
+{
+public:
+    /**
+     * Number of threads QtDcm may use
+     */
+    static int total();
+
+    /**
+     * Set by QtDcmPreferences whenever its thread budget changes, 0 for one thread per core.
+     * The preferences are not thread safe, the budget is read here from any thread.
+     */
+    static void setTotal ( int threads );
+
+    /**
+     * Number of series converted at the same time
+     */
+    static int concurrentConversions();
+
+    /**
+     * Number of threads of a single conversion (ITK filters, compression)
+     */
+    static int threadsPerConversion();
+
+    /**
+     * Number of threads decoding or parsing dicom files
+     */
+    static int decodingThreads();
+
+    /**
+     * Pool of decodingThreads() threads shared by all the conversions, so that conversions
+     * running at the same time do not each start their own decoding threads
+     */
+    static QThreadPool * decodingPool();
+
+    /**
+     * Number of threads computing previews
+     */
+    static int previewThreads();
+};
+
+#endif // QTDCMTHREADBUDGET_H
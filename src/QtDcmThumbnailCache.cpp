@@ -0,0 +1,235 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmThumbnailCache.h>
+
+namespace
+{
+const int MemoryBudget = 16 * 1024;       /** Size of the previews kept in memory in KB */
+const char * const RenderVersion = "2";   /** Changes whenever the renderer output changes, so that old previews are not reused */
+
+int imageCost ( const QImage & image )
+{
+    return qMax ( 1, image.bytesPerLine() * image.height() / 1024 );
+}
+}
+
+class QtDcmThumbnailCache::Private
+{
+public:
+    QString directory;
+    QCache<QByteArray, QImage> images;
+    qint64 diskUsage;                     /** Size of the saved previews in bytes, -1 until the directory has been listed */
+    qint64 diskBudget;
+    bool sizing;                          /** A thread is listing or trimming the directory */
+    mutable QMutex mutex;                 /** Only held to update the members above, never during disk accesses */
+
+    QString filename ( const QByteArray & key ) const
+    {
+        return directory + QDir::separator() + QString::fromLatin1 ( key ) + ".png";
+    }
+
+    /**
+     * Size of the saved previews, called without the lock
+     */
+    qint64 listDirectory() const
+    {
+        qint64 size = 0;
+        const QFileInfoList files = QDir ( directory ).entryInfoList ( QStringList() << "*.png", QDir::Files );
+        for ( const QFileInfo & file : files ) {
+            size += file.size();
+        }
+        return size;
+    }
+
+    /**
+     * Remove the least recently used files until the cache is back to 3/4 of its budget,
+     * called without the lock. Returns the size removed.
+     */
+    qint64 trim ( qint64 usage, qint64 budget ) const
+    {
+        qint64 removed = 0;
+        const QFileInfoList files = QDir ( directory ).entryInfoList ( QStringList() << "*.png", QDir::Files, QDir::Time | QDir::Reversed );
+        for ( const QFileInfo & file : files ) {
+            if ( usage - removed <= budget * 3 / 4 ) {
+                break;
+            }
+
+            const qint64 size = file.size();
+            if ( QFile::remove ( file.absoluteFilePath() ) ) {
+                removed += size;
+            }
+        }
+        return removed;
+    }
+};
+
+QtDcmThumbnailCache::QtDcmThumbnailCache ( const QString & directory )
+    : d ( new QtDcmThumbnailCache::Private )
+{
+    d->directory = directory;
+    if ( d->directory.isEmpty() ) {
+        d->directory = QDir::homePath() + QDir::separator() + ".qtdcm" + QDir::separator() + "thumbnails";
+    }
+    d->images.setMaxCost ( MemoryBudget );
+    d->diskUsage = -1;
+    d->sizing = false;
+    d->diskBudget = qint64 ( 64 ) * 1024 * 1024;
+}
+
+QtDcmThumbnailCache::~QtDcmThumbnailCache()
+{
+    delete d;
+    d = NULL;
+}
+
+QByteArray QtDcmThumbnailCache::key ( const QString & instanceUid, const QString & parameters )
+{
+    QCryptographicHash hash ( QCryptographicHash::Sha1 );
+    hash.addData ( instanceUid.toUtf8() );
+    hash.addData ( "\n" );
+    hash.addData ( parameters.toUtf8() );
+    hash.addData ( "\n" );
+    hash.addData ( RenderVersion );
+    return hash.result().toHex();
+}
+
+qint64 QtDcmThumbnailCache::diskBudget() const
+{
+    QMutexLocker locker ( &d->mutex );
+    return d->diskBudget;
+}
+
+void QtDcmThumbnailCache::setDiskBudget ( qint64 bytes )
+{
+    QMutexLocker locker ( &d->mutex );
+    d->diskBudget = bytes;
+}
+
+QImage QtDcmThumbnailCache::find ( const QByteArray & key )
+{
+    {
+        QMutexLocker locker ( &d->mutex );
+        if ( const QImage * image = d->images.object ( key ) ) {
+            return *image;
+        }
+
+        if ( d->diskBudget <= 0 ) {
+            return QImage();
+        }
+    }
+
+    QFile file ( d->filename ( key ) );
+    if ( !file.open ( QIODevice::ReadOnly ) ) {
+        return QImage();
+    }
+
+    QImage image;
+    if ( !image.loadFromData ( file.readAll(), "PNG" ) ) {
+        return QImage();
+    }
+
+    // The modification time orders the files for trim(), if it can't be set only that order is lost
+    file.setFileTime ( QDateTime::currentDateTime(), QFileDevice::FileModificationTime );
+
+    QMutexLocker locker ( &d->mutex );
+    d->images.insert ( key, new QImage ( image ), imageCost ( image ) );
+
+    return image;
+}
+
+void QtDcmThumbnailCache::insert ( const QByteArray & key, const QImage & image )
+{
+    if ( image.isNull() ) {
+        return;
+    }
+
+    // The GUI thread looks previews up while the workers insert them: the lock is only held
+    // to update the members, the encoding and the disk accesses are done without it
+    qint64 budget = 0;
+    bool listing = false;
+    {
+        QMutexLocker locker ( &d->mutex );
+        d->images.insert ( key, new QImage ( image ), imageCost ( image ) );
+
+        budget = d->diskBudget;
+        if ( budget > 0 && d->diskUsage < 0 && !d->sizing ) {
+            d->sizing = true;
+            listing = true;
+        }
+    }
+
+    if ( budget <= 0 || !QDir().mkpath ( d->directory ) ) {
+        if ( listing ) {
+            QMutexLocker locker ( &d->mutex );
+            d->sizing = false;
+        }
+        return;
+    }
+
+    // A single thread lists the directory. The previews saved meanwhile may be missed or counted twice,
+    // the usage only has to keep the cache around its budget
+    if ( listing ) {
+        const qint64 usage = d->listDirectory();
+        QMutexLocker locker ( &d->mutex );
+        d->diskUsage = usage;
+        d->sizing = false;
+    }
+
+    QByteArray data;
+    QBuffer buffer ( &data );
+    if ( !buffer.open ( QIODevice::WriteOnly ) || !image.save ( &buffer, "PNG" ) ) {
+        qWarning() << "Cannot encode the preview" << key;
+        return;
+    }
+
+    const QString filename = d->filename ( key );
+    const QFileInfo previous ( filename );
+    const qint64 previousSize = previous.exists() ? previous.size() : 0;
+
+    QSaveFile file ( filename );
+    if ( !file.open ( QIODevice::WriteOnly ) || file.write ( data ) != data.size() || !file.commit() ) {
+        qWarning() << "Cannot save the preview" << filename;
+        return;
+    }
+
+    qint64 usage = 0;
+    {
+        QMutexLocker locker ( &d->mutex );
+        if ( d->diskUsage < 0 ) {
+            return;
+        }
+
+        d->diskUsage += data.size() - previousSize;
+        if ( d->diskUsage <= budget || d->sizing ) {
+            return;
+        }
+
+        d->sizing = true;
+        usage = d->diskUsage;
+    }
+
+    const qint64 removed = d->trim ( usage, budget );
+
+    QMutexLocker locker ( &d->mutex );
+    d->diskUsage = qMax ( qint64 ( 0 ), d->diskUsage - removed );
+    d->sizing = false;
+}
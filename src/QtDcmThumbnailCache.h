@@ -0,0 +1,78 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef QTDCMTHUMBNAILCACHE_H
+#define QTDCMTHUMBNAILCACHE_H
+
+#include <QtGui>
+
+/**
+ * This class keeps the previews already rendered, so that going back to a serie
+ * neither moves nor decodes its instance again.
+ *
+ * A preview is identified by the SOPInstanceUID of the instance and the parameters
+ * it was rendered with. The most recently used previews are kept in memory, and all of
+ * them are saved as small PNG files that survive the session. The disk cache is limited
+ * to diskBudget(), the least recently used files are removed first.
+ *
+ * All the methods may be called from any thread.
+ */
+class QtDcmThumbnailCache
+{
+public:
+    /**
+     * @param directory where the previews are saved, ~/.qtdcm/thumbnails if empty
+     */
+    QtDcmThumbnailCache ( const QString & directory = QString() );
+    virtual ~QtDcmThumbnailCache();
+
+    /**
+     * Key of a preview
+     *
+     * @param instanceUid SOPInstanceUID of the previewed instance
+     * @param parameters anything that changes the rendered image (size, frame...)
+     */
+    static QByteArray key ( const QString & instanceUid, const QString & parameters );
+
+    /**
+     * Size in bytes of the previews kept on disk (64 MB by default), 0 disables the disk cache.
+     * Set by the owner from QtDcmPreferences::thumbnailCacheSize(), so that the worker threads
+     * using the cache don't read the preferences.
+     */
+    qint64 diskBudget() const;
+    void setDiskBudget ( qint64 bytes );
+
+    /**
+     * The preview saved for a key, a null image if there is none
+     */
+    QImage find ( const QByteArray & key );
+
+    /**
+     * Keep a preview in memory and save it on disk
+     */
+    void insert ( const QByteArray & key, const QImage & image );
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmThumbnailCache )
+};
+
+#endif // QTDCMTHUMBNAILCACHE_H
@@ -0,0 +1,170 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtDcmVolume.h>
+
+class QtDcmVolume::Private : public QSharedData
+{
+public:
+    const void * data;
+    QSharedPointer<const void> owner;
+    QtDcmVolume::eComponentType componentType;
+    int components;
+    int size[4];
+    double spacing[4];
+    double origin[4];
+    double direction[3][3];
+};
+
+QtDcmVolume::QtDcmVolume()
+{
+}
+
+QtDcmVolume::QtDcmVolume ( const void * data, const QSharedPointer<const void> & owner )
+    : d ( new QtDcmVolume::Private )
+{
+    d->data = data;
+    d->owner = owner;
+    d->componentType = INT16;
+    d->components = 1;
+    for ( int i = 0; i < 4; i++ ) {
+        d->size[i] = 1;
+        d->spacing[i] = 1;
+        d->origin[i] = 0;
+    }
+    for ( int i = 0; i < 3; i++ ) {
+        for ( int j = 0; j < 3; j++ ) {
+            d->direction[i][j] = ( i == j ) ? 1 : 0;
+        }
+    }
+}
+
+QtDcmVolume::QtDcmVolume ( const QtDcmVolume & other ) : d ( other.d )
+{
+}
+
+QtDcmVolume & QtDcmVolume::operator= ( const QtDcmVolume & other )
+{
+    d = other.d;
+    return *this;
+}
+
+QtDcmVolume::~QtDcmVolume()
+{
+}
+
+bool QtDcmVolume::isNull() const
+{
+    return !d || !d->data;
+}
+
+const void * QtDcmVolume::data() const
+{
+    return d ? d->data : NULL;
+}
+
+qint64 QtDcmVolume::byteCount() const
+{
+    if ( isNull() ) {
+        return 0;
+    }
+
+    static const int componentSizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+    return qint64 ( d->size[0] ) * d->size[1] * d->size[2] * d->size[3] * d->components * componentSizes[d->componentType];
+}
+
+QtDcmVolume::eComponentType QtDcmVolume::componentType() const
+{
+    return d ? d->componentType : INT16;
+}
+
+int QtDcmVolume::components() const
+{
+    return d ? d->components : 0;
+}
+
+int QtDcmVolume::dimension() const
+{
+    return ( d && d->size[3] > 1 ) ? 4 : 3;
+}
+
+int QtDcmVolume::size ( int axis ) const
+{
+    return ( d && axis >= 0 && axis < 4 ) ? d->size[axis] : 0;
+}
+
+double QtDcmVolume::spacing ( int axis ) const
+{
+    return ( d && axis >= 0 && axis < 4 ) ? d->spacing[axis] : 1;
+}
+
+double QtDcmVolume::origin ( int axis ) const
+{
+    return ( d && axis >= 0 && axis < 4 ) ? d->origin[axis] : 0;
+}
+
+double QtDcmVolume::direction ( int i, int j ) const
+{
+    if ( !d || i < 0 || i > 2 || j < 0 || j > 2 ) {
+        return ( i == j ) ? 1 : 0;
+    }
+    return d->direction[i][j];
+}
+
+void QtDcmVolume::setComponentType ( QtDcmVolume::eComponentType type, int components )
+{
+    if ( d ) {
+        d->componentType = type;
+        d->components = components;
+    }
+}
+
+void QtDcmVolume::setSize ( int x, int y, int z, int t )
+{
+    if ( d ) {
+        d->size[0] = x;
+        d->size[1] = y;
+        d->size[2] = z;
+        d->size[3] = t;
+    }
+}
+
+void QtDcmVolume::setSpacing ( int axis, double spacing )
+{
+    if ( d && axis >= 0 && axis < 4 ) {
+        d->spacing[axis] = spacing;
+    }
+}
+
+void QtDcmVolume::setOrigin ( int axis, double origin )
+{
+    if ( d && axis >= 0 && axis < 4 ) {
+        d->origin[axis] = origin;
+    }
+}
+
+void QtDcmVolume::setDirection ( int i, int j, double value )
+{
+    if ( d && i >= 0 && i < 3 && j >= 0 && j < 3 ) {
+        d->direction[i][j] = value;
+    }
+}
@@ -0,0 +1,120 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMVOLUME_H
+#define QTDCMVOLUME_H
+
+#include "qtdcmExports.h"
+#include <QtGui>
+
+/**
+ * This class hands a converted image over to the host application without writing it :
+ * the voxel buffer of the conversion, its size and its geometry.
+ *
+ * The buffer is not copied, it is shared by all the copies of the volume and released with
+ * the last one. The description (size, geometry) is implicitly shared : the setters only
+ * change the copy they are called on. The geometry follows the ITK/DICOM (LPS) convention, so the buffer can be
+ * wrapped in an itk::Image (itk::ImportImageFilter) or a vtkImageData as is.
+ */
+class QTDCM_EXPORT QtDcmVolume
+{
+public:
+    enum eComponentType
+    {
+        UINT8,
+        INT8,
+        UINT16,
+        INT16,
+        UINT32,
+        INT32,
+        FLOAT32,
+        FLOAT64
+    };
+
+    /**
+     * A null volume
+     */
+    QtDcmVolume();
+
+    /**
+     * A volume on a buffer
+     *
+     * @param data the voxels, x varying fastest, then y, z and t
+     * @param owner keeps the buffer alive, released with the last copy of the volume
+     */
+    QtDcmVolume ( const void * data, const QSharedPointer<const void> & owner );
+
+    QtDcmVolume ( const QtDcmVolume & other );
+    QtDcmVolume & operator= ( const QtDcmVolume & other );
+    virtual ~QtDcmVolume();
+
+    bool isNull() const;
+
+    const void * data() const;
+
+    /**
+     * Size of the buffer in bytes
+     */
+    qint64 byteCount() const;
+
+    eComponentType componentType() const;
+
+    /**
+     * Number of components of a voxel : 1, or 3 for RGB images
+     */
+    int components() const;
+
+    /**
+     * 3, or 4 for a time serie
+     */
+    int dimension() const;
+
+    /**
+     * Number of voxels along an axis (0 to 3), 1 for the axes beyond the dimension
+     */
+    int size ( int axis ) const;
+
+    double spacing ( int axis ) const;
+
+    double origin ( int axis ) const;
+
+    /**
+     * Direction cosines, the j axis of the image is (direction(0, j), direction(1, j), direction(2, j))
+     */
+    double direction ( int i, int j ) const;
+
+    /**
+     * Setters used by the conversion to describe the buffer
+     */
+    void setComponentType ( eComponentType type, int components = 1 );
+    void setSize ( int x, int y, int z, int t = 1 );
+    void setSpacing ( int axis, double spacing );
+    void setOrigin ( int axis, double origin );
+    void setDirection ( int i, int j, double value );
+
+private:
+    class Private;
+    QSharedDataPointer<Private> d;
+};
+
+Q_DECLARE_METATYPE ( QtDcmVolume )
+Q_DECLARE_METATYPE ( QList<QtDcmVolume> )
+
+#endif // QTDCMVOLUME_H
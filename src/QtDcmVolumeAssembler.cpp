@@ -0,0 +1,542 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcuid.h>
+#include <dcmtk/dcmdata/dcxfer.h>
+
+#include <itkImage.h>
+
+#include <QtDcmCodecs.h>
+#include <QtDcmImageWriter.h>
+#include <QtDcmVolumeAssembler.h>
+
+namespace
+{
+struct SliceEntry
+{
+    int index;                  /** Index of the slice in the volume buffer */
+    double distance;            /** Position along the normal */
+    double position[3];
+    int instance;
+    double slope;
+    double intercept;
+    DcmDataset * header;        /** Header of the slice without its pixel data, if the datasets are kept */
+};
+}
+
+class QtDcmVolumeAssembler::Private
+{
+public:
+    bool valid;
+    bool keepDatasets;
+
+    Uint16 rows;
+    Uint16 columns;
+    Uint16 bitsAllocated;
+    Uint16 pixelRepresentation;
+    double spacing[2];          /** PixelSpacing : row spacing, column spacing */
+    double orientation[6];
+    double normal[3];
+
+    qint64 sliceBytes;
+    int expectedSlices;         /** Number of slices announced with reserve() */
+    int capacity;               /** Number of slices the volume buffer can hold */
+    itk::ImageBase<3>::Pointer image; /** Volume of the stored pixel type, the slices are in reception order */
+    char * buffer;              /** Pixel buffer of the image */
+    QVector<SliceEntry> slices;
+    QMap<double, int> distances; /** Positions along the normal of the slices, to find the repeated ones */
+    QStringList instanceUids;
+
+    bool readGeometry ( DcmDataset * dataset );
+    bool reserveSlices ( int sliceCount );
+    void sortBuffer();
+    void release();
+
+    char * slot ( int index ) const
+    {
+        return buffer + index * sliceBytes;
+    }
+
+    template <typename StoredType>
+    void allocate ( int sliceCount );
+
+    template <typename StoredType, typename PixelType>
+    bool write ( const QString & filename, double sliceSpacing, int compressionLevel, QtDcmVolume * volume );
+};
+
+bool QtDcmVolumeAssembler::Private::readGeometry ( DcmDataset * dataset )
+{
+    Uint16 samplesPerPixel = 1;
+    Uint16 bitsStored = 0;
+    Sint32 frames = 1;
+    dataset->findAndGetUint16 ( DCM_SamplesPerPixel, samplesPerPixel );
+    dataset->findAndGetUint16 ( DCM_BitsStored, bitsStored );
+    dataset->findAndGetSint32 ( DCM_NumberOfFrames, frames );
+
+    if ( dataset->findAndGetUint16 ( DCM_Rows, rows ).bad()
+         || dataset->findAndGetUint16 ( DCM_Columns, columns ).bad()
+         || dataset->findAndGetUint16 ( DCM_BitsAllocated, bitsAllocated ).bad()
+         || dataset->findAndGetUint16 ( DCM_PixelRepresentation, pixelRepresentation ).bad() ) {
+        return false;
+    }
+
+    // Signed values stored on fewer bits would need a sign extension, leave them to the GDCM reader
+    if ( samplesPerPixel != 1 || frames > 1
+         || ( bitsAllocated != 8 && bitsAllocated != 16 )
+         || ( pixelRepresentation == 1 && bitsStored != bitsAllocated ) ) {
+        return false;
+    }
+
+    spacing[0] = spacing[1] = 1;
+    dataset->findAndGetFloat64 ( DCM_PixelSpacing, spacing[0], 0 );
+    dataset->findAndGetFloat64 ( DCM_PixelSpacing, spacing[1], 1 );
+
+    for ( int i = 0; i < 6; i++ ) {
+        orientation[i] = ( i == 0 || i == 4 ) ? 1 : 0;
+        dataset->findAndGetFloat64 ( DCM_ImageOrientationPatient, orientation[i], i );
+    }
+    normal[0] = orientation[1] * orientation[5] - orientation[2] * orientation[4];
+    normal[1] = orientation[2] * orientation[3] - orientation[0] * orientation[5];
+    normal[2] = orientation[0] * orientation[4] - orientation[1] * orientation[3];
+
+    sliceBytes = qint64 ( rows ) * columns * ( bitsAllocated / 8 );
+    return true;
+}
+
+template <typename StoredType>
+void QtDcmVolumeAssembler::Private::allocate ( int sliceCount )
+{
+    typedef itk::Image< StoredType, 3 >             ImageType;
+
+    typename ImageType::SizeType size;
+    size[0] = columns;
+    size[1] = rows;
+    size[2] = sliceCount;
+    typename ImageType::RegionType region;
+    region.SetSize ( size );
+
+    typename ImageType::Pointer allocated = ImageType::New();
+    allocated->SetRegions ( region );
+    allocated->Allocate();
+
+    // Only happens when more slices are received than announced
+    char * allocatedBuffer = reinterpret_cast<char *> ( allocated->GetBufferPointer() );
+    if ( buffer ) {
+        std::memcpy ( allocatedBuffer, buffer, slices.size() * sliceBytes );
+    }
+
+    image = allocated.GetPointer();
+    buffer = allocatedBuffer;
+    capacity = sliceCount;
+}
+
+bool QtDcmVolumeAssembler::Private::reserveSlices ( int sliceCount )
+{
+    if ( sliceCount <= capacity ) {
+        return true;
+    }
+
+    try {
+        if ( bitsAllocated == 8 ) {
+            pixelRepresentation ? allocate<Sint8> ( sliceCount ) : allocate<Uint8> ( sliceCount );
+        }
+        else {
+            pixelRepresentation ? allocate<Sint16> ( sliceCount ) : allocate<Uint16> ( sliceCount );
+        }
+    }
+    catch ( itk::ExceptionObject &ex ) {
+        qWarning() << "Cannot allocate a volume of" << sliceCount << "slices :" << ex.GetDescription();
+        return false;
+    }
+    catch ( std::bad_alloc & ) {
+        qWarning() << "Cannot allocate a volume of" << sliceCount << "slices";
+        return false;
+    }
+
+    return true;
+}
+
+void QtDcmVolumeAssembler::Private::sortBuffer()
+{
+    // Follow the cycles of the permutation, each slice is moved once through a single temporary slice
+    QByteArray temporary ( int ( sliceBytes ), Qt::Uninitialized );
+    for ( int s = 0; s < slices.size(); s++ ) {
+        if ( slices.at ( s ).index == s ) {
+            continue;
+        }
+
+        std::memcpy ( temporary.data(), slot ( s ), sliceBytes );
+        int j = s;
+        while ( slices.at ( j ).index != s ) {
+            const int k = slices.at ( j ).index;
+            std::memcpy ( slot ( j ), slot ( k ), sliceBytes );
+            slices[j].index = j;
+            j = k;
+        }
+        std::memcpy ( slot ( j ), temporary.constData(), sliceBytes );
+        slices[j].index = j;
+    }
+}
+
+void QtDcmVolumeAssembler::Private::release()
+{
+    for ( const SliceEntry & slice : slices ) {
+        delete slice.header;
+    }
+    slices.clear();
+    distances.clear();
+    instanceUids.clear();
+    image = NULL;
+    buffer = NULL;
+    capacity = 0;
+}
+
+template <typename StoredType, typename PixelType>
+bool QtDcmVolumeAssembler::Private::write ( const QString & filename, double sliceSpacing, int compressionLevel, QtDcmVolume * volume )
+{
+    typedef itk::Image< PixelType, 3 >              ImageType;
+
+    typename ImageType::SizeType size;
+    size[0] = columns;
+    size[1] = rows;
+    size[2] = slices.size();
+    typename ImageType::RegionType region;
+    region.SetSize ( size );
+
+    const qint64 slicePixels = qint64 ( rows ) * columns;
+    typename ImageType::Pointer output;
+
+    if ( std::is_same<StoredType, PixelType>::value ) {
+        // The received volume is written as is, once its slices are in order
+        sortBuffer();
+        output = dynamic_cast<ImageType *> ( image.GetPointer() );
+        output->GetPixelContainer()->Reserve ( slices.size() * slicePixels );
+        output->SetRegions ( region );
+    }
+    else {
+        output = ImageType::New();
+        output->SetRegions ( region );
+        output->Allocate();
+
+        // Each slice has its own rescale slope and intercept
+        PixelType * out = output->GetBufferPointer();
+        for ( int s = 0; s < slices.size(); s++ ) {
+            const SliceEntry & slice = slices.at ( s );
+            const StoredType * in = reinterpret_cast<const StoredType *> ( slot ( slice.index ) );
+            PixelType * outSlice = out + s * slicePixels;
+            for ( qint64 i = 0; i < slicePixels; i++ ) {
+                outSlice[i] = static_cast<PixelType> ( in[i] * slice.slope + slice.intercept );
+            }
+        }
+    }
+
+    typename ImageType::SpacingType imageSpacing;
+    imageSpacing[0] = spacing[1];
+    imageSpacing[1] = spacing[0];
+    imageSpacing[2] = sliceSpacing;
+
+    typename ImageType::PointType origin;
+    typename ImageType::DirectionType direction;
+    for ( int i = 0; i < 3; i++ ) {
+        origin[i] = slices.first().position[i];
+        direction[i][0] = orientation[i];
+        direction[i][1] = orientation[3 + i];
+        direction[i][2] = normal[i];
+    }
+
+    output->SetSpacing ( imageSpacing );
+    output->SetOrigin ( origin );
+    output->SetDirection ( direction );
+
+    if ( volume ) {
+        *volume = QtDcmImageWriter::toVolume ( output.GetPointer() );
+    }
+
+    return filename.isEmpty() || QtDcmImageWriter::write ( output.GetPointer(), filename, compressionLevel );
+}
+
+QtDcmVolumeAssembler::QtDcmVolumeAssembler() : d ( new QtDcmVolumeAssembler::Private )
+{
+    // The compressed slices are decompressed by addSlice(), whether a preview was decoded before or not
+    QtDcmCodecs::registerDecoders();
+
+    d->valid = true;
+    d->keepDatasets = false;
+    d->sliceBytes = 0;
+    d->expectedSlices = 0;
+    d->capacity = 0;
+    d->buffer = NULL;
+}
+
+QtDcmVolumeAssembler::~QtDcmVolumeAssembler()
+{
+    d->release();
+    delete d;
+    d = NULL;
+}
+
+bool QtDcmVolumeAssembler::addSlice ( DcmDataset * dataset )
+{
+    if ( !d->valid || !dataset ) {
+        return false;
+    }
+
+    if ( d->slices.isEmpty() && !d->readGeometry ( dataset ) ) {
+        d->valid = false;
+        return false;
+    }
+
+    // Every slice must fit in the volume of the first one
+    Uint16 rows = 0;
+    Uint16 columns = 0;
+    Uint16 bitsAllocated = 0;
+    double orientation[6];
+    dataset->findAndGetUint16 ( DCM_Rows, rows );
+    dataset->findAndGetUint16 ( DCM_Columns, columns );
+    dataset->findAndGetUint16 ( DCM_BitsAllocated, bitsAllocated );
+    for ( int i = 0; i < 6; i++ ) {
+        orientation[i] = d->orientation[i];
+        dataset->findAndGetFloat64 ( DCM_ImageOrientationPatient, orientation[i], i );
+        if ( std::fabs ( orientation[i] - d->orientation[i] ) > 1e-3 ) {
+            d->valid = false;
+        }
+    }
+    if ( rows != d->rows || columns != d->columns || bitsAllocated != d->bitsAllocated ) {
+        d->valid = false;
+    }
+
+    double position[3];
+    for ( int i = 0; i < 3; i++ ) {
+        position[i] = 0;
+        dataset->findAndGetFloat64 ( DCM_ImagePositionPatient, position[i], i );
+    }
+    const double distance = d->normal[0] * position[0] + d->normal[1] * position[1] + d->normal[2] * position[2];
+
+    // Several slices at the same position : a time serie, not a volume. Found while receiving,
+    // so that the slices are still written if the dicom files are not
+    QMap<double, int>::const_iterator nearest = d->distances.lowerBound ( distance - 1e-4 );
+    if ( d->valid && nearest != d->distances.constEnd() && nearest.key() < distance + 1e-4 ) {
+        qWarning() << "Several slices at the same position, cannot assemble the volume";
+        d->valid = false;
+    }
+
+    // More slices than announced, grow the volume by half
+    if ( d->valid && d->slices.size() == d->capacity ) {
+        d->valid = d->reserveSlices ( qMax ( d->expectedSlices, d->slices.size() + qMax ( 16, d->slices.size() / 2 ) ) );
+    }
+
+    // Decompress in place if the serie was received with a compressed transfer syntax
+    if ( d->valid && dataset->chooseRepresentation ( EXS_LittleEndianExplicit, NULL ).bad() ) {
+        d->valid = false;
+    }
+
+    const char * data = NULL;
+    if ( d->valid ) {
+        if ( d->bitsAllocated == 8 ) {
+            const Uint8 * values = NULL;
+            dataset->findAndGetUint8Array ( DCM_PixelData, values );
+            data = reinterpret_cast<const char *> ( values );
+        }
+        else {
+            const Uint16 * values = NULL;
+            dataset->findAndGetUint16Array ( DCM_PixelData, values );
+            data = reinterpret_cast<const char *> ( values );
+        }
+        d->valid = ( data != NULL );
+    }
+
+    if ( !d->valid ) {
+        // The slices received so far are only lost if nobody can take them back
+        if ( !d->keepDatasets ) {
+            d->release();
+        }
+        return false;
+    }
+
+    SliceEntry slice;
+    slice.index = d->slices.size();
+    Sint32 instance = 0;
+    dataset->findAndGetSint32 ( DCM_InstanceNumber, instance );
+    slice.instance = instance;
+    for ( int i = 0; i < 3; i++ ) {
+        slice.position[i] = position[i];
+    }
+    slice.distance = distance;
+    slice.slope = 1;
+    slice.intercept = 0;
+    dataset->findAndGetFloat64 ( DCM_RescaleSlope, slice.slope );
+    dataset->findAndGetFloat64 ( DCM_RescaleIntercept, slice.intercept );
+
+    std::memcpy ( d->slot ( slice.index ), data, d->sliceBytes );
+
+    // The header is copied without the pixel data, which is already in the volume
+    slice.header = NULL;
+    if ( d->keepDatasets ) {
+        DcmElement * pixelData = dataset->remove ( DCM_PixelData );
+        slice.header = new DcmDataset ( *dataset );
+        dataset->insert ( pixelData );
+    }
+
+    OFString uid;
+    dataset->findAndGetOFString ( DCM_SOPInstanceUID, uid );
+
+    d->slices.append ( slice );
+    d->distances.insert ( distance, slice.index );
+    d->instanceUids.append ( QString ( uid.c_str() ).trimmed() );
+
+    return true;
+}
+
+void QtDcmVolumeAssembler::reserve ( int sliceCount )
+{
+    d->expectedSlices = qMax ( d->expectedSlices, sliceCount );
+
+    // Before the first slice the pixel format is not known, the volume is allocated with it
+    if ( d->valid && !d->slices.isEmpty() ) {
+        d->reserveSlices ( d->expectedSlices );
+    }
+}
+
+void QtDcmVolumeAssembler::setKeepDatasets ( bool keep )
+{
+    d->keepDatasets = keep;
+}
+
+QList<DcmDataset *> QtDcmVolumeAssembler::takeDatasets()
+{
+    QList<DcmDataset *> datasets;
+    if ( !d->keepDatasets ) {
+        return datasets;
+    }
+
+    const unsigned long slicePixels = ( unsigned long ) d->rows * d->columns;
+    for ( SliceEntry & slice : d->slices ) {
+        DcmDataset * dataset = slice.header;
+        slice.header = NULL;
+
+        if ( d->bitsAllocated == 8 ) {
+            dataset->putAndInsertUint8Array ( DCM_PixelData, reinterpret_cast<const Uint8 *> ( d->slot ( slice.index ) ), slicePixels );
+        }
+        else {
+            dataset->putAndInsertUint16Array ( DCM_PixelData, reinterpret_cast<const Uint16 *> ( d->slot ( slice.index ) ), slicePixels );
+        }
+        datasets.append ( dataset );
+    }
+
+    d->release();
+    return datasets;
+}
+
+bool QtDcmVolumeAssembler::saveDatasets ( const QString & directory, int * savedCount )
+{
+    bool success = true;
+    int saved = 0;
+
+    // The pixel data is kept decompressed
+    for ( DcmDataset * dataset : this->takeDatasets() ) {
+        OFString sopClass;
+        OFString sopInstance;
+        dataset->findAndGetOFString ( DCM_SOPClassUID, sopClass );
+        dataset->findAndGetOFString ( DCM_SOPInstanceUID, sopInstance );
+
+        const QString filename = directory + QDir::separator() + QString ( dcmSOPClassUIDToModality ( sopClass.c_str(), "UNKNOWN" ) )
+                                 + "." + QString ( sopInstance.c_str() );
+
+        DcmFileFormat fileFormat ( dataset );
+        const OFCondition cond = fileFormat.saveFile ( OFFilename ( filename.toUtf8().constData(), OFTrue ), EXS_LittleEndianExplicit );
+        if ( cond.good() ) {
+            saved++;
+        }
+        else {
+            qWarning() << "Cannot write" << filename << ":" << cond.text();
+            success = false;
+        }
+        delete dataset;
+    }
+
+    if ( savedCount ) {
+        *savedCount = saved;
+    }
+    return success;
+}
+
+bool QtDcmVolumeAssembler::isValid() const
+{
+    return d->valid;
+}
+
+int QtDcmVolumeAssembler::sliceCount() const
+{
+    return d->slices.size();
+}
+
+QStringList QtDcmVolumeAssembler::instanceUids() const
+{
+    return d->instanceUids;
+}
+
+bool QtDcmVolumeAssembler::write ( const QString & filename, int compressionLevel, QtDcmVolume * volume )
+{
+    if ( !d->valid || d->slices.isEmpty() ) {
+        return false;
+    }
+
+    // No two slices at the same position, see addSlice()
+    std::stable_sort ( d->slices.begin(), d->slices.end(), [] ( const SliceEntry & a, const SliceEntry & b ) {
+        return a.distance < b.distance;
+    } );
+
+    double sliceSpacing = 1;
+    if ( d->slices.size() > 1 ) {
+        sliceSpacing = ( d->slices.last().distance - d->slices.first().distance ) / ( d->slices.size() - 1 );
+    }
+
+    bool rescale = false;
+    for ( const SliceEntry & slice : d->slices ) {
+        rescale = rescale || slice.slope != 1 || slice.intercept != 0;
+    }
+
+    if ( d->bitsAllocated == 8 ) {
+        if ( rescale ) {
+            return d->pixelRepresentation ? d->write<Sint8, float> ( filename, sliceSpacing, compressionLevel, volume )
+                                          : d->write<Uint8, float> ( filename, sliceSpacing, compressionLevel, volume );
+        }
+        return d->pixelRepresentation ? d->write<Sint8, Sint8> ( filename, sliceSpacing, compressionLevel, volume )
+                                      : d->write<Uint8, Uint8> ( filename, sliceSpacing, compressionLevel, volume );
+    }
+
+    if ( rescale ) {
+        return d->pixelRepresentation ? d->write<Sint16, float> ( filename, sliceSpacing, compressionLevel, volume )
+                                      : d->write<Uint16, float> ( filename, sliceSpacing, compressionLevel, volume );
+    }
+    return d->pixelRepresentation ? d->write<Sint16, Sint16> ( filename, sliceSpacing, compressionLevel, volume )
+                                  : d->write<Uint16, Uint16> ( filename, sliceSpacing, compressionLevel, volume );
+}
@@ -0,0 +1,109 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef QTDCMVOLUMEASSEMBLER_H
+#define QTDCMVOLUMEASSEMBLER_H
+
+#include <QtGui>
+#include <QtDcmVolume.h>
+
+class DcmDataset;
+
+/**
+ * This class builds a volume from datasets as they are received, without going through
+ * dicom files on disk.
+ *
+ * Only the pixel data and the geometry of each slice are kept, in an image allocated for the
+ * expected number of slices. The slices are placed along the normal of the serie when the volume
+ * is written. Single frame, single component slices of 8 or 16 bits are supported, a serie that
+ * can't be assembled (other pixel format, several orientations or sizes, several slices at the
+ * same position) makes the assembler invalid as soon as the offending slice is added.
+ */
+class QtDcmVolumeAssembler
+{
+public:
+    QtDcmVolumeAssembler();
+    virtual ~QtDcmVolumeAssembler();
+
+    /**
+     * Add a slice, decompressing its pixel data if needed
+     *
+     * @return false if the slice can't be part of the volume, the assembler is then invalid
+     */
+    bool addSlice ( DcmDataset * dataset );
+
+    /**
+     * Allocate the volume for a number of slices, so that it is not reallocated as the slices
+     * are received. Can be called before or after the first slice.
+     */
+    void reserve ( int sliceCount );
+
+    /**
+     * Keep the headers of the slices (false by default), so that takeDatasets() can give them
+     * back if the volume can't be assembled. Needed when the received datasets are not written.
+     */
+    void setKeepDatasets ( bool keep );
+
+    /**
+     * Rebuild the datasets of the slices added so far, in reception order, and release them.
+     * The caller owns the datasets.
+     *
+     * @return an empty list if the headers were not kept
+     */
+    QList<DcmDataset *> takeDatasets();
+
+    /**
+     * Write the datasets of takeDatasets() as dicom files in a directory, for the slices the
+     * volume held when it can't be written after all
+     *
+     * @param directory the files are named like the ones of the move SCU
+     * @return false if a file could not be written, true if there was nothing to write
+     */
+    bool saveDatasets ( const QString & directory, int * savedCount = NULL );
+
+    bool isValid() const;
+
+    int sliceCount() const;
+
+    /**
+     * SOPInstanceUIDs of the slices, in reception order
+     */
+    QStringList instanceUids() const;
+
+    /**
+     * Sort the slices and write the volume, rescaled to float if a slice has a rescale slope or intercept
+     *
+     * @param filename output file, the format is given by the extension, nothing is written if empty
+     * @param compressionLevel 0 to 9, used by the compressed formats
+     * @param volume if not null, receives the image in memory
+     * @return false if the volume is invalid or the writing failed
+     */
+    bool write ( const QString & filename, int compressionLevel = 6, QtDcmVolume * volume = NULL );
+
+private:
+    class Private;
+    Private * d;
+
+    Q_DISABLE_COPY ( QtDcmVolumeAssembler )
+};
+
+Q_DECLARE_METATYPE ( QSharedPointer<QtDcmVolumeAssembler> )
+
+#endif // QTDCMVOLUMEASSEMBLER_H
@@ -0,0 +1,209 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <QtTest>
+
+#include <QtDcmConversionCache.h>
+
+namespace
+{
+bool writeFile ( const QString & filename, const QByteArray & content )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::WriteOnly ) && file.write ( content ) == content.size();
+}
+
+QByteArray readFile ( const QString & filename )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::ReadOnly ) ? file.readAll() : QByteArray();
+}
+
+bool setModified ( const QString & filename, const QDateTime & time )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::ReadWrite ) && file.setFileTime ( time, QFileDevice::FileModificationTime );
+}
+}
+
+class QtDcmConversionCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void key();
+    void storeAndRestore();
+    void rejectsModifiedOutputs();
+    void rejectsMissingOutputs();
+    void prunesLeastRecentlyUsed();
+    void prunesOldAndMissing();
+
+private:
+    QString store ( const QByteArray & key, const QString & name, const QByteArray & content );
+    QString entryFilename ( const QByteArray & key ) const;
+    int entryCount() const;
+
+    QScopedPointer<QTemporaryDir> directory;
+    QScopedPointer<QtDcmConversionCache> cache;
+};
+
+void QtDcmConversionCacheTest::init()
+{
+    directory.reset ( new QTemporaryDir );
+    QVERIFY ( directory->isValid() );
+    QVERIFY ( QDir ( directory->path() ).mkpath ( "outputs" ) );
+    QVERIFY ( QDir ( directory->path() ).mkpath ( "restored" ) );
+    cache.reset ( new QtDcmConversionCache ( directory->filePath ( "cache" ) ) );
+}
+
+void QtDcmConversionCacheTest::cleanup()
+{
+    cache.reset();
+    directory.reset();
+}
+
+QString QtDcmConversionCacheTest::store ( const QByteArray & key, const QString & name, const QByteArray & content )
+{
+    const QString filename = directory->filePath ( "outputs/" + name );
+    if ( !writeFile ( filename, content ) ) {
+        return QString();
+    }
+    cache->store ( key, QStringList() << filename );
+    return filename;
+}
+
+QString QtDcmConversionCacheTest::entryFilename ( const QByteArray & key ) const
+{
+    return directory->filePath ( "cache/" + QString::fromLatin1 ( key ) + ".txt" );
+}
+
+int QtDcmConversionCacheTest::entryCount() const
+{
+    return QDir ( directory->filePath ( "cache" ) ).entryList ( QStringList() << "*.txt", QDir::Files ).size();
+}
+
+void QtDcmConversionCacheTest::key()
+{
+    const QStringList uids = QStringList() << "1.2.3.1" << "1.2.3.2" << "1.2.3.3";
+    const QByteArray key = QtDcmConversionCache::key ( "1.2.3", uids, "nii.gz/6" );
+    QCOMPARE ( key.size(), 40 );
+
+    // The order of the instances does not matter, anything else does
+    QCOMPARE ( QtDcmConversionCache::key ( "1.2.3", QStringList() << "1.2.3.3" << "1.2.3.1" << "1.2.3.2", "nii.gz/6" ), key );
+    QVERIFY ( QtDcmConversionCache::key ( "1.2.3", uids.mid ( 1 ), "nii.gz/6" ) != key );
+    QVERIFY ( QtDcmConversionCache::key ( "1.2.3", uids + ( QStringList() << "1.2.3.4" ), "nii.gz/6" ) != key );
+    QVERIFY ( QtDcmConversionCache::key ( "1.2.3", uids, "nii/6" ) != key );
+    QVERIFY ( QtDcmConversionCache::key ( "1.2.4", uids, "nii.gz/6" ) != key );
+
+    // The separators keep the fields apart
+    QVERIFY ( QtDcmConversionCache::key ( "1.2", QStringList() << "3", "x" )
+              != QtDcmConversionCache::key ( "1.2\n3", QStringList(), "x" ) );
+}
+
+void QtDcmConversionCacheTest::storeAndRestore()
+{
+    const QString output = store ( "a", "serie.nii", "voxels" );
+    QVERIFY ( !output.isEmpty() );
+
+    QStringList restored;
+    QVERIFY ( cache->restore ( "a", directory->filePath ( "restored" ), &restored ) );
+    QCOMPARE ( restored, QStringList() << directory->filePath ( "restored/serie.nii" ) );
+    QCOMPARE ( readFile ( restored.first() ), QByteArray ( "voxels" ) );
+
+    // Restoring to the directory of the outputs leaves them alone
+    QVERIFY ( cache->restore ( "a", directory->filePath ( "outputs" ), &restored ) );
+    QCOMPARE ( readFile ( output ), QByteArray ( "voxels" ) );
+
+    QVERIFY ( !cache->restore ( "b", directory->filePath ( "restored" ) ) );
+}
+
+void QtDcmConversionCacheTest::rejectsModifiedOutputs()
+{
+    const QString output = store ( "a", "serie.nii", "voxels" );
+    QVERIFY ( !output.isEmpty() );
+
+    // Same size, another content and time
+    QVERIFY ( writeFile ( output, "VOXELS" ) );
+    QVERIFY ( setModified ( output, QDateTime::currentDateTime().addSecs ( 10 ) ) );
+
+    QVERIFY ( !cache->restore ( "a", directory->filePath ( "restored" ) ) );
+    QVERIFY ( !QFile::exists ( directory->filePath ( "restored/serie.nii" ) ) );
+
+    // The entry is dropped
+    QVERIFY ( !QFile::exists ( entryFilename ( "a" ) ) );
+}
+
+void QtDcmConversionCacheTest::rejectsMissingOutputs()
+{
+    const QString output = store ( "a", "serie.nii", "voxels" );
+    QVERIFY ( QFile::remove ( output ) );
+
+    QVERIFY ( !cache->restore ( "a", directory->filePath ( "restored" ) ) );
+    QVERIFY ( !QFile::exists ( entryFilename ( "a" ) ) );
+}
+
+void QtDcmConversionCacheTest::prunesLeastRecentlyUsed()
+{
+    cache->setMaxEntries ( 2 );
+    QVERIFY ( !store ( "a", "a.nii", "a" ).isEmpty() );
+    QVERIFY ( !store ( "b", "b.nii", "b" ).isEmpty() );
+    QCOMPARE ( entryCount(), 2 );
+
+    // a was used last, b is the one forgotten
+    QVERIFY ( setModified ( entryFilename ( "a" ), QDateTime::currentDateTime().addSecs ( -60 ) ) );
+    QVERIFY ( setModified ( entryFilename ( "b" ), QDateTime::currentDateTime().addSecs ( -120 ) ) );
+    QVERIFY ( !store ( "c", "c.nii", "c" ).isEmpty() );
+
+    QCOMPARE ( entryCount(), 2 );
+    QVERIFY ( QFile::exists ( entryFilename ( "a" ) ) );
+    QVERIFY ( !QFile::exists ( entryFilename ( "b" ) ) );
+    QVERIFY ( QFile::exists ( entryFilename ( "c" ) ) );
+}
+
+void QtDcmConversionCacheTest::prunesOldAndMissing()
+{
+    QVERIFY ( !store ( "a", "a.nii", "a" ).isEmpty() );
+    const QString output = store ( "b", "b.nii", "b" );
+    QVERIFY ( !store ( "c", "c.nii", "c" ).isEmpty() );
+    QCOMPARE ( entryCount(), 3 );
+
+    cache->setMaxAge ( 30 );
+    QVERIFY ( setModified ( entryFilename ( "a" ), QDateTime::currentDateTime().addDays ( -31 ) ) );
+    QVERIFY ( QFile::remove ( output ) );
+    cache->prune();
+
+    QCOMPARE ( entryCount(), 1 );
+    QVERIFY ( cache->restore ( "c", directory->filePath ( "restored" ) ) );
+
+    // 0 keeps the entries forever
+    cache->setMaxAge ( 0 );
+    QVERIFY ( setModified ( entryFilename ( "c" ), QDateTime::currentDateTime().addDays ( -3650 ) ) );
+    cache->prune();
+    QCOMPARE ( entryCount(), 1 );
+}
+
+QTEST_GUILESS_MAIN ( QtDcmConversionCacheTest )
+
+#include "QtDcmConversionCacheTest.moc"
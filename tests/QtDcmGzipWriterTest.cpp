@@ -0,0 +1,181 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <cstring>
+
+#include <itk_zlib.h>
+
+#include <QtTest>
+
+#include <QtDcmGzipWriter.h>
+
+namespace
+{
+/**
+ * Decompress every member of a gzip stream, as gzip readers do. Returns a null array if
+ * the stream is invalid or truncated.
+ */
+QByteArray gunzip ( const QByteArray & compressed, int * memberCount = NULL )
+{
+    z_stream stream;
+    memset ( &stream, 0, sizeof ( stream ) );
+    if ( inflateInit2 ( &stream, 15 + 16 ) != Z_OK ) {
+        return QByteArray();
+    }
+
+    stream.next_in = reinterpret_cast<Bytef *> ( const_cast<char *> ( compressed.constData() ) );
+    stream.avail_in = compressed.size();
+
+    QByteArray output;
+    QByteArray buffer ( 64 * 1024, '\0' );
+    int members = 0;
+    int status = Z_OK;
+    while ( true ) {
+        stream.next_out = reinterpret_cast<Bytef *> ( buffer.data() );
+        stream.avail_out = buffer.size();
+        status = inflate ( &stream, Z_NO_FLUSH );
+        if ( status != Z_OK && status != Z_STREAM_END ) {
+            break;
+        }
+        output.append ( buffer.constData(), buffer.size() - stream.avail_out );
+
+        if ( status == Z_STREAM_END ) {
+            members++;
+            if ( stream.avail_in == 0 ) {
+                break;
+            }
+            inflateReset ( &stream );
+        }
+    }
+    inflateEnd ( &stream );
+
+    if ( memberCount ) {
+        *memberCount = members;
+    }
+    return ( status == Z_STREAM_END ) ? output : QByteArray();
+}
+
+/**
+ * Compressible data that is not a plain repetition
+ */
+QByteArray sampleData ( int size )
+{
+    QByteArray data ( size, Qt::Uninitialized );
+    char * out = data.data();
+    quint32 seed = 12345;
+    for ( int i = 0; i < size; i++ ) {
+        seed = seed * 1103515245 + 12345;
+        out[i] = char ( ( ( i / 4096 ) & 0xf0 ) | ( ( seed >> 16 ) & 0x03 ) );
+    }
+    return data;
+}
+}
+
+class QtDcmGzipWriterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void writesMembers_data();
+    void writesMembers();
+    void flushesNothing();
+    void storedMember();
+};
+
+void QtDcmGzipWriterTest::writesMembers_data()
+{
+    QTest::addColumn<int> ( "size" );
+    QTest::addColumn<int> ( "chunkSize" );
+    QTest::addColumn<int> ( "threadCount" );
+
+    QTest::newRow ( "single write" ) << 5 * 1024 * 1024 + 1000 << 5 * 1024 * 1024 + 1000 << 4;
+    QTest::newRow ( "small writes" ) << 5 * 1024 * 1024 + 1000 << 10000 << 4;
+    QTest::newRow ( "unaligned writes" ) << 5 * 1024 * 1024 + 1000 << 1024 * 1024 + 17 << 3;
+    QTest::newRow ( "single thread" ) << 3 * 1024 * 1024 << 700 * 1024 << 1;
+    QTest::newRow ( "less than a block" ) << 1000 << 100 << 4;
+}
+
+void QtDcmGzipWriterTest::writesMembers()
+{
+    QFETCH ( int, size );
+    QFETCH ( int, chunkSize );
+    QFETCH ( int, threadCount );
+
+    const QByteArray data = sampleData ( size );
+
+    QByteArray compressed;
+    QBuffer buffer ( &compressed );
+    QVERIFY ( buffer.open ( QIODevice::WriteOnly ) );
+
+    QtDcmGzipWriter writer ( &buffer, 6, threadCount );
+    for ( int offset = 0; offset < size; offset += chunkSize ) {
+        QVERIFY ( writer.write ( data.constData() + offset, qMin ( chunkSize, size - offset ) ) );
+    }
+    QVERIFY ( writer.flush() );
+
+    // One member per started MB
+    int members = 0;
+    QCOMPARE ( gunzip ( compressed, &members ), data );
+    QCOMPARE ( members, ( size + 1024 * 1024 - 1 ) / ( 1024 * 1024 ) );
+    QVERIFY ( compressed.size() < size );
+}
+
+void QtDcmGzipWriterTest::flushesNothing()
+{
+    QByteArray compressed;
+    QBuffer buffer ( &compressed );
+    QVERIFY ( buffer.open ( QIODevice::WriteOnly ) );
+
+    QtDcmGzipWriter writer ( &buffer, 6, 2 );
+    QVERIFY ( writer.flush() );
+    QVERIFY ( compressed.isEmpty() );
+}
+
+void QtDcmGzipWriterTest::storedMember()
+{
+    const QByteArray header = sampleData ( 352 );
+    const QByteArray member = QtDcmGzipWriter::storedMember ( header );
+    QCOMPARE ( member.size(), QtDcmGzipWriter::storedMemberSize ( header.size() ) );
+    QCOMPARE ( gunzip ( member ), header );
+
+    // Followed by compressed members, as in a .nii.gz
+    const QByteArray data = sampleData ( 2 * 1024 * 1024 + 5 );
+    QByteArray compressed;
+    QBuffer buffer ( &compressed );
+    QVERIFY ( buffer.open ( QIODevice::WriteOnly ) );
+    QVERIFY ( buffer.write ( member ) == member.size() );
+
+    QtDcmGzipWriter writer ( &buffer, 1, 2 );
+    QVERIFY ( writer.write ( data.constData(), data.size() ) );
+    QVERIFY ( writer.flush() );
+
+    int members = 0;
+    QCOMPARE ( gunzip ( compressed, &members ), header + data );
+    QCOMPARE ( members, 4 );
+
+    // A truncated stream is not mistaken for a complete one
+    QVERIFY ( gunzip ( compressed.left ( compressed.size() - 1 ) ).isNull() );
+}
+
+QTEST_GUILESS_MAIN ( QtDcmGzipWriterTest )
+
+#include "QtDcmGzipWriterTest.moc"
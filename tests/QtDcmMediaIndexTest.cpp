@@ -0,0 +1,230 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <cstring>
+
+#include <QtTest>
+
+#include <QtDcmMediaIndex.h>
+
+namespace
+{
+// Offsets in the file header written by QtDcmMediaIndex::save()
+const int HeaderSize = 40;
+const int KeySizeOffset = 12;
+const int RootSizeOffset = 16;
+const int PatientCountOffset = 20;
+const int StringSizeOffset = 36;
+
+QtDcmMediaIndex::InstanceInfo instanceInfo ( const QByteArray & patient, const QByteArray & serie, int number )
+{
+    QtDcmMediaIndex::InstanceInfo info;
+    info.patientName = patient + "^Name";
+    info.patientId = patient;
+    info.patientBirthdate = "19700101";
+    info.patientSex = "O";
+    info.studyUid = "1.2.3." + patient;
+    info.studyId = "1";
+    info.studyDescription = "Study of " + patient;
+    info.studyDate = "20200101";
+    info.seriesUid = serie;
+    info.seriesDescription = "Serie " + serie;
+    info.modality = "MR";
+    info.institution = "Hospital";
+    info.acquisitionNumber = "1";
+    info.performingPhysician = "Physician";
+    info.sopInstanceUid = serie + "." + QByteArray::number ( number );
+    info.instanceNumber = number;
+    info.file = serie + "/IM" + QByteArray::number ( number );
+    return info;
+}
+
+QByteArray readFile ( const QString & filename )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::ReadOnly ) ? file.readAll() : QByteArray();
+}
+
+bool writeFile ( const QString & filename, const QByteArray & content )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::WriteOnly ) && file.write ( content ) == content.size();
+}
+}
+
+class QtDcmMediaIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+
+    void saveAndLoad();
+    void rejectsOtherKey();
+    void rejectsTruncatedFiles();
+    void rejectsCorruptedHeaders_data();
+    void rejectsCorruptedHeaders();
+    void rejectsUnterminatedStrings();
+
+private:
+    QTemporaryDir directory;
+    QString filename;
+    QByteArray saved;
+};
+
+void QtDcmMediaIndexTest::initTestCase()
+{
+    QVERIFY ( directory.isValid() );
+    filename = directory.filePath ( "index" );
+
+    // Instances added out of order, and once twice
+    QtDcmMediaIndex index;
+    index.setRootDirectory ( "/media/cdrom" );
+    index.addInstance ( instanceInfo ( "P1", "1.1", 3 ) );
+    index.addInstance ( instanceInfo ( "P2", "2.1", 2 ) );
+    index.addInstance ( instanceInfo ( "P1", "1.1", 1 ) );
+    index.addInstance ( instanceInfo ( "P2", "2.1", 1 ) );
+    index.addInstance ( instanceInfo ( "P1", "1.1", 2 ) );
+    index.addInstance ( instanceInfo ( "P1", "1.1", 1 ) );
+    index.addInstance ( instanceInfo ( "P1", "1.2", 1 ) );
+    index.finalize();
+
+    QVERIFY ( index.save ( filename, "media" ) );
+    saved = readFile ( filename );
+    QVERIFY ( saved.size() > HeaderSize );
+}
+
+void QtDcmMediaIndexTest::init()
+{
+    // The tests corrupt the file
+    QVERIFY ( writeFile ( filename, saved ) );
+}
+
+void QtDcmMediaIndexTest::saveAndLoad()
+{
+    QtDcmMediaIndex index;
+    QVERIFY ( index.load ( filename, "media" ) );
+
+    QCOMPARE ( index.rootDirectory(), QString ( "/media/cdrom" ) );
+    QCOMPARE ( index.patientCount(), 2 );
+    QCOMPARE ( index.studyCount(), 2 );
+    QCOMPARE ( index.seriesCount(), 3 );
+    QCOMPARE ( index.instanceCount(), 6 );
+
+    // Children are contiguous and point back to their parent
+    for ( int p = 0; p < index.patientCount(); ++p ) {
+        const QtDcmMediaIndex::PatientRecord & patient = index.patient ( p );
+        for ( quint32 s = patient.firstStudy; s < patient.firstStudy + patient.studyCount; ++s ) {
+            QCOMPARE ( index.study ( s ).patient, quint32 ( p ) );
+            QCOMPARE ( index.string ( index.study ( s ).description ), "Study of " + index.string ( patient.id ) );
+        }
+    }
+
+    const int serie = index.findSerie ( "1.1" );
+    QVERIFY ( serie >= 0 );
+    QCOMPARE ( index.serie ( serie ).instanceCount, quint32 ( 3 ) );
+    QCOMPARE ( index.string ( index.serie ( serie ).description ), QString ( "Serie 1.1" ) );
+    QCOMPARE ( index.string ( index.study ( index.serie ( serie ).study ).uid ), QString ( "1.2.3.P1" ) );
+
+    // Instances sorted by number
+    QCOMPARE ( index.serieFilenames ( "1.1" ), QStringList() << "/media/cdrom/1.1/IM1"
+                                                              << "/media/cdrom/1.1/IM2"
+                                                              << "/media/cdrom/1.1/IM3" );
+    QCOMPARE ( index.instanceFilename ( "2.1", "2.1.2" ), QString ( "/media/cdrom/2.1/IM2" ) );
+    QVERIFY ( index.instanceFilename ( "2.1", "2.1.3" ).isEmpty() );
+    QCOMPARE ( index.findSerie ( "3.1" ), -1 );
+
+    // A loaded index can be loaded again
+    QVERIFY ( index.load ( filename, "media" ) );
+    QCOMPARE ( index.instanceCount(), 6 );
+}
+
+void QtDcmMediaIndexTest::rejectsOtherKey()
+{
+    QtDcmMediaIndex index;
+    QVERIFY ( !index.load ( filename, "other media" ) );
+    QVERIFY ( !index.load ( filename, QByteArray() ) );
+    QVERIFY ( !index.load ( directory.filePath ( "missing" ), "media" ) );
+}
+
+void QtDcmMediaIndexTest::rejectsTruncatedFiles()
+{
+    const QList<int> sizes = QList<int>() << 0 << HeaderSize - 1 << HeaderSize << HeaderSize + 4
+                                          << saved.size() / 2 << saved.size() - 1;
+    for ( int size : sizes ) {
+        QVERIFY ( writeFile ( filename, saved.left ( size ) ) );
+
+        QtDcmMediaIndex index;
+        QVERIFY2 ( !index.load ( filename, "media" ), qPrintable ( QString::number ( size ) ) );
+    }
+
+    QVERIFY ( writeFile ( filename, saved + '\0' ) );
+    QtDcmMediaIndex index;
+    QVERIFY ( !index.load ( filename, "media" ) );
+}
+
+void QtDcmMediaIndexTest::rejectsCorruptedHeaders_data()
+{
+    QTest::addColumn<int> ( "offset" );
+    QTest::addColumn<quint32> ( "value" );
+
+    QTest::newRow ( "huge key" ) << KeySizeOffset << quint32 ( 0xFFFFFFFF );
+    QTest::newRow ( "wrapping key" ) << KeySizeOffset << quint32 ( 0xFFFFFFFD );
+    QTest::newRow ( "key past the end" ) << KeySizeOffset << quint32 ( saved.size() );
+    QTest::newRow ( "huge root" ) << RootSizeOffset << quint32 ( 0xFFFFFFFF );
+    QTest::newRow ( "wrapping root" ) << RootSizeOffset << quint32 ( 0xFFFFFFFD );
+    QTest::newRow ( "root past the end" ) << RootSizeOffset << quint32 ( saved.size() );
+    QTest::newRow ( "patients past the end" ) << PatientCountOffset << quint32 ( 0x10000000 );
+    QTest::newRow ( "no strings" ) << StringSizeOffset << quint32 ( 0 );
+    QTest::newRow ( "strings past the end" ) << StringSizeOffset << quint32 ( 0xFFFFFFFF );
+    QTest::newRow ( "version" ) << 8 << quint32 ( 0 );
+    QTest::newRow ( "magic" ) << 0 << quint32 ( 0 );
+}
+
+void QtDcmMediaIndexTest::rejectsCorruptedHeaders()
+{
+    QFETCH ( int, offset );
+    QFETCH ( quint32, value );
+
+    QByteArray corrupted = saved;
+    memcpy ( corrupted.data() + offset, &value, sizeof ( value ) );
+    QVERIFY ( writeFile ( filename, corrupted ) );
+
+    QtDcmMediaIndex index;
+    QVERIFY ( !index.load ( filename, "media" ) );
+    QCOMPARE ( index.instanceCount(), 0 );
+}
+
+void QtDcmMediaIndexTest::rejectsUnterminatedStrings()
+{
+    QByteArray corrupted = saved;
+    corrupted[corrupted.size() - 1] = 'x';
+    QVERIFY ( writeFile ( filename, corrupted ) );
+
+    QtDcmMediaIndex index;
+    QVERIFY ( !index.load ( filename, "media" ) );
+}
+
+QTEST_GUILESS_MAIN ( QtDcmMediaIndexTest )
+
+#include "QtDcmMediaIndexTest.moc"
@@ -0,0 +1,299 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <cmath>
+#include <cstring>
+
+#include <itk_zlib.h>
+
+#include <QtTest>
+
+#include <QtDcmNiftiWriter.h>
+
+namespace
+{
+const int VoxOffset = 352;
+
+template <typename T>
+T get ( const QByteArray & header, int offset )
+{
+    T value;
+    memcpy ( &value, header.constData() + offset, sizeof ( T ) );
+    return value;
+}
+
+QByteArray readFile ( const QString & filename )
+{
+    QFile file ( filename );
+    return file.open ( QIODevice::ReadOnly ) ? file.readAll() : QByteArray();
+}
+
+/**
+ * Read a .nii.gz the way NIfTI readers do, through the gzip functions of zlib
+ */
+QByteArray readCompressedFile ( const QString & filename )
+{
+    gzFile file = gzopen ( QFile::encodeName ( filename ).constData(), "rb" );
+    if ( !file ) {
+        return QByteArray();
+    }
+
+    QByteArray content;
+    QByteArray buffer ( 64 * 1024, '\0' );
+    int count = 0;
+    while ( ( count = gzread ( file, buffer.data(), buffer.size() ) ) > 0 ) {
+        content.append ( buffer.constData(), count );
+    }
+    gzclose ( file );
+
+    return ( count < 0 ) ? QByteArray() : content;
+}
+
+QByteArray voxels ( int count )
+{
+    QByteArray data ( count * int ( sizeof ( qint16 ) ), Qt::Uninitialized );
+    qint16 * values = reinterpret_cast<qint16 *> ( data.data() );
+    for ( int i = 0; i < count; i++ ) {
+        values[i] = qint16 ( ( i % 1000 ) - 500 );
+    }
+    return data;
+}
+}
+
+class QtDcmNiftiWriterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void header();
+    void fourDimensions();
+    void orientation_data();
+    void orientation();
+    void incompleteImage();
+    void compressedImage();
+
+private:
+    bool writeImage ( const QString & filename, const QByteArray & data, int slabCount = 1 );
+
+    QTemporaryDir directory;
+    QScopedPointer<QtDcmNiftiWriter> writer;
+};
+
+void QtDcmNiftiWriterTest::init()
+{
+    QVERIFY ( directory.isValid() );
+    writer.reset ( new QtDcmNiftiWriter );
+}
+
+bool QtDcmNiftiWriterTest::writeImage ( const QString & filename, const QByteArray & data, int slabCount )
+{
+    if ( !writer->open ( filename ) ) {
+        return false;
+    }
+
+    const int slabSize = data.size() / slabCount;
+    for ( int offset = 0; offset < data.size(); offset += slabSize ) {
+        if ( !writer->writeData ( data.constData() + offset, qMin ( slabSize, data.size() - offset ) ) ) {
+            return false;
+        }
+    }
+    return writer->close();
+}
+
+void QtDcmNiftiWriterTest::header()
+{
+    const double origin[3] = { 10, -20, 30 };
+    writer->setDatatype ( QtDcmNiftiWriter::INT16 );
+    writer->setDimensions ( 3, 2, 2 );
+    writer->setSpacing ( 0.5, 0.75, 2 );
+    writer->setOrigin ( origin );
+
+    const QString filename = directory.filePath ( "header.nii" );
+    const QByteArray data = voxels ( 12 );
+    QVERIFY ( writeImage ( filename, data ) );
+
+    const QByteArray file = readFile ( filename );
+    QCOMPARE ( file.size(), VoxOffset + data.size() );
+    QCOMPARE ( file.mid ( VoxOffset ), data );
+
+    QCOMPARE ( get<qint32> ( file, 0 ), 348 );                  // sizeof_hdr
+    QCOMPARE ( get<qint16> ( file, 40 ), qint16 ( 3 ) );        // dim
+    QCOMPARE ( get<qint16> ( file, 42 ), qint16 ( 3 ) );
+    QCOMPARE ( get<qint16> ( file, 44 ), qint16 ( 2 ) );
+    QCOMPARE ( get<qint16> ( file, 46 ), qint16 ( 2 ) );
+    QCOMPARE ( get<qint16> ( file, 48 ), qint16 ( 1 ) );
+    QCOMPARE ( get<qint16> ( file, 70 ), qint16 ( QtDcmNiftiWriter::INT16 ) );
+    QCOMPARE ( get<qint16> ( file, 72 ), qint16 ( 16 ) );       // bitpix
+    QCOMPARE ( get<float> ( file, 76 ), 1.0f );                 // qfac
+    QCOMPARE ( get<float> ( file, 80 ), 0.5f );                 // pixdim
+    QCOMPARE ( get<float> ( file, 84 ), 0.75f );
+    QCOMPARE ( get<float> ( file, 88 ), 2.0f );
+    QCOMPARE ( get<float> ( file, 108 ), float ( VoxOffset ) ); // vox_offset
+    QCOMPARE ( get<qint16> ( file, 252 ), qint16 ( 1 ) );       // qform_code
+    QCOMPARE ( get<qint16> ( file, 254 ), qint16 ( 1 ) );       // sform_code
+    QCOMPARE ( file.mid ( 344, 4 ), QByteArray ( "n+1\0", 4 ) );
+
+    // LPS to RAS : x and y flipped, the quaternion is a half turn around z
+    QCOMPARE ( get<float> ( file, 256 ), 0.0f );
+    QCOMPARE ( get<float> ( file, 260 ), 0.0f );
+    QCOMPARE ( get<float> ( file, 264 ), 1.0f );
+    QCOMPARE ( get<float> ( file, 268 ), -10.0f );              // qoffset
+    QCOMPARE ( get<float> ( file, 272 ), 20.0f );
+    QCOMPARE ( get<float> ( file, 276 ), 30.0f );
+
+    const float srow[3][4] = { { -0.5f, 0, 0, -10 }, { 0, -0.75f, 0, 20 }, { 0, 0, 2, 30 } };
+    for ( int i = 0; i < 3; i++ ) {
+        for ( int j = 0; j < 4; j++ ) {
+            QCOMPARE ( get<float> ( file, 280 + 16 * i + 4 * j ), srow[i][j] );
+        }
+    }
+}
+
+void QtDcmNiftiWriterTest::fourDimensions()
+{
+    writer->setDatatype ( QtDcmNiftiWriter::INT16 );
+    writer->setDimensions ( 2, 2, 2, 3 );
+
+    const QString filename = directory.filePath ( "time.nii" );
+    QVERIFY ( writeImage ( filename, voxels ( 24 ), 3 ) );
+
+    const QByteArray file = readFile ( filename );
+    QCOMPARE ( get<qint16> ( file, 40 ), qint16 ( 4 ) );
+    QCOMPARE ( get<qint16> ( file, 48 ), qint16 ( 3 ) );
+    QCOMPARE ( file.size(), VoxOffset + 48 );
+}
+
+void QtDcmNiftiWriterTest::orientation_data()
+{
+    QTest::addColumn<QVector<double> > ( "direction" );
+
+    // 30 degrees around x
+    const double c = std::sqrt ( 3.0 ) / 2;
+    const double s = 0.5;
+    QTest::newRow ( "axial" ) << ( QVector<double>() << 1 << 0 << 0 << 0 << 1 << 0 << 0 << 0 << 1 );
+    QTest::newRow ( "quarter turn around z" ) << ( QVector<double>() << 0 << -1 << 0 << 1 << 0 << 0 << 0 << 0 << 1 );
+    QTest::newRow ( "half turn around x" ) << ( QVector<double>() << 1 << 0 << 0 << 0 << -1 << 0 << 0 << 0 << -1 );
+    QTest::newRow ( "half turn around y" ) << ( QVector<double>() << -1 << 0 << 0 << 0 << 1 << 0 << 0 << 0 << -1 );
+    QTest::newRow ( "oblique" ) << ( QVector<double>() << 1 << 0 << 0 << 0 << c << -s << 0 << s << c );
+    QTest::newRow ( "left handed" ) << ( QVector<double>() << 1 << 0 << 0 << 0 << 1 << 0 << 0 << 0 << -1 );
+    QTest::newRow ( "sagittal" ) << ( QVector<double>() << 0 << 0 << -1 << 1 << 0 << 0 << 0 << -1 << 0 );
+}
+
+void QtDcmNiftiWriterTest::orientation()
+{
+    QFETCH ( QVector<double>, direction );
+
+    double matrix[3][3];
+    for ( int i = 0; i < 3; i++ ) {
+        for ( int j = 0; j < 3; j++ ) {
+            matrix[i][j] = direction.at ( 3 * i + j );
+        }
+    }
+
+    const double spacing[3] = { 0.5, 0.75, 2 };
+    const double origin[3] = { 10, -20, 30 };
+    writer->setDatatype ( QtDcmNiftiWriter::UINT8 );
+    writer->setDimensions ( 2, 2, 2 );
+    writer->setSpacing ( spacing[0], spacing[1], spacing[2] );
+    writer->setOrigin ( origin );
+    writer->setDirection ( matrix );
+
+    const QString filename = directory.filePath ( "orientation.nii" );
+    QVERIFY ( writeImage ( filename, QByteArray ( 8, '\0' ) ) );
+    const QByteArray file = readFile ( filename );
+
+    // sform : the LPS matrix with x and y flipped
+    for ( int i = 0; i < 3; i++ ) {
+        const double flip = ( i < 2 ) ? -1 : 1;
+        for ( int j = 0; j < 3; j++ ) {
+            QVERIFY ( std::fabs ( get<float> ( file, 280 + 16 * i + 4 * j ) - flip * matrix[i][j] * spacing[j] ) < 1e-5 );
+        }
+        QVERIFY ( std::fabs ( get<float> ( file, 280 + 16 * i + 12 ) - flip * origin[i] ) < 1e-5 );
+        QVERIFY ( std::fabs ( get<float> ( file, 268 + 4 * i ) - flip * origin[i] ) < 1e-5 );
+    }
+
+    // qform : the quaternion must give the same matrix (nifti_quatern_to_mat44)
+    const double qfac = get<float> ( file, 76 );
+    const double b = get<float> ( file, 256 );
+    const double c = get<float> ( file, 260 );
+    const double d = get<float> ( file, 264 );
+    QVERIFY ( qfac == 1 || qfac == -1 );
+
+    double a = 1 - ( b * b + c * c + d * d );
+    a = ( a < 1e-7 ) ? 0 : std::sqrt ( a );
+    const double rotation[3][3] = {
+        { a * a + b * b - c * c - d * d, 2 * ( b * c - a * d ), 2 * ( b * d + a * c ) },
+        { 2 * ( b * c + a * d ), a * a + c * c - b * b - d * d, 2 * ( c * d - a * b ) },
+        { 2 * ( b * d - a * c ), 2 * ( c * d + a * b ), a * a + d * d - c * c - b * b }
+    };
+
+    // b, c and d are floats, so a is only known to about 1e-3 near a half turn
+    for ( int i = 0; i < 3; i++ ) {
+        for ( int j = 0; j < 3; j++ ) {
+            const double value = rotation[i][j] * get<float> ( file, 80 + 4 * j ) * ( ( j == 2 ) ? qfac : 1 );
+            QVERIFY2 ( std::fabs ( value - get<float> ( file, 280 + 16 * i + 4 * j ) ) < 1e-3,
+                       qPrintable ( QString ( "qform and sform differ at %1,%2" ).arg ( i ).arg ( j ) ) );
+        }
+    }
+}
+
+void QtDcmNiftiWriterTest::incompleteImage()
+{
+    writer->setDatatype ( QtDcmNiftiWriter::INT16 );
+    writer->setDimensions ( 4, 4, 4 );
+
+    const QString filename = directory.filePath ( "incomplete.nii.gz" );
+    QVERIFY ( writer->open ( filename ) );
+    QVERIFY ( writer->writeData ( voxels ( 63 ).constData(), 63 * 2 ) );
+    QVERIFY ( !writer->close() );
+    QVERIFY ( !QFile::exists ( filename ) );
+}
+
+void QtDcmNiftiWriterTest::compressedImage()
+{
+    const double origin[3] = { 1, 2, 3 };
+    const double direction[3][3] = { { 0, 0, -1 }, { 1, 0, 0 }, { 0, -1, 0 } };
+    const QByteArray data = voxels ( 128 * 128 * 80 );
+
+    writer->setDatatype ( QtDcmNiftiWriter::INT16 );
+    writer->setDimensions ( 128, 128, 80 );
+    writer->setSpacing ( 1, 1, 1.5 );
+    writer->setOrigin ( origin );
+    writer->setDirection ( direction );
+    writer->setCompressionLevel ( 1 );
+
+    // Slice by slice, as the slabs of a streamed volume
+    const QString filename = directory.filePath ( "image.nii" );
+    QVERIFY ( writeImage ( filename, data, 80 ) );
+    QVERIFY ( writeImage ( filename + ".gz", data, 80 ) );
+
+    const QByteArray plain = readFile ( filename );
+    QCOMPARE ( plain.size(), VoxOffset + data.size() );
+    QVERIFY ( QFileInfo ( filename + ".gz" ).size() < plain.size() );
+    QVERIFY ( readCompressedFile ( filename + ".gz" ) == plain );
+}
+
+QTEST_GUILESS_MAIN ( QtDcmNiftiWriterTest )
+
+#include "QtDcmNiftiWriterTest.moc"
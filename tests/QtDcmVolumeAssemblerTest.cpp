@@ -0,0 +1,205 @@
+/*
+    QtDcm is a C++ Qt based library for communication and conversion of Dicom images.
+    Copyright (C) 2011  Alexandre Abadie <Alexandre.Abadie@univ-rennes1.fr>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#define QT_NO_CAST_TO_ASCII
+
+#include <algorithm>
+
+#include <dcmtk/config/osconfig.h>
+#include <dcmtk/dcmdata/dcdatset.h>
+#include <dcmtk/dcmdata/dcdeftag.h>
+#include <dcmtk/dcmdata/dcfilefo.h>
+#include <dcmtk/dcmdata/dcuid.h>
+
+#include <QtTest>
+
+#include <QtDcmVolumeAssembler.h>
+
+namespace
+{
+const int Rows = 2;
+const int Columns = 3;
+
+/**
+ * An axial MR slice at a height, all its pixels set to value
+ */
+DcmDataset * slice ( double z, Uint16 value, int number )
+{
+    DcmDataset * dataset = new DcmDataset;
+    const QByteArray uid = "1.2.3.4." + QByteArray::number ( number );
+    const QByteArray position = "-10\\20\\" + QByteArray::number ( z );
+
+    dataset->putAndInsertString ( DCM_SOPClassUID, UID_MRImageStorage );
+    dataset->putAndInsertString ( DCM_SOPInstanceUID, uid.constData() );
+    dataset->putAndInsertString ( DCM_SeriesInstanceUID, "1.2.3" );
+    dataset->putAndInsertString ( DCM_Modality, "MR" );
+    dataset->putAndInsertString ( DCM_InstanceNumber, QByteArray::number ( number ).constData() );
+    dataset->putAndInsertString ( DCM_ImagePositionPatient, position.constData() );
+    dataset->putAndInsertString ( DCM_ImageOrientationPatient, "1\\0\\0\\0\\1\\0" );
+    dataset->putAndInsertString ( DCM_PixelSpacing, "0.5\\0.75" );
+    dataset->putAndInsertString ( DCM_PhotometricInterpretation, "MONOCHROME2" );
+    dataset->putAndInsertUint16 ( DCM_SamplesPerPixel, 1 );
+    dataset->putAndInsertUint16 ( DCM_Rows, Rows );
+    dataset->putAndInsertUint16 ( DCM_Columns, Columns );
+    dataset->putAndInsertUint16 ( DCM_BitsAllocated, 16 );
+    dataset->putAndInsertUint16 ( DCM_BitsStored, 16 );
+    dataset->putAndInsertUint16 ( DCM_HighBit, 15 );
+    dataset->putAndInsertUint16 ( DCM_PixelRepresentation, 0 );
+
+    Uint16 pixels[Rows * Columns];
+    for ( int i = 0; i < Rows * Columns; i++ ) {
+        pixels[i] = value;
+    }
+    dataset->putAndInsertUint16Array ( DCM_PixelData, pixels, Rows * Columns );
+
+    return dataset;
+}
+
+/**
+ * Add a slice and release it, as the move SCU does once the dataset is handled
+ */
+bool addSlice ( QtDcmVolumeAssembler & assembler, double z, Uint16 value, int number )
+{
+    DcmDataset * dataset = slice ( z, value, number );
+    const bool added = assembler.addSlice ( dataset );
+    delete dataset;
+    return added;
+}
+}
+
+class QtDcmVolumeAssemblerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void sortsSlices_data();
+    void sortsSlices();
+    void rejectsRepeatedPositions();
+    void savesHeldSlices();
+};
+
+void QtDcmVolumeAssemblerTest::sortsSlices_data()
+{
+    QTest::addColumn<QList<double> > ( "positions" );
+    QTest::addColumn<int> ( "reserved" );
+
+    QTest::newRow ( "in order" ) << ( QList<double>() << 0 << 2 << 4 << 6 ) << 4;
+    QTest::newRow ( "reversed" ) << ( QList<double>() << 6 << 4 << 2 << 0 ) << 4;
+    QTest::newRow ( "shuffled" ) << ( QList<double>() << 4 << 0 << 6 << 2 ) << 4;
+    QTest::newRow ( "more than reserved" ) << ( QList<double>() << 4 << 0 << 6 << 2 << 10 << 8 ) << 2;
+    QTest::newRow ( "not reserved" ) << ( QList<double>() << 2 << 0 << 4 ) << 0;
+}
+
+void QtDcmVolumeAssemblerTest::sortsSlices()
+{
+    QFETCH ( QList<double>, positions );
+    QFETCH ( int, reserved );
+
+    // Each slice holds its rank along z, so that the sorted volume holds 0, 1, 2...
+    QList<double> sorted = positions;
+    std::sort ( sorted.begin(), sorted.end() );
+
+    QtDcmVolumeAssembler assembler;
+    assembler.reserve ( reserved );
+    QStringList uids;
+    for ( int i = 0; i < positions.size(); i++ ) {
+        QVERIFY ( addSlice ( assembler, positions.at ( i ), sorted.indexOf ( positions.at ( i ) ), i + 1 ) );
+        uids.append ( "1.2.3.4." + QString::number ( i + 1 ) );
+    }
+    QVERIFY ( assembler.isValid() );
+    QCOMPARE ( assembler.sliceCount(), positions.size() );
+    QCOMPARE ( assembler.instanceUids(), uids );
+
+    QtDcmVolume volume;
+    QVERIFY ( assembler.write ( QString(), 6, &volume ) );
+    QVERIFY ( !volume.isNull() );
+    QCOMPARE ( volume.componentType(), QtDcmVolume::UINT16 );
+    QCOMPARE ( volume.size ( 0 ), Columns );
+    QCOMPARE ( volume.size ( 1 ), Rows );
+    QCOMPARE ( volume.size ( 2 ), positions.size() );
+
+    // The origin is the lowest slice, the spacing the distance between slices
+    QCOMPARE ( volume.origin ( 0 ), -10.0 );
+    QCOMPARE ( volume.origin ( 1 ), 20.0 );
+    QCOMPARE ( volume.origin ( 2 ), sorted.first() );
+    QCOMPARE ( volume.spacing ( 0 ), 0.75 );
+    QCOMPARE ( volume.spacing ( 1 ), 0.5 );
+    QCOMPARE ( volume.spacing ( 2 ), 2.0 );
+
+    const Uint16 * voxels = static_cast<const Uint16 *> ( volume.data() );
+    for ( int s = 0; s < positions.size(); s++ ) {
+        for ( int i = 0; i < Rows * Columns; i++ ) {
+            QCOMPARE ( int ( voxels[s * Rows * Columns + i] ), s );
+        }
+    }
+}
+
+void QtDcmVolumeAssemblerTest::rejectsRepeatedPositions()
+{
+    QtDcmVolumeAssembler assembler;
+    assembler.reserve ( 3 );
+    QVERIFY ( addSlice ( assembler, 0, 0, 1 ) );
+    QVERIFY ( addSlice ( assembler, 1, 1, 2 ) );
+
+    // A second time point of the same slice, within the position tolerance
+    QVERIFY ( !addSlice ( assembler, 1.00001, 2, 3 ) );
+    QVERIFY ( !assembler.isValid() );
+    QVERIFY ( !addSlice ( assembler, 2, 3, 4 ) );
+    QVERIFY ( !assembler.write ( QString() ) );
+}
+
+void QtDcmVolumeAssemblerTest::savesHeldSlices()
+{
+    QTemporaryDir directory;
+    QVERIFY ( directory.isValid() );
+
+    QtDcmVolumeAssembler assembler;
+    assembler.setKeepDatasets ( true );
+    QVERIFY ( addSlice ( assembler, 1, 7, 1 ) );
+    QVERIFY ( addSlice ( assembler, 0, 8, 2 ) );
+    QVERIFY ( !addSlice ( assembler, 0, 9, 3 ) );
+
+    // The slices received before the repeated one are given back with their pixels
+    int saved = 0;
+    QVERIFY ( assembler.saveDatasets ( directory.path(), &saved ) );
+    QCOMPARE ( saved, 2 );
+    QCOMPARE ( QDir ( directory.path() ).entryList ( QDir::Files ).size(), 2 );
+
+    DcmFileFormat file;
+    QVERIFY ( file.loadFile ( QFile::encodeName ( directory.filePath ( "MR.1.2.3.4.2" ) ).constData() ).good() );
+
+    OFString uid;
+    QVERIFY ( file.getDataset()->findAndGetOFString ( DCM_SOPInstanceUID, uid ).good() );
+    QCOMPARE ( QString ( uid.c_str() ), QString ( "1.2.3.4.2" ) );
+
+    const Uint16 * pixels = NULL;
+    unsigned long count = 0;
+    QVERIFY ( file.getDataset()->findAndGetUint16Array ( DCM_PixelData, pixels, &count ).good() );
+    QCOMPARE ( int ( count ), Rows * Columns );
+    QCOMPARE ( int ( pixels[0] ), 8 );
+
+    // Nothing is left to save
+    QVERIFY ( assembler.saveDatasets ( directory.path(), &saved ) );
+    QCOMPARE ( saved, 0 );
+}
+
+QTEST_GUILESS_MAIN ( QtDcmVolumeAssemblerTest )
+
+#include "QtDcmVolumeAssemblerTest.moc"